@@ -0,0 +1,277 @@
+#include "fork_server.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vm.hpp>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace vy::cli {
+
+#ifndef _WIN32
+
+/// The most bytes that a request from a client may take up.
+static constexpr uint32_t MaxRequestSize = 64 * 1024;
+
+/// The number of file descriptors sent with a request: stdin, stdout and stderr.
+static constexpr int NumStdFds = 3;
+
+/// @brief A script sent by a client. A request is sent as it's size, followed by the working
+/// directory of the client and the path of the script, each ending in a '\0'. The client's
+/// stdin, stdout and stderr are attached to the size.
+struct Request {
+	std::string cwd;
+	std::string path;
+	int fds[NumStdFds] = {-1, -1, -1};
+};
+
+static bool read_all(int fd, void* buf, size_t size) {
+	char* bytes = static_cast<char*>(buf);
+	while (size > 0) {
+		const ssize_t n = read(fd, bytes, size);
+		if (n < 0 and errno == EINTR) continue;
+		if (n <= 0) return false;
+		bytes += n;
+		size -= size_t(n);
+	}
+	return true;
+}
+
+static bool write_all(int fd, const void* buf, size_t size) {
+	const char* bytes = static_cast<const char*>(buf);
+	while (size > 0) {
+		const ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (n < 0 and errno == EINTR) continue;
+		if (n <= 0) return false;
+		bytes += n;
+		size -= size_t(n);
+	}
+	return true;
+}
+
+/// @brief Fills [address] with the address of the socket at [path].
+/// @return false if the path is too long to be the address of a Unix socket.
+static bool make_address(const char* path, sockaddr_un& address) {
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Socket path is too long: %s\n", path);
+		return false;
+	}
+	strcpy(address.sun_path, path);
+	return true;
+}
+
+static bool receive_request(int conn, Request& request) {
+	uint32_t size = 0;
+	iovec iov{&size, sizeof(size)};
+
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * NumStdFds)];
+	msghdr message{};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	ssize_t n;
+	do {
+		n = recvmsg(conn, &message, 0);
+	} while (n < 0 and errno == EINTR);
+	if (n <= 0) return false;
+
+	const cmsghdr* const header = CMSG_FIRSTHDR(&message);
+	if (header == nullptr or header->cmsg_level != SOL_SOCKET or header->cmsg_type != SCM_RIGHTS or
+		header->cmsg_len != CMSG_LEN(sizeof(int) * NumStdFds)) {
+		return false;
+	}
+	memcpy(request.fds, CMSG_DATA(header), sizeof(request.fds));
+
+	// The rest of the size may arrive after the file descriptors.
+	if (size_t(n) < sizeof(size) and
+		!read_all(conn, reinterpret_cast<char*>(&size) + n, sizeof(size) - size_t(n))) {
+		return false;
+	}
+	if (size == 0 or size > MaxRequestSize) return false;
+
+	std::string body(size, '\0');
+	if (!read_all(conn, body.data(), size) or body.back() != '\0') return false;
+
+	const size_t cwd_end = body.find('\0');
+	request.cwd = body.substr(0, cwd_end);
+	request.path = body.substr(cwd_end + 1, body.size() - cwd_end - 2);
+	return !request.cwd.empty() and !request.path.empty();
+}
+
+/// @brief Runs the script sent over [conn] in [vm], and exits. This is called in the process
+/// forked for the request, which has a copy of the server's VM.
+[[noreturn]] static void run_job(VM& vm, int conn) {
+	Request request;
+	if (!receive_request(conn, request)) _exit(1);
+
+	for (int fd = 0; fd < NumStdFds; ++fd) {
+		dup2(request.fds[fd], fd);
+		close(request.fds[fd]);
+	}
+
+	// Errors are reported here instead of by the VM, which would blame the server's script.
+	int status = 1;
+	if (chdir(request.cwd.c_str()) != 0) {
+		fprintf(stderr, "Could not change directory to: %s\n", request.cwd.c_str());
+	} else if (!std::filesystem::is_regular_file(request.path)) {
+		fprintf(stderr, "Could not read file: %s\n", request.path.c_str());
+	} else {
+		status = vm.runfile(request.path) == ExitCode::Success ? 0 : 1;
+	}
+
+	std::cout.flush();
+	fflush(nullptr);
+	write_all(conn, &status, sizeof(status));
+	// The copy of the VM and everything else in the process is thrown away at once.
+	_exit(status);
+}
+
+/// @brief Imports [modules] into [vm], so that the processes forked from the server find them in
+/// the module cache.
+static bool preload(VM& vm, const std::vector<const char*>& modules) {
+	std::string code;
+	for (const char* module : modules) {
+		if (strpbrk(module, "\"\\\n") != nullptr) {
+			fprintf(stderr, "Bad module name: %s\n", module);
+			return false;
+		}
+		code += std::string("import(\"") + module + "\")\n";
+	}
+
+	// Modules imported with a relative path are found relative to the server's directory.
+	const std::string path = (std::filesystem::current_path() / "<fork-server>").string();
+	return vm.runcode(std::move(code), path) == ExitCode::Success;
+}
+
+int run_fork_server(const char* socket_path, const std::vector<const char*>& modules) {
+	sockaddr_un address;
+	if (!make_address(socket_path, address)) return 1;
+
+	VM vm;
+	vm.load_stdlib();
+	if (!preload(vm, modules)) return 1;
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		perror("socket");
+		return 1;
+	}
+
+	// A socket left behind by a server that has exited is replaced, but nothing else is.
+	struct stat info;
+	if (lstat(socket_path, &info) == 0 and S_ISSOCK(info.st_mode)) unlink(socket_path);
+
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 or
+		listen(listener, SOMAXCONN) != 0) {
+		perror(socket_path);
+		close(listener);
+		return 1;
+	}
+
+	// Jobs report their own exit status to their client, so the server doesn't wait for them.
+	signal(SIGCHLD, SIG_IGN);
+	std::cout.flush();
+	fflush(nullptr);
+
+	while (true) {
+		const int conn = accept(listener, nullptr, nullptr);
+		if (conn < 0) {
+			if (errno != EINTR) perror("accept");
+			continue;
+		}
+
+		const pid_t pid = fork();
+		if (pid == 0) {
+			close(listener);
+			signal(SIGCHLD, SIG_DFL);
+			run_job(vm, conn);
+		}
+
+		// If the fork failed, the client sees the connection close without an exit status.
+		if (pid < 0) perror("fork");
+		close(conn);
+	}
+}
+
+int run_fork_client(const char* socket_path, const char* filepath) {
+	sockaddr_un address;
+	if (!make_address(socket_path, address)) return 1;
+
+	const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0 or connect(sock, reinterpret_cast<const sockaddr*>(&address), sizeof(address))) {
+		perror(socket_path);
+		return 1;
+	}
+
+	const std::string cwd = std::filesystem::current_path().string();
+	std::string body = cwd + '\0' + filepath + '\0';
+	const uint32_t size = body.size();
+	if (size > MaxRequestSize) {
+		fprintf(stderr, "Path is too long: %s\n", filepath);
+		return 1;
+	}
+
+	iovec iov{const_cast<uint32_t*>(&size), sizeof(size)};
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * NumStdFds)];
+	msghdr message{};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	cmsghdr* const header = CMSG_FIRSTHDR(&message);
+	header->cmsg_level = SOL_SOCKET;
+	header->cmsg_type = SCM_RIGHTS;
+	header->cmsg_len = CMSG_LEN(sizeof(int) * NumStdFds);
+	const int fds[NumStdFds] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+	memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+	ssize_t sent;
+	do {
+		sent = sendmsg(sock, &message, MSG_NOSIGNAL);
+	} while (sent < 0 and errno == EINTR);
+	if (sent < 0 or !write_all(sock, reinterpret_cast<const char*>(&size) + sent,
+							   sizeof(size) - size_t(sent)) or
+		!write_all(sock, body.data(), body.size())) {
+		perror("Could not send the script to the fork server");
+		return 1;
+	}
+
+	int status = 1;
+	if (!read_all(sock, &status, sizeof(status))) {
+		fprintf(stderr, "Script exited without an exit status: %s\n", filepath);
+		status = 1;
+	}
+	close(sock);
+	return status;
+}
+
+#else
+
+int run_fork_server(const char*, const std::vector<const char*>&) {
+	fprintf(stderr, "The fork server is not supported on this platform.\n");
+	return 1;
+}
+
+int run_fork_client(const char*, const char*) {
+	fprintf(stderr, "The fork server is not supported on this platform.\n");
+	return 1;
+}
+
+#endif
+
+} // namespace vy::cli
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+
+namespace vy::cli {
+
+/// @brief Runs a server that listens for scripts to run on the Unix socket at [socket_path]. The
+/// server starts a VM, loads the standard library and imports [modules] once, and then forks a
+/// copy of itself for every script it's sent, so that each script starts with all of that already
+/// done. The copy runs the script with the stdin, stdout and stderr of the client that sent it.
+/// @return The exit status of the cli if the server couldn't be started. Otherwise, it never
+/// returns.
+int run_fork_server(const char* socket_path, const std::vector<const char*>& modules);
+
+/// @brief Asks the fork server listening at [socket_path] to run the script at [filepath], with
+/// the stdin, stdout and stderr of this process.
+/// @return The exit status of the script.
+int run_fork_client(const char* socket_path, const char* filepath);
+
+} // namespace vy::cli
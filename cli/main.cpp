@@ -1,5 +1,13 @@
+#include "fork_server.hpp"
+#include <algorithm>
+#include <aot.hpp>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <vm.hpp>
 
 #ifdef _WIN32
@@ -56,15 +64,84 @@ static void repl() {
 	}
 }
 
-static void execfile(const char* filepath) {
+static int execfile(const char* filepath) {
 	VM vm;
 	vm.load_stdlib();
-	vm.runfile(filepath);
+	return vm.runfile(filepath) == ExitCode::Success ? 0 : 1;
+}
+
+/// @brief Runs the script at [filepath] with the profile at [profile_path]. If [record] is true,
+/// the feedback from this run is added to the profile, which is created if it doesn't exist yet.
+static int execfile_with_profile(const char* filepath, const char* profile_path, bool record) {
+	Profile profile;
+	const bool loaded = profile.load(profile_path);
+	if (!loaded and (!record or std::filesystem::exists(profile_path))) {
+		fprintf(stderr, "Could not read profile: %s\n", profile_path);
+		return 1;
+	}
+
+	VM vm;
+	vm.load_stdlib();
+	vm.profile = &profile;
+	vm.record_profile = record;
+	const int status = vm.runfile(filepath) == ExitCode::Success ? 0 : 1;
+	if (!record) return status;
+
+	vm.save_profile(profile);
+	if (!profile.save(profile_path)) {
+		fprintf(stderr, "Could not write profile: %s\n", profile_path);
+		return 1;
+	}
+	return status;
+}
+
+/// @brief Translates the functions of the module at [filepath] into C++, and writes the result to
+/// [outpath], or to stdout if it is null.
+static int emit_cpp(const char* filepath, const char* outpath) {
+	const std::string name = std::filesystem::path(filepath).stem().string();
+	const bool is_identifier =
+		!name.empty() and !isdigit(name[0]) and
+		std::all_of(name.begin(), name.end(), [](char c) { return isalnum(c) or c == '_'; });
+	if (!is_identifier) {
+		fprintf(stderr, "Module name '%s' is not a valid C++ identifier.\n", name.c_str());
+		return 1;
+	}
+
+	auto source = SourceCode::from_path(filepath);
+	if (!source.has_value()) {
+		fprintf(stderr, "Could not read file: %s\n", filepath);
+		return 1;
+	}
+
+	VM vm;
+	vm.load_stdlib();
+	const std::string code = source->code;
+	const Closure* script = vm.compile(std::move(source.value()));
+	if (script == nullptr) return 1;
+
+	const std::string cpp = aot::translate(*script->m_codeblock, code, name);
+	if (outpath == nullptr) {
+		std::cout << cpp;
+		return 0;
+	}
+
+	std::ofstream out(outpath);
+	out << cpp;
+	if (!out) {
+		fprintf(stderr, "Could not write file: %s\n", outpath);
+		return 1;
+	}
+	return 0;
 }
 
 static void info() {
 	printf("The Vyse Programming Language. v0.0.1 Pre-alpha .\n");
 	printf("Usage: vy <filename>\n");
+	printf("       vy --emit-cpp <filename> [output]\n");
+	printf("       vy --profile <profile> <filename>\n");
+	printf("       vy --use-profile <profile> <filename>\n");
+	printf("       vy --fork-server <socket> [module...]\n");
+	printf("       vy --connect <socket> <filename>\n");
 }
 
 int main(int const argc, char** const argv) {
@@ -72,7 +149,17 @@ int main(int const argc, char** const argv) {
 	if (argc == 1) {
 		repl();
 	} else if (argc == 2) {
-		execfile(argv[1]);
+		return execfile(argv[1]);
+	} else if ((argc == 3 or argc == 4) and strcmp(argv[1], "--emit-cpp") == 0) {
+		return emit_cpp(argv[2], argc == 4 ? argv[3] : nullptr);
+	} else if (argc == 4 and strcmp(argv[1], "--profile") == 0) {
+		return execfile_with_profile(argv[3], argv[2], true);
+	} else if (argc == 4 and strcmp(argv[1], "--use-profile") == 0) {
+		return execfile_with_profile(argv[3], argv[2], false);
+	} else if (argc >= 3 and strcmp(argv[1], "--fork-server") == 0) {
+		return cli::run_fork_server(argv[2], std::vector<const char*>(argv + 3, argv + argc));
+	} else if (argc == 4 and strcmp(argv[1], "--connect") == 0) {
+		return cli::run_fork_client(argv[2], argv[3]);
 	} else {
 		info();
 	}
@@ -0,0 +1,83 @@
+#pragma once
+#include "function.hpp"
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/// @file Ahead of time translation of Vyse modules to C++.
+///
+/// `translate` turns the functions of a compiled script into C++ functions that work on `Value`s
+/// directly, and emits them along with the script's source as a C++ file. The file only needs the
+/// Vyse headers to build. Built into a shared library next to the script, it is picked up by
+/// `import`: the script is compiled and run as usual, but every function that has a translation
+/// runs it instead of it's bytecode.
+///
+/// Only functions that stick to numbers, booleans and nil, local variables, control flow and calls
+/// to themselves are translated. A translated function checks the types of it's operands as it
+/// goes, and when it meets anything it doesn't handle (a value of another type, an error, a call to
+/// another function) it gives up and the call is run by the interpreter from the start. Since such
+/// functions have no side effects, this keeps the semantics of the interpreter, including it's
+/// error messages.
+
+namespace vy::aot {
+
+/// @brief A function translated to C++.
+struct Function {
+	/// Position of the function's code block in a pre-order walk of the script's code blocks,
+	/// where the script itself is at position 0.
+	u32 index;
+	/// `checksum` of the code block that was translated.
+	u32 checksum;
+	CompiledFn fn;
+};
+
+/// @brief A script whose functions have been translated to C++. A library built from the output
+/// of `translate` exports a function `aot_module_<name>` that returns it.
+struct Module {
+	/// The source code of the script that was translated.
+	const char* source;
+	const Function* functions;
+	size_t num_functions;
+};
+
+/// @brief Hashes the bytecode, constants and parameter count of [code], so that a translation is
+/// never attached to a function other than the one it was made from.
+u32 checksum(const CodeBlock& code);
+
+/// @brief Translates the functions in [script], which was compiled from [source], into C++.
+/// @param name The name of the module, which must be a valid C++ identifier.
+/// @return The source of a C++ file that defines `aot_module_<name>`.
+std::string translate(const CodeBlock& script, std::string_view source, std::string_view name);
+
+/// @brief Sets the compiled function of each code block in [script] to it's translation in
+/// [module]. The script must have been compiled from `module.source`, and not lazily.
+/// @return The number of functions that were attached.
+size_t attach(CodeBlock& script, const Module& module);
+
+/// @brief Returns the name of the symbol exporting the module [name].
+std::string export_name(std::string_view name);
+
+/// @brief Same as `a == b`. Translated code uses this instead, so that a library built from it only
+/// depends on the Vyse headers.
+inline bool equal(const Value& a, const Value& b) noexcept {
+	if (a.tag != b.tag) return false;
+	switch (a.tag) {
+	case ValueType::Number: return VYSE_AS_NUM(a) == VYSE_AS_NUM(b);
+	case ValueType::Bool: return VYSE_AS_BOOL(a) == VYSE_AS_BOOL(b);
+	case ValueType::Object: {
+		const Obj* oa = VYSE_AS_OBJECT(a);
+		const Obj* ob = VYSE_AS_OBJECT(b);
+		if (oa == ob) return true;
+		// Frozen strings aren't interned, see `operator==`.
+		if (oa->tag != ObjType::string or ob->tag != ObjType::string) return false;
+		if (!oa->is_frozen() and !ob->is_frozen()) return false;
+		const String* sa = static_cast<const String*>(oa);
+		const String* sb = static_cast<const String*>(ob);
+		return sa->len() == sb->len() and std::memcmp(sa->c_str(), sb->c_str(), sa->len()) == 0;
+	}
+	case ValueType::Nil: return true;
+	default: return false;
+	}
+}
+
+} // namespace vy::aot
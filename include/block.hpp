@@ -8,13 +8,29 @@
 namespace vy {
 
 struct Block {
+	/// @brief A run of consecutive opcodes that were all compiled from the same source line.
+	/// The run starts at [start] and ends where the next run starts.
+	struct LineRun {
+		u32 start;
+		u32 line;
+	};
+
 	std::vector<Opcode> code;
 	std::vector<Value> constant_pool;
-	std::vector<u32> lines;
+	/// @brief Line information, run length encoded. Sorted by `start`, and no two adjacent runs
+	/// are on the same line.
+	std::vector<LineRun> lines;
 
 	size_t add_instruction(Opcode i, u32 line);
 	size_t add_num(u8 i, u32 line);
 	size_t add_value(Value value);
+
+	/// @return The source line of the opcode at [index].
+	u32 line_at(size_t index) const;
+
+	/// @brief Removes [count] opcodes starting at [index]. Jumps over the removed code are not
+	/// adjusted, so this must only be used on code that nothing jumps across.
+	void remove(size_t index, size_t count);
 	size_t op_count() const noexcept {
 		return code.size();
 	}
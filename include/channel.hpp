@@ -0,0 +1,103 @@
+#pragma once
+#include "frozen.hpp"
+#include "value.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace vy {
+
+/// @brief A bounded queue of messages that can be shared by any number of VMs, each on it's own
+/// thread. Sending and receiving never take a lock: the channel is a ring buffer in which every
+/// slot carries a sequence number that tells senders and receivers whether it is theirs to use.
+///
+/// Values don't belong to any one VM while they are in a channel. Tables, lists and strings are
+/// frozen into a region of their own when they are sent, and copied into the heap of the receiving
+/// VM. Values that are already frozen are passed by reference, and cost nothing to send.
+class Channel final {
+	VYSE_NO_COPY(Channel);
+	VYSE_NO_MOVE(Channel);
+
+  public:
+	/// @brief A value in transit between two VMs.
+	struct Message {
+		Value value = VYSE_NIL;
+		/// The region [value] belongs to, if it is an object.
+		std::shared_ptr<const FrozenRegion> region;
+		/// Whether the region was made to send [value], and should be copied out on receipt.
+		bool copy = false;
+	};
+
+	/// The largest capacity a channel can be opened with.
+	static constexpr size_t MaxCapacity = size_t(1) << 20;
+
+	/// @param capacity The most messages that can wait in the channel, which is rounded up to a
+	/// power of two. Must be at most [MaxCapacity].
+	explicit Channel(size_t capacity);
+	~Channel() = default;
+
+	/// @brief Returns the channel called [name], creating it with room for [capacity] messages
+	/// if there is none. Named channels are shared by the whole process, and live until they are
+	/// closed and no VM refers to them.
+	[[nodiscard]] static std::shared_ptr<Channel> open(const std::string& name, size_t capacity);
+
+	/// @brief Makes a message out of [value].
+	/// @return false if [value] can't be sent, in which case [bad_value] is set to the first part
+	/// of it that can't be frozen.
+	[[nodiscard]] static bool pack(Value value, Message& message, Value& bad_value);
+
+	/// @brief Turns [message] back into a value that [vm] can use.
+	[[nodiscard]] static Value unpack(VM& vm, const Message& message);
+
+	/// @brief Adds [message] to the channel, unless it is full.
+	/// @return false if the channel is full.
+	bool try_send(Message& message);
+
+	/// @brief Takes the oldest message out of the channel, unless it is empty.
+	/// @return false if the channel is empty.
+	bool try_recv(Message& message);
+
+	/// @brief Adds [message] to the channel, waiting for room if it's full.
+	/// @return false if the channel was closed before the message could be sent.
+	bool send(Message& message);
+
+	/// @brief Takes the oldest message out of the channel, waiting for one if it's empty.
+	/// @return false if the channel is closed and has no messages left.
+	bool recv(Message& message);
+
+	/// @brief Closes the channel. Messages can no longer be sent, but the ones in it can still
+	/// be received. A named channel is forgotten, so that opening it again makes a new one.
+	void close();
+
+	[[nodiscard]] bool is_closed() const noexcept {
+		return m_closed.load(std::memory_order_acquire);
+	}
+
+	/// @brief The number of messages in the channel. This may be outdated as soon as it returns
+	/// if other threads are using the channel.
+	[[nodiscard]] size_t length() const noexcept;
+
+	[[nodiscard]] size_t capacity() const noexcept {
+		return m_mask + 1;
+	}
+
+  private:
+	struct Slot {
+		/// Equal to the position of the next send into this slot when it is free, and one more
+		/// than the position of the last send when it holds a message.
+		std::atomic<size_t> sequence;
+		Message message;
+	};
+
+	std::unique_ptr<Slot[]> m_slots;
+	const size_t m_mask;
+	std::string m_name;
+	std::atomic<bool> m_closed{false};
+
+	// Senders and receivers are kept on separate cache lines, so that they don't slow each
+	// other down.
+	alignas(64) std::atomic<size_t> m_send_pos{0};
+	alignas(64) std::atomic<size_t> m_recv_pos{0};
+};
+
+} // namespace vy
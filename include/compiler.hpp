@@ -5,6 +5,8 @@
 #include "scanner.hpp"
 #include "source.hpp"
 #include <array>
+#include <unordered_map>
+#include <vector>
 
 namespace vy {
 
@@ -30,6 +32,23 @@ struct LocalVar {
 	// as an upvalue. Needed at compile time only.
 	bool is_captured = false;
 
+	/// If the variable was declared with a small leaf function, then this is that function's
+	/// code, which calls through the variable may inline. Needed at compile time only.
+	CodeBlock* inline_code = nullptr;
+
+	/// Index of this variable in `Compiler::m_number_vars` if it was initialized with a number, or
+	/// -1. Needed at compile time only.
+	int number_var = -1;
+
+	/// The struct declared by this variable, if it was declared with `struct`. Needed at compile
+	/// time only.
+	StructType* struct_type = nullptr;
+
+	/// If the variable was initialized with an instance of a struct, then that struct. The variable
+	/// may hold other values later on, so field accesses through it are guarded. Needed at compile
+	/// time only.
+	StructType* instance_of = nullptr;
+
 	explicit LocalVar() noexcept {};
 	explicit LocalVar(const char* varname, u32 name_len, u8 scope_depth = 0,
 					  bool isconst = false) noexcept
@@ -40,6 +59,28 @@ struct UpvalDesc {
 	int index = -1;
 	bool is_const = false;
 	bool is_local = false;
+	/// Same as `LocalVar::inline_code` of the captured variable.
+	CodeBlock* inline_code = nullptr;
+	/// Same as `LocalVar::struct_type` and `LocalVar::instance_of` of the captured variable.
+	StructType* struct_type = nullptr;
+	StructType* instance_of = nullptr;
+};
+
+/// Identifies a number, boolean, string or struct constant by it's type and bit pattern. Strings
+/// are interned, so two equal strings have the same bits. Needed at compile time only.
+struct ConstantKey {
+	ValueType tag;
+	u64 bits;
+
+	bool operator==(const ConstantKey& other) const noexcept {
+		return tag == other.tag and bits == other.bits;
+	}
+
+	struct Hash {
+		size_t operator()(const ConstantKey& key) const noexcept {
+			return std::hash<u64>{}(key.bits) ^ size_t(key.tag);
+		}
+	};
 };
 
 struct SymbolTable {
@@ -82,6 +123,10 @@ class Compiler {
 
   public:
 	static constexpr u8 MaxLocalVars = UINT8_MAX;
+	/// Maximum number of bytes in the body of a function that can be inlined.
+	static constexpr size_t MaxInlineSize = 32;
+	/// Maximum number of values a table or list literal leaves on the stack before storing them.
+	static constexpr u8 LiteralChunkSize = 64;
 	static constexpr u8 MaxUpValues = UINT8_MAX;
 	static constexpr u8 MaxConstants = UINT8_MAX;
 	static constexpr u8 MaxFuncParams = 200;
@@ -102,12 +147,21 @@ class Compiler {
 	/// @param fname name of the function that this compiler is commpiling into.
 	explicit Compiler(VM* vm, Compiler* parent, String* fname);
 
+	/// @brief Create a compiler for the body of a function that was scanned but not compiled
+	/// because `VM::lazy_compile` was set. The bytecode is written into [code] itself.
+	explicit Compiler(VM* vm, CodeBlock& code);
+
 	~Compiler();
 
 	/// @brief Compile a top level script
 	/// @return a function's codeblock containing the bytecode for the script.
 	[[nodiscard]] CodeBlock* compile();
 
+	/// @brief Compile the function whose code block this compiler was created with. Once the
+	/// function has been compiled, it is no longer lazy.
+	/// @return true if there were no errors.
+	bool compile_lazy();
+
 	/// @brief returns true if the compiler has encountered an error while compiling
 	/// the source.
 	bool ok() const noexcept;
@@ -142,6 +196,42 @@ class Compiler {
 		u32 scope_depth;
 	};
 
+	/// @brief A run of consecutive `match` arms whose patterns are all constants. The arms are
+	/// compiled one after the other, preceded by a jump over all of them to a single dispatch
+	/// instruction (`jump_table` or `match_table`) that is emitted once the run ends.
+	struct MatchSegment {
+		/// Maps each pattern to the index of the first instruction of it's arm.
+		/// This is nullptr when there is no open segment.
+		Table* targets = nullptr;
+		/// Index of [targets] in the constant pool.
+		u32 const_index = 0;
+		/// The jump over the arms to the dispatch instruction.
+		size_t skip_jump = 0;
+		/// True if all patterns are integers, in which case they may be dispatched
+		/// with a `jump_table` instead.
+		bool all_integers = true;
+		number min = 0;
+		number max = 0;
+		u32 num_patterns = 0;
+	};
+
+	/// @brief A local variable that is assumed to only ever hold numbers. It stays a number as long
+	/// as every value assigned to it is, and the numbers assigned to it may depend on other number
+	/// variables.
+	struct NumberVar {
+		bool is_number = true;
+		/// Indices in `m_number_vars` of the variables this one stays a number only if they do.
+		std::vector<u32> deps;
+	};
+
+	/// @brief An unchecked arithmetic or comparison instruction, which must be turned back into
+	/// it's checked form if any of the variables it relies on turns out to not be a number.
+	struct UncheckedOp {
+		size_t index;
+		Opcode checked_op;
+		std::vector<u32> deps;
+	};
+
 	VM* m_vm;
 	CodeBlock* m_codeblock;
 	Compiler* const m_parent = nullptr;
@@ -152,6 +242,58 @@ class Compiler {
 	/// the stack effects of emitted instructions.
 	s64 m_stack_size = 0;
 
+	/// Stack slot of the variadic parameter of the function being compiled, or -1 if there is
+	/// none.
+	int m_rest_slot = -1;
+
+	/// Index right after the last `vararg_pack` emitted for a read of the variadic parameter, or 0.
+	/// A read that is directly followed by a '#', '[]' or '...' is rewritten into a vararg
+	/// instruction that doesn't need the list.
+	size_t m_rest_load_end = 0;
+
+	/// The inlinable function loaded by the last instruction emitted, and the index right after
+	/// that instruction. A call made right after the load may be inlined.
+	CodeBlock* m_inline_callee = nullptr;
+	size_t m_inline_callee_end = 0;
+
+	/// The last function expression compiled, and the index right after it's `make_func`.
+	CodeBlock* m_last_func = nullptr;
+	size_t m_last_func_end = 0;
+
+	/// Constant index of the field name read by the last `table_get` emitted, and the index right
+	/// after it. A call to `x.name(arg)` made right after may be compiled to an intrinsic.
+	u8 m_field_get_name = 0;
+	size_t m_field_get_end = 0;
+
+	/// The struct loaded by the last instruction emitted, and the index right after that
+	/// instruction. A call made right after the load creates an instance of the struct.
+	StructType* m_struct_callee = nullptr;
+	size_t m_struct_callee_end = 0;
+
+	/// The struct that the last expression compiled is expected to be an instance of, and the index
+	/// right after it. A field of that struct accessed right after is read from it's slot.
+	StructType* m_struct_value = nullptr;
+	size_t m_struct_value_end = 0;
+
+	/// The structs declared in the function being compiled, in order. Fields of values whose type
+	/// isn't known are guessed to be in the last struct declared here or in an enclosing function
+	/// that has a field with that name.
+	std::vector<StructType*> m_struct_types;
+
+	/// Index right after the last expression that evaluates to a number, or 0. The expression is a
+	/// number as long as the variables in [m_number_deps] are.
+	size_t m_number_end = 0;
+	std::vector<u32> m_number_deps;
+
+	/// Local variables initialized with numbers, and the unchecked instructions that rely on them.
+	/// Since a variable can be reassigned after the code reading it has been compiled (e.g in a
+	/// loop), the types are only settled once the whole function has been compiled.
+	std::vector<NumberVar> m_number_vars;
+	std::vector<UncheckedOp> m_unchecked_ops;
+
+	/// Index of each number, boolean and string in the constant pool.
+	std::unordered_map<ConstantKey, u32, ConstantKey::Hash> m_constant_slots;
+
 	const SourceCode* m_source;
 	bool has_error = false;
 	/// The scanner object that this compiler draws tokens from. This is a pointer
@@ -189,6 +331,16 @@ class Compiler {
 	/// @brief Compile a function's body (if this is a child compiler).
 	CodeBlock* compile_func(bool is_arrowfn = false);
 
+	/// @brief Compiles the parameter list of the function this compiler is compiling, up to and
+	/// including the '->' of an arrow function.
+	/// @return false if the function has too many parameters.
+	bool param_list(bool is_method, bool is_arrow);
+
+	/// @brief Skips over a function's body without compiling it, capturing every variable of an
+	/// enclosing function that the body may refer to as an upvalue, and recording it's name in
+	/// [lazy]. Used when compiling lazily.
+	void scan_func_body(LazyBody& lazy);
+
 	/// @brief Jump straight to the end of input.
 	void goto_eof();
 
@@ -202,6 +354,8 @@ class Compiler {
 	void for_stmt();				// for ID = EXP, EXP (, EXP)? STMT
 	void break_stmt();				// BREAK
 	void continue_stmt();			// CONTINUE
+	void match_stmt();				// match EXPR '{' ARM* (else '->' STMT)? '}'
+	void struct_decl();				// struct ID '{' (ID (',' ID)* ','?)? '}'
 	void fn_decl();					// fn (ID|SUFFIXED_EXPR) BLOCK
 	void ret_stmt();				// return EXPR?
 	void expr_stmt();				// FUNCALL | ASSIGN
@@ -235,8 +389,10 @@ class Compiler {
 	void suffix_expr(); // '['EXPR']' | '.'ID | '('ARGS')' | :ID'('')'
 
 	/// @brief Compiles the arguments for a call expression. The current token
-	/// must be the opening '(' for the argument
-	void compile_args(bool is_method = false); // EXPR (',' EXPR)*
+	/// must be the opening '(' for the argument.
+	/// For method calls, the receiver must already be on the stack, and [method_name] is the index
+	/// of the method's name in the constant pool.
+	void compile_args(bool is_method = false, u8 method_name = 0); // EXPR (',' EXPR)*
 	void grouping();						   // '('expr')'
 	void primary();							   // LITERAL | ID
 	void variable(bool can_assign);			   // ID
@@ -244,9 +400,11 @@ class Compiler {
 	void func_expr(String* fname, bool is_method = false, bool is_arrow = false); // fn NAME? BLOCK
 
 	/// @brief compiles a table, assuming the opening '{' has been consumed.
+	/// Leading fields with identifier keys are compiled into a shape for `table_from_shape`.
 	void table();
 
 	/// @brief compiles an array, asuming the opening '[' has been consumed.
+	/// Items are appended in chunks of up to [LiteralChunkSize] with `list_append_n`.
 	void array();
 
 	/// @brief Compiles a variable assignment RHS, assumes the
@@ -271,6 +429,28 @@ class Compiler {
 	///	constant pool as an operand too.
 	void table_assign(Opcode get_op, int idx);
 
+	/// @brief Compiles a single arm of a match statement. [subject] is the stack slot of the
+	/// value being matched and [pending] is a list used to hold the arm's constant patterns until
+	/// it's known whether the arm can be added to [segment].
+	/// ARM := PATTERN (',' PATTERN)* '->' STMT
+	void match_arm(MatchSegment& segment, int subject, List& pending,
+				   std::vector<size_t>& end_jumps);
+
+	/// @brief Compiles the body of a match arm in it's own scope, since the locals it declares
+	/// are only pushed when the arm runs.
+	void match_arm_body();
+
+	/// @brief Returns true if the next pattern of a match arm is a literal number, string or
+	/// boolean by itself.
+	bool is_constant_pattern();
+
+	/// @brief Adds the constant [pattern] to [segment], mapping it to the arm starting at
+	/// instruction [target], unless an earlier arm already has that pattern.
+	void add_segment_pattern(MatchSegment& segment, Value pattern, u32 target);
+
+	/// @brief If [segment] is open, then emits it's dispatch instruction and closes it.
+	void close_segment(MatchSegment& segment, int subject);
+
 	void enter_block() noexcept;
 
 	/// Emit pop and close instructions for the variables and upvalues
@@ -309,7 +489,71 @@ class Compiler {
 	/// @brief If this compiler is compiling a function body, then
 	/// reserve a stack slot for the parameter, and add the parameter
 	/// name to the symbol table.
-	void add_param(const Token& token);
+	/// @return The stack slot of the parameter.
+	int add_param(const Token& token);
+
+	/// @brief Returns true if the last instruction emitted is a `vararg_pack` that reads the
+	/// variadic parameter by itself, i.e not as part of a larger expression.
+	bool is_rest_load() const noexcept;
+
+	/// @brief If the last instruction emitted reads the variadic parameter by itself, replaces it
+	/// with [op], which takes the same operand.
+	/// @return true if the instruction was replaced.
+	bool replace_rest_load(Opcode op);
+
+	/// @brief Turns the `vararg_pack` at [pack_index], and the index expression compiled after it,
+	/// into the index expression followed by a `vararg_get`.
+	void rest_subscript(size_t pack_index);
+
+	/// @brief Returns the size of the expression returned by [code] if the function can be
+	/// inlined, or 0 if it can't. Only leaf functions without upvalues whose body is a single
+	/// `return` of an expression built from their parameters, constants and globals are inlined.
+	static size_t inline_body_size(const CodeBlock& code);
+
+	/// @brief If the variable in [slot] was just initialized with a function that can be inlined,
+	/// then records that function in the variable.
+	void set_inline_code(int slot);
+
+	/// @brief Emits the body of [callee] in place of a call to it with [argc] arguments, guarded
+	/// by a check that the called value is still a closure of [callee].
+	void emit_inline_call(CodeBlock& callee, u32 argc);
+
+	/// @brief Returns the intrinsic that a call to the field or method whose name is at
+	/// [name_index] in the constant pool may be, or `Intrinsic::none`. The call must pass a single
+	/// argument, which for methods is the receiver.
+	Intrinsic find_intrinsic(u8 name_index, bool is_method) const;
+
+	/// @brief Returns the slot of the field [name] in the struct that the expression compiled last
+	/// is expected to be an instance of, and sets [type] to that struct. Returns -1 if no struct
+	/// is expected to have that field.
+	int struct_field(const Token& name, StructType*& type);
+
+	/// @brief Emits [op], which is `struct_get` or `struct_set`, for the field in [slot] of [type].
+	void emit_struct_op(Opcode op, StructType& type, int slot);
+
+	/// @brief Records that the instruction just emitted finishes an expression that evaluates to a
+	/// number as long as the variables in [deps] do.
+	void mark_number(std::vector<u32> deps);
+
+	/// @brief If the last instruction emitted finishes an expression that evaluates to a number,
+	/// adds the variables it relies on to [deps] and returns true.
+	bool number_expr(std::vector<u32>& deps) const;
+
+	/// @brief Marks a read of the local variable in [slot] as a number, if it is one.
+	void read_number_var(int slot);
+
+	/// @brief Records the value just compiled as being assigned to the local in [slot], or
+	/// used to initialize it when [is_init] is true.
+	void assign_number_var(int slot, bool is_init);
+
+	/// @brief Emits the binary operator [op]. If [lhs_deps] is not null, then the left operand
+	/// is a number relying on those variables, and if the right operand is one as well then an
+	/// unchecked instruction is emitted.
+	void emit_binary_op(Opcode op, const Token& op_token, const std::vector<u32>* lhs_deps);
+
+	/// @brief Once the function has been compiled, finds all number variables that may hold
+	/// other values, and patches the unchecked instructions that rely on them.
+	void settle_number_types();
 
 	/// @brief Adds the 'self' parameter to the list of
 	/// locals, reserving a stack slot for it at runtime.
@@ -330,12 +574,18 @@ class Compiler {
 	/// If no upvalue is found, returns -1.
 	int find_upvalue(const Token& name);
 
+	/// Find an upvalue of a lazily compiled function by it's name token, among the variables
+	/// captured when the function was scanned. Returns -1 if there is none.
+	int find_lazy_upvalue(const Token& name) const;
+
 	inline void emit(Opcode op);
 	inline void emit(Opcode a, Opcode b);
 	inline void emit(Opcode op, const Token& token);
 	inline void emit_arg(u8 arg);
 	inline void emit_with_arg(Opcode opm, u8 arg);
 
+	/// @brief Adds [value] to the constant pool and returns it's index. Numbers, booleans, strings
+	/// and structs that are already in the pool are not added again.
 	size_t emit_value(Value value);
 
 	/// @brief returns the length of a string after considering the
@@ -346,6 +596,9 @@ class Compiler {
 	/// considered as single chars.
 	int src_string_len(const char* srcbuf, int srclen);
 	u32 emit_string(const Token& token);
+
+	/// @brief Creates the string for a string literal token, with escape sequences resolved.
+	String& string_literal(const Token& token);
 	u32 emit_id_string(const Token& token);
 
 	/// @brief returns the corresponding bytecode
@@ -0,0 +1,64 @@
+#pragma once
+#include "common.hpp"
+#include "forward.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vy {
+
+/// The largest width or precision that a format spec may ask for.
+constexpr u32 MaxFormatWidth = 1 << 16;
+
+/// @brief The parsed `[[fill]align][sign][0][width][.precision][type]` part of a
+/// replacement field, i.e everything after the ':' in `{0:>8.2f}`.
+struct FormatSpec {
+	char fill = ' ';
+	/// @brief One of '<', '>', '^'. When absent (0), numbers are right aligned
+	/// and everything else is left aligned.
+	char align = 0;
+	/// @brief '+' to always print the sign of a number, '-' (default) otherwise.
+	char sign = '-';
+	/// @brief Pad numbers with zeroes between the sign and the digits.
+	bool zero_pad = false;
+	u32 width = 0;
+	/// @brief Digits after the decimal point for numbers, or the maximum number
+	/// of characters for strings. -1 when not specified.
+	int precision = -1;
+	/// @brief One of 'f', 'e', 'g', 'd', 'x', 'X', 'o', 'b', 's' or 0 for the default.
+	char type = 0;
+};
+
+/// @brief A piece of a format string. Either a run of literal text or a
+/// replacement field that renders one of the arguments.
+struct FormatPiece {
+	/// @brief Index of the argument to render, or -1 if this is literal text.
+	int arg_index = -1;
+	/// @brief Offset and length of the literal text in the format string.
+	u32 offset = 0;
+	u32 length = 0;
+	FormatSpec spec;
+};
+
+/// @brief A format string that has been broken down into pieces. Compiling a format string is
+/// done only once, after which the template can be used to render any number of argument lists.
+struct FormatTemplate {
+	std::vector<FormatPiece> pieces;
+	/// @brief The minimum number of arguments needed to render this template.
+	u32 num_args = 0;
+	/// @brief The total length of all literal text, used to size the output buffer.
+	size_t literal_length = 0;
+};
+
+/// @brief Compiles the format string [fmt] into [out]. Replacement fields are written as
+/// `{}` (next argument), `{N}` (Nth argument) or either of those followed by a ':' and a format
+/// spec. `{{` and `}}` are literal braces.
+/// @return An empty string on success, or a description of what is wrong with the format string.
+std::string compile_format(std::string_view fmt, FormatTemplate& out);
+
+/// @brief Renders [value] according to [spec] and appends the result to [out].
+/// @return An empty string on success, or an error message if the value can't be formatted with
+/// the requested type.
+std::string format_value(std::string& out, Value value, const FormatSpec& spec);
+
+} // namespace vy
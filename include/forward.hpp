@@ -20,9 +20,13 @@ class CodeBlock;
 class Closure;
 class CClosure;
 class Upvalue;
+class StructType;
+class Struct;
+class FrozenRegion;
 
 enum class ObjType : unsigned char;
 enum class ValueType : unsigned char;
+enum class Intrinsic : unsigned char;
 
 /// @brief Functions that are called from a snap script but are implemented in C++.
 using NativeFn = Value (*)(VM& vm, int argc);
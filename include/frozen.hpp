@@ -0,0 +1,74 @@
+#pragma once
+#include "value.hpp"
+#include <memory>
+#include <vector>
+
+namespace vy {
+
+/// @brief A deeply immutable copy of a graph of tables, lists, strings and primitive values, made
+/// by `freeze`, or of a function along with everything it refers to, made by `freeze_code`. The
+/// objects in a region don't belong to any VM: they are never traced or collected by a garbage
+/// collector, and are freed along with the region. Since nothing writes to a frozen object (not
+/// even the GC, to mark it), a region can be read by any number of VMs on any number of threads
+/// without locking. Regions are shared with a `std::shared_ptr`. A VM keeps the regions adopted by
+/// it's host until it is destroyed, and the ones made or received by scripts until the garbage
+/// collector finds no more references to them.
+class FrozenRegion final : public std::enable_shared_from_this<FrozenRegion> {
+	VYSE_NO_COPY(FrozenRegion);
+	VYSE_NO_MOVE(FrozenRegion);
+
+  public:
+	/// @brief Copies [value] along with every table, list and string reachable from it into a new
+	/// region. Sharing and cycles in the graph are preserved in the copy. Objects that are already
+	/// frozen aren't copied: the new region refers to them, and keeps their regions alive.
+	/// @return The new region, or nullptr if the graph contains a value that can't be frozen
+	/// (a function, userdata or struct). In that case [bad_value] is set to the first such value.
+	[[nodiscard]] static std::shared_ptr<const FrozenRegion> freeze(Value value, Value& bad_value);
+
+	/// @brief Like `freeze`, but the graph may also contain functions, which are copied along with
+	/// their code and the values of the variables they captured. A VM that adopts the region can
+	/// call the copies. Functions that are still lazy are compiled in [vm] first.
+	/// @return nullptr if the graph contains userdata, a struct instance, or a function that
+	/// assigns to a variable it captured. [bad_value] is set to the first such value.
+	[[nodiscard]] static std::shared_ptr<const FrozenRegion> freeze_code(VM& vm, Value value,
+																		  Value& bad_value);
+
+	~FrozenRegion();
+
+	/// @return The region that the frozen [object] belongs to.
+	[[nodiscard]] static std::shared_ptr<const FrozenRegion> of(const Obj& object);
+
+	/// @brief Like `of`, but without taking a reference to the region.
+	[[nodiscard]] static const FrozenRegion& owner(const Obj& object) noexcept;
+
+	/// @brief Copies the objects of a region made by `freeze` into [vm], as objects of the VM that
+	/// can be modified. Objects of other regions that this one refers to aren't copied, and their
+	/// regions are adopted by [vm] instead.
+	/// @return The copy of the root.
+	[[nodiscard]] Value thaw(VM& vm) const;
+
+	/// @brief The frozen copy of the value that the region was made from.
+	[[nodiscard]] Value root() const noexcept {
+		return m_root;
+	}
+
+	/// @brief The number of bytes taken by the objects in the region.
+	[[nodiscard]] size_t size() const noexcept {
+		return m_size;
+	}
+
+  private:
+	FrozenRegion() noexcept = default;
+
+	/// @brief Makes a region from [value]. Functions can only be frozen if [vm] is not nullptr.
+	static std::shared_ptr<const FrozenRegion> make(Value value, Value& bad_value, VM* vm);
+
+	Value m_root;
+	/// All objects in the region, which it frees when it is destroyed.
+	std::vector<Obj*> m_objects;
+	/// The other regions that objects in this one refer to.
+	std::vector<std::shared_ptr<const FrozenRegion>> m_dependencies;
+	size_t m_size = 0;
+};
+
+} // namespace vy
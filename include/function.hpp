@@ -1,18 +1,50 @@
 #pragma once
+#include "source.hpp"
 #include "string.hpp"
 #include "upvalue.hpp"
+#include <memory>
+#include <unordered_set>
+#include <vector>
 
 namespace vy {
 
+/// @brief The source of a function that has been scanned, but not compiled yet.
+struct LazyBody {
+	struct Upvalue {
+		std::string name;
+		bool is_const;
+	};
+
+	/// The function's source, starting at it's parameter list and ending at the '}' that closes
+	/// it's body.
+	SourceCode source;
+	/// Line on which the parameter list starts.
+	u32 line = 1;
+	bool is_method = false;
+	/// Names of the variables captured by the function, in the order of it's upvalues.
+	std::vector<Upvalue> upvals;
+};
+
+/// @brief A function that was translated from Vyse to C++ ahead of time (see `aot.hpp`). [frame]
+/// holds the callee followed by it's arguments. Writes the return value to [result] and returns
+/// true, or returns false without any side effects if the call must run in the interpreter instead.
+/// [depth] is the number of nested calls the function may make before the call stack overflows.
+using CompiledFn = bool (*)(const Value* frame, u32 depth, Value& result);
+
 // A protoype is the body of a function that contains the bytecode and other relevant information.
 class CodeBlock final : public Obj {
 	friend Compiler;
+	friend Obj;
 
   public:
 	explicit CodeBlock(String* funcname) noexcept : Obj{ObjType::codeblock}, m_name{funcname} {};
 	explicit CodeBlock(String* funcname, u32 param_count) noexcept
 		: Obj{ObjType::codeblock}, m_name{funcname}, m_num_params{param_count} {};
 
+	/// @brief Makes a copy of the compiled function [other], named [name]. The copy starts out
+	/// with the same constants as [other], which the caller may replace.
+	explicit CodeBlock(String* name, const CodeBlock& other);
+
 	~CodeBlock(){};
 
 	[[nodiscard]] constexpr const String* name() const noexcept {
@@ -37,7 +69,7 @@ class CodeBlock final : public Obj {
 		return m_num_params;
 	}
 
-	[[nodiscard]] size_t size() const override {
+	[[nodiscard]] size_t size() const {
 		return sizeof(CodeBlock);
 	}
 
@@ -45,10 +77,33 @@ class CodeBlock final : public Obj {
 		return max_stack_size;
 	}
 
+	[[nodiscard]] constexpr u32 upval_count() const noexcept {
+		return m_num_upvals;
+	}
+
 	[[nodiscard]] constexpr bool is_vararg() const noexcept {
 		return m_is_variadic;
 	}
 
+	/// @brief Whether the varargs are always collected into a list when this function is called,
+	/// rather than being left on the stack for the `vararg_*` instructions to read.
+	[[nodiscard]] constexpr bool collects_varargs() const noexcept {
+		return m_collects_varargs;
+	}
+
+	/// @brief Whether this function assigns to any of the variables it captured.
+	[[nodiscard]] constexpr bool assigns_upvals() const noexcept {
+		return m_assigns_upvals;
+	}
+
+	/// @brief Whether this function's body still has to be compiled before it can be called.
+	[[nodiscard]] bool is_lazy() const noexcept {
+		return m_lazy != nullptr;
+	}
+
+	/// @brief A C++ translation of this function, run instead of the bytecode when it is called.
+	CompiledFn m_compiled = nullptr;
+
   private:
 	String* const m_name;
 	u32 m_num_params = 0;
@@ -60,19 +115,29 @@ class CodeBlock final : public Obj {
 
 	/// @brief Whether this function accepts a varying number of arguments.
 	bool m_is_variadic = false;
+	/// @brief Set by the compiler when the variadic parameter is assigned to or captured by a
+	/// closure, as the parameter's slot must then always hold the list of varargs.
+	bool m_collects_varargs = false;
+	/// @brief Set by the compiler when the function contains a `set_upval` instruction.
+	bool m_assigns_upvals = false;
 
-	void trace(GC& gc) override;
+	/// @brief The source of the function's body if it hasn't been compiled yet, else nullptr.
+	std::unique_ptr<LazyBody> m_lazy;
+
+	void trace(GC& gc);
 };
 
 /// @brief A closure has two parts, code and data. The code part is represented by the prototype
 /// containing all the bytecode instructions and the data part is represented by the upvalues vector
 /// holding all the captured variables from enclosing scopes.
 class Closure final : public Obj {
+	friend Obj;
+
   public:
 	CodeBlock* const m_codeblock;
 
 	explicit Closure(CodeBlock* proto, u32 upval_count) noexcept;
-	~Closure() override{};
+	~Closure(){};
 
 	[[nodiscard]] constexpr const String* name() const noexcept {
 		return m_codeblock->name();
@@ -84,7 +149,7 @@ class Closure final : public Obj {
 
 	/// @brief returns the Upvalue at index [idx] in the
 	/// upvalue list.
-	[[nodiscard]] Upvalue* get_upval(u32 idx) noexcept {
+	[[nodiscard]] Upvalue* get_upval(u32 idx) const noexcept {
 		VYSE_ASSERT(idx < m_upvals.size(), "Invalid upvalue index.");
 		return m_upvals[idx];
 	}
@@ -92,24 +157,31 @@ class Closure final : public Obj {
 	/// @brief sets the Upvalue at index [idx] in the upvalue list to the given Upvalue.
 	void set_upval(u32 idx, Upvalue* uv);
 
-	[[nodiscard]] size_t size() const override {
+	[[nodiscard]] size_t size() const {
 		return sizeof(Closure);
 	}
 
   private:
 	std::vector<Upvalue*> m_upvals;
-	void trace(GC& gc) override;
+	void trace(GC& gc);
 };
 
 /// TODO: Upvalues for CFunctions.
 
+/// @brief Builtin functions that the VM can run in place of a call. A call site compiled to an
+/// intrinsic instruction checks that the callee is still the tagged builtin, and falls back to a
+/// regular call if it isn't, or if the arguments aren't of the expected types.
+enum class Intrinsic : u8 { none, sqrt, floor, ceil, abs, sin, cos, list_pop };
+
 class CClosure final : public Obj {
+	friend Obj;
+
   public:
 	explicit CClosure(NativeFn fn, List* const values = nullptr) noexcept
 		: Obj(ObjType::c_closure), m_values{values}, m_func{fn} {}
-	~CClosure() override = default;
+	~CClosure() = default;
 
-	[[nodiscard]] size_t size() const override {
+	[[nodiscard]] size_t size() const {
 		return sizeof(CClosure);
 	}
 
@@ -120,9 +192,37 @@ class CClosure final : public Obj {
 	/// @brief A list of values that the c-closure can use in whichever way it wants.
 	List* m_values = nullptr;
 
+	/// @brief The intrinsic this closure implements, if any.
+	Intrinsic m_intrinsic = Intrinsic::none;
+
   private:
 	const NativeFn m_func;
-	void trace(GC& gc) override;
+	void trace(GC& gc);
 };
 
-} // namespace vy
\ No newline at end of file
+/// @brief Calls [visit] with [code] and every function nested in it, in pre-order, along with the
+/// position of each. A function that is referenced by more than one code block (e.g by a call
+/// site that inlined it) is only visited the first time. The functions nested in a code block are
+/// found after it has been visited, so [visit] may compile a lazy function to walk into it.
+template <typename Code, typename Visit>
+void walk_code_blocks(Code& code, const Visit& visit) {
+	std::unordered_set<const CodeBlock*> seen;
+	u32 index = 0;
+
+	std::vector<Code*> stack{&code};
+	while (!stack.empty()) {
+		Code* const current = stack.back();
+		stack.pop_back();
+		if (!seen.insert(current).second) continue;
+
+		visit(*current, index++);
+
+		// Push the children in reverse, so that they are visited in the order they appear in.
+		const auto& constants = current->block().constant_pool;
+		for (auto it = constants.rbegin(); it != constants.rend(); ++it) {
+			if (VYSE_IS_CODEBLOCK(*it)) stack.push_back(VYSE_AS_PROTO(*it));
+		}
+	}
+}
+
+} // namespace vy
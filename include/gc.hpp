@@ -65,6 +65,9 @@ class GC {
 	/// marking all objects and coloring them gray.
 	void mark();
 
+	/// @brief Keeps the region of the [frozen] object alive through this cycle.
+	void mark_region(const Obj& frozen);
+
 	/// Marks all the roots reachable from the compiler chain.
 	void mark_compiler_roots();
 
@@ -8,10 +8,25 @@ namespace vy {
 
 struct StdModule;
 
+namespace aot {
+struct Module;
+}
+
 static constexpr const char* ModuleCacheName = "__modulecache__";
 static constexpr const char* VMLoadersName = "__loaders__";
 static constexpr const char* VyseEnvVar = "VYSE_PATH";
 
+/// @brief A function that fills [module] with the fields of a native module.
+using NativeModuleLoader = void (*)(VM* vm, Table* module);
+
+/// @brief Makes [load] the native module [name] of every VM in the process, so that `import(name)`
+/// finds it without searching the filesystem. The module's table is built once, by the first VM
+/// that imports it, and frozen along with it's functions. Every import after that gets a copy of
+/// the frozen table, whose functions are shared by all VMs. A module whose table can't be frozen
+/// (e.g because it holds userdata) is built again by every VM that imports it instead.
+/// Registering a name again replaces the module for the imports that follow.
+void register_native_module(const char* name, NativeModuleLoader load);
+
 class DynLoader final {
 	VYSE_NO_MOVE(DynLoader);
 	VYSE_NO_COPY(DynLoader);
@@ -28,14 +43,32 @@ class DynLoader final {
 	/// These loader functions are used by the 'import' builtin
 	void init_loaders(VM& vm) const;
 
-	/// @brief Read a standard library module and return the value returned by it.
-	Value read_std_lib(VM& vm, const StdModule& module);
+	/// @brief Finds the function that loads a standard library module in the module's shared
+	/// library. Shared libraries are opened once per process, and their handles are shared by every
+	/// VM.
+	/// @return nullptr if the library or the function couldn't be found.
+	NativeModuleLoader find_std_lib(const StdModule& module) const;
+
+	/// @brief Finds the C++ translation of the Vyse module at [path]. Translations made with
+	/// `vy --emit-cpp` are read from a shared library named after the module, placed next to it.
+	/// @return nullptr if the module has not been translated.
+	const aot::Module* find_compiled_module(const std::string& path);
+
+	/// @brief Makes [module] the C++ translation of the Vyse module at [path]. This is used when
+	/// the translation is linked into the host program instead of being built as a shared library.
+	void add_compiled_module(const std::string& path, const aot::Module& module);
 
   private:
-	/// @brief A cache to avoid re-reading (.dll/.so/.a)s that have already been read.
-	/// Map of module name -> module handle.
+	/// @brief Handles of the shared libraries holding C++ translations of modules, which are kept
+	/// open for as long as the VM may call the translated functions.
+	/// Map of module path -> library handle.
 	std::unordered_map<std::string, Lib> cached_dyn_libs;
 
+	/// @brief Map of module path -> C++ translation of the module, or nullptr if the module has no
+	/// translation. Lookups that failed are cached too, so that the filesystem is only searched
+	/// once per module.
+	std::unordered_map<std::string, const aot::Module*> compiled_modules;
+
 	/// @brief Path to the directory where all the standard library shared modules
 	/// are placed. This is extracted via the VYSE_PATH environment variable.
 	std::string std_dlls_path;
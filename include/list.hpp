@@ -5,10 +5,15 @@
 namespace vy {
 
 class List final : public Obj {
+	friend Obj;
+
   public:
-	static constexpr size_t DefaultCapacity = 8;
+	/// @brief The capacity of the values buffer when the first item is added.
+	static constexpr size_t MinCapacity = 4;
 	static constexpr uint GrowthFactor = 2;
 
+	/// @brief Creates an empty list. The values buffer is only allocated once the first item is
+	/// added.
 	List() : Obj(ObjType::list){};
 	List(size_t mincap);
 
@@ -18,6 +23,13 @@ class List final : public Obj {
 	/// This increments the current item count by 1.
 	void append(Value value);
 
+	/// @brief appends the [count] values starting at [values] to the end of the array.
+	void append_n(const Value* values, size_t count);
+
+	/// @brief inserts [value] at position [index] (which may be equal to `length()`),
+	/// shifting all the items after it one place to the right.
+	void insert(size_t index, Value value);
+
 	/// @brief pops an element from the end of the
 	/// array and returns it. If the array is empty,
 	/// returns nil.
@@ -38,7 +50,7 @@ class List final : public Obj {
 		return index >= 0 and index < m_num_entries;
 	}
 
-	virtual size_t size() const noexcept override {
+	size_t size() const noexcept {
 		return sizeof(List) + m_capacity * sizeof(Value);
 	}
 
@@ -46,6 +58,9 @@ class List final : public Obj {
 	/// more insertion. Ths may grow the list.
 	void ensure_capacity();
 
+	/// @brief Grows the list so that it can hold [num_items] items without reallocating.
+	void reserve(size_t num_items);
+
 	Value at(size_t index) const noexcept {
 		return m_values[index];
 	}
@@ -60,12 +75,19 @@ class List final : public Obj {
 		return m_values[index];
 	}
 
+	/// @brief returns a pointer to the first of the `length()` contiguous values
+	/// stored in this list. Native functions can use this to walk a list directly.
+	const Value* data() const noexcept {
+		return m_values;
+	}
+
   private:
-	size_t m_capacity = DefaultCapacity;
+	size_t m_capacity = 0;
 	size_t m_num_entries = 0;
-	Value* m_values = (Value*)malloc(DefaultCapacity * sizeof(Value));
+	/// @brief The values buffer, which is null until an item is added.
+	Value* m_values = nullptr;
 
-	virtual void trace(GC& gc) noexcept override;
+	void trace(GC& gc) noexcept;
 };
 
 } // namespace vy
@@ -20,12 +20,12 @@ constexpr auto Op_0_operands_start = Opcode::pop;
 constexpr auto Op_0_operands_end = Opcode::index_no_pop;
 
 constexpr auto Op_const_start = Opcode::load_const;
-constexpr auto Op_const_end = Opcode::table_get_no_pop;
+constexpr auto Op_const_end = Opcode::table_from_shape;
 
 /// numerically lowest opcode that takes one operand
 constexpr auto Op_1_operands_start = Opcode::set_var;
 /// numerically highest opcode that takes one operand
-constexpr auto Op_1_operands_end = Opcode::call_func;
+constexpr auto Op_1_operands_end = Opcode::call_spread;
 
 constexpr auto Op_2_operands_start = Opcode::jmp;
 constexpr auto Op_2_operands_end = Opcode::for_loop;
@@ -0,0 +1,127 @@
+#pragma once
+#include "function.hpp"
+#include "source.hpp"
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// @file Type feedback profiles.
+///
+/// A VM with `record_profile` set counts the calls and loop iterations of every function it runs,
+/// and notes what each call site with one argument called, and what kind of struct each struct
+/// field site was used on. `VM::save_profile` writes this down in a `Profile`, which can be saved
+/// to a file.
+///
+/// A VM given a profile uses it to prepare each script it compiles before it starts running:
+/// every function that ran when the profile was recorded is compiled up front even if
+/// `lazy_compile` is set, a call site that always called the same builtin becomes an intrinsic
+/// call of it, and a struct field site is pointed at the struct type that was actually seen there.
+/// Each of these instructions checks it's guess and falls back to the generic path, so a
+/// profile only ever changes how fast a script runs, and never what it does.
+///
+/// Functions are identified by their position in a pre-order walk of the script's code blocks
+/// (see `walk_code_blocks`), and sites by their offset in the function's bytecode. Both only line
+/// up when the script is compiled from the same source, so a profile is matched with a script by
+/// a hash of it's source, and with each function by a checksum of it's bytecode.
+
+namespace vy {
+
+class ProfileRecorder;
+
+class Profile final {
+  public:
+	/// @brief What a call or struct field site was seen to work on.
+	struct Site {
+		enum class Kind : u8 { call, field };
+		Kind kind;
+		/// The name of the intrinsic a call site called, or of the struct type a field site was
+		/// used on. Empty if the site saw anything else, or more than one of them.
+		std::string target;
+	};
+
+	/// @brief The feedback recorded for a single function.
+	struct Function {
+		/// `aot::checksum` of the function's bytecode, before it was specialized.
+		u32 checksum = 0;
+		/// Whether the function had been compiled, i.e it wasn't still lazy.
+		bool compiled = false;
+		u64 calls = 0;
+		/// The number of times a loop in the function jumped back to it's start.
+		u64 loop_iterations = 0;
+		/// Sites keyed by the offset of their instruction in the function's bytecode.
+		std::map<u32, Site> sites;
+
+		/// @brief Records that the site at [offset] saw [target], which may be empty.
+		void add_site(u32 offset, Site::Kind kind, const char* target);
+	};
+
+	/// @brief The feedback recorded for the functions of a script.
+	struct Script {
+		/// The path the script was loaded from, which is only kept to make a profile readable.
+		std::string path;
+		u64 source_hash = 0;
+		/// Indexed by the position of each function in a pre-order walk of the script.
+		std::vector<Function> functions;
+	};
+
+	/// @brief Reads a profile saved by `save`.
+	/// @return false if the file can't be read, or isn't a profile.
+	bool load(const std::string& path);
+
+	/// @return false if the file couldn't be written.
+	bool save(const std::string& path) const;
+
+	/// @return The feedback recorded for scripts with the source [source], or nullptr if there is
+	/// none.
+	[[nodiscard]] const Script* find(std::string_view source) const;
+
+	/// @brief Replaces the feedback about the script with the same source as [script], if any.
+	void add(Script script);
+
+	/// @brief A hash of [source] that identifies the script it was compiled from.
+	static u64 hash_source(std::string_view source) noexcept;
+
+	/// @brief Specializes [script], compiled in [vm], with [feedback]. Functions that are still
+	/// lazy are compiled first if they had been compiled when the feedback was recorded. If
+	/// [recorder] isn't null, the feedback is also added to what it records.
+	/// @return The number of sites that were specialized.
+	static size_t apply(VM& vm, CodeBlock& script, const Script& feedback,
+						ProfileRecorder* recorder);
+
+	/// @return The name of the math intrinsic [id], or nullptr if [id] isn't one.
+	static const char* math_intrinsic_name(Intrinsic id) noexcept;
+
+  private:
+	std::vector<Script> m_scripts;
+};
+
+/// @brief The feedback recorded by a VM with `record_profile` set, about the scripts it ran.
+class ProfileRecorder final {
+  public:
+	/// @brief Starts recording feedback about [script], compiled from [source]. The script must
+	/// stay alive for as long as the recorder.
+	void add_script(CodeBlock& script, const SourceCode& source);
+
+	/// @brief Adds [feedback], recorded in an earlier run, to the feedback about [code].
+	void seed(const CodeBlock& code, const Profile::Function& feedback);
+
+	/// @return The feedback about [code], starting a new record if there isn't one.
+	Profile::Function& function(const CodeBlock& code);
+
+	/// @brief Adds the feedback about every script that was recorded to [profile].
+	void save(Profile& profile) const;
+
+  private:
+	struct RecordedScript {
+		const CodeBlock* code;
+		std::string path;
+		u64 source_hash;
+	};
+
+	std::vector<RecordedScript> m_scripts;
+	std::unordered_map<const CodeBlock*, Profile::Function> m_functions;
+};
+
+} // namespace vy
@@ -13,8 +13,17 @@ class Scanner final {
 
   public:
 	Scanner(const std::string& src) noexcept : source{&src} {};
+
+	/// @brief Creates a scanner for [src], which begins on line [line] of the file it's taken from.
+	Scanner(const std::string& src, u32 line) noexcept : source{&src} {
+		line_pos.line = line;
+	};
 	Token next_token() noexcept;
 
+	/// @brief Returns the token that the next call to `next_token` will return, without
+	/// consuming it.
+	Token lookahead() noexcept;
+
   private:
 	const std::string* source;
 	struct {
@@ -11,6 +11,11 @@ Value input(VM&, int);
 Value setproto(VM&, int);
 Value getproto(VM&, int);
 
+/// @brief Returns a frozen copy of a table or list, along with everything it refers to. Frozen
+/// values can't be modified, and can be shared with other VMs.
+Value freeze(VM&, int);
+Value is_frozen(VM&, int);
+
 Value assert_(VM&, int);
 Value import(VM&, int);
 
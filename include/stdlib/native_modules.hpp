@@ -0,0 +1,27 @@
+#pragma once
+#include <common.hpp>
+#include <forward.hpp>
+
+// The loaders of the standard library modules that can also be built as shared libraries. Their
+// names are unmangled, so that they can be found in a shared library by name.
+
+namespace vy::stdlib::math {
+VYSE_API void load_math(VM* vm, Table* module);
+} // namespace vy::stdlib::math
+
+namespace vy::stdlib::stats {
+VYSE_API void load_stats(VM* vm, Table* module);
+} // namespace vy::stdlib::stats
+
+namespace vy::stdlib::time {
+VYSE_API void load_time(VM* vm, Table* module);
+} // namespace vy::stdlib::time
+
+namespace vy::stdlib::algo {
+VYSE_API void load_heapq(VM* vm, Table* module);
+VYSE_API void load_bisect(VM* vm, Table* module);
+} // namespace vy::stdlib::algo
+
+namespace vy::stdlib::collections {
+VYSE_API void load_collections(VM* vm, Table* module);
+} // namespace vy::stdlib::collections
@@ -14,5 +14,6 @@ Value slice(VM&, int);
 Value map(VM&, int);
 Value reduce(VM&, int);
 Value filter(VM&, int);
+Value sort(VM&, int);
 
 } // namespace vyse::stdlib::primitives
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+#include <forward.hpp>
+
+namespace vy::stdlib::channel {
+
+/// @brief Fills [module] with the functions of the 'channel' module.
+void load_channel(VM* vm, Table* module);
+
+} // namespace vy::stdlib::channel
@@ -0,0 +1,9 @@
+#pragma once
+#include <forward.hpp>
+
+namespace vy::stdlib::parallel {
+
+/// @brief Fills [module] with the functions of the 'parallel' module.
+void load_parallel(VM* vm, Table* module);
+
+} // namespace vy::stdlib::parallel
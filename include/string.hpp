@@ -26,6 +26,7 @@ constexpr u32 hash_cstring(const char* key, uint len) {
 ///                         characters end up with the same hash.
 class String final : public Obj {
 	friend VM;
+	friend Obj;
 
 	VYSE_NO_DEFAULT_CONSTRUCT(String);
 	VYSE_NO_COPY(String);
@@ -60,7 +61,7 @@ class String final : public Obj {
 		return at(index);
 	}
 
-	[[nodiscard]] size_t size() const override {
+	[[nodiscard]] size_t size() const {
 		return m_length * sizeof(char) + sizeof(String);
 	}
 
@@ -94,7 +95,7 @@ class String final : public Obj {
 		VYSE_ASSERT(hash == hash_cstring(chrs, len), "Incorrect hash");
 	}
 
-	void trace(GC& gc) override;
+	void trace(GC& gc);
 
 	const char* m_chars;
 	const size_t m_length;
@@ -0,0 +1,75 @@
+#pragma once
+#include "string.hpp"
+
+namespace vy {
+
+/// @brief The set of interned strings. This is an open addressing hash set of string pointers that
+/// uses linear probing, and keeps the hash of each string next to it so that most mismatches are
+/// found without touching the string. The set doesn't keep it's strings alive: the GC removes the
+/// ones it is about to free with `remove_if`, which also shrinks the set when it gets sparse.
+class StringSet final {
+  public:
+	VYSE_NO_COPY(StringSet);
+	VYSE_NO_MOVE(StringSet);
+
+	/// IMPORTANT: `MinCapacity` must always be a power of two, since we are using the `&` trick
+	/// to calculate fast mod.
+	static constexpr size_t MinCapacity = 16;
+	static constexpr float LoadFactor = 0.75;
+
+	StringSet() noexcept = default;
+	~StringSet();
+
+	/// @return The string with the characters [chars], if it is in the set, else nullptr.
+	/// @param hash The hash of [chars], as computed by `hash_cstring`.
+	String* find(const char* chars, size_t length, size_t hash) const;
+
+	/// @brief Adds [string] to the set. No string with the same characters must be in it already.
+	void insert(String* string);
+
+	/// @brief Removes every string for which [should_remove] returns true.
+	template <typename Pred>
+	void remove_if(Pred&& should_remove) {
+		size_t num_kept = 0;
+		for (size_t i = 0; i < m_cap; ++i) {
+			Slot& slot = m_slots[i];
+			if (slot.string == nullptr) continue;
+			if (should_remove(slot.string)) {
+				slot.string = nullptr;
+			} else {
+				++num_kept;
+			}
+		}
+
+		if (num_kept == m_length) return;
+
+		// Linear probing can't leave holes in the middle of a probe sequence, so the strings that
+		// are left are re-inserted.
+		m_length = num_kept;
+		resize(capacity_for(num_kept));
+	}
+
+	/// @return The number of strings in the set.
+	size_t length() const noexcept {
+		return m_length;
+	}
+
+  private:
+	struct Slot {
+		String* string = nullptr;
+		size_t hash = 0;
+	};
+
+	Slot* m_slots = nullptr;
+	size_t m_cap = 0;
+	size_t m_length = 0;
+
+	/// @brief Returns the capacity the set should have after a sweep leaves [length] strings in it.
+	/// This leaves room for the set to double before it has to grow again.
+	static size_t capacity_for(size_t length);
+
+	/// @brief Re-inserts all strings into a new buffer of [new_cap] slots.
+	void resize(size_t new_cap);
+};
+
+} // namespace vy
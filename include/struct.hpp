@@ -0,0 +1,109 @@
+#pragma once
+#include "string.hpp"
+#include "value.hpp"
+#include <vector>
+
+namespace vy {
+
+/// @brief The descriptor created by a `struct` declaration. It holds the names of the fields in
+/// declaration order, which is also the order of the slots in every instance. Calling the
+/// descriptor creates an instance, taking the fields as positional arguments.
+class StructType final : public Obj {
+	friend Obj;
+	VYSE_NO_DEFAULT_CONSTRUCT(StructType);
+	VYSE_NO_COPY(StructType);
+	VYSE_NO_MOVE(StructType);
+
+  public:
+	explicit StructType(String* name) noexcept : Obj{ObjType::struct_type}, m_name{name} {};
+	~StructType() = default;
+
+	String* const m_name;
+	std::vector<String*> m_fields;
+
+	/// @return The slot of the field [name], or -1 if there is no such field.
+	[[nodiscard]] int field_index(Value name) const noexcept {
+		if (!VYSE_IS_STRING(name)) return -1;
+		// Field names are interned, and structs are small enough for a linear search to beat
+		// hashing.
+		const Obj* const string = VYSE_AS_OBJECT(name);
+		for (size_t i = 0; i < m_fields.size(); ++i) {
+			if (m_fields[i] == string) return int(i);
+		}
+
+		// Frozen strings aren't interned, so they have to be compared by their characters. The
+		// fields of a frozen type are frozen strings too.
+		if (!string->is_frozen() and !is_frozen()) return -1;
+		for (size_t i = 0; i < m_fields.size(); ++i) {
+			if (*m_fields[i] == *static_cast<const String*>(string)) return int(i);
+		}
+		return -1;
+	}
+
+	[[nodiscard]] u32 num_fields() const noexcept {
+		return u32(m_fields.size());
+	}
+
+	[[nodiscard]] const char* name_cstr() const noexcept {
+		return m_name->c_str();
+	}
+
+  private:
+	void trace(GC& gc);
+	size_t size() const {
+		return sizeof(StructType) + m_fields.capacity() * sizeof(String*);
+	}
+};
+
+/// @brief An instance of a struct. The fields are stored in slots right after the object itself,
+/// in the order they were declared in, so that reading a field whose slot is known is a single
+/// load. Instances can't gain new fields.
+class Struct final : public Obj {
+	friend Obj;
+	VYSE_NO_DEFAULT_CONSTRUCT(Struct);
+	VYSE_NO_COPY(Struct);
+	VYSE_NO_MOVE(Struct);
+
+	/// A copy of the number of fields in [m_type], which fits in the padding of the object header.
+	/// The type may be freed before the instance in the same GC cycle, so the size of the instance
+	/// can't be read from it.
+	const u32 m_num_fields;
+
+  public:
+	/// @brief Allocates an instance of [type] with all fields set to nil.
+	[[nodiscard]] static Struct* make(StructType& type);
+
+	~Struct() = default;
+
+	/// Instances are allocated by `make` along with their slots, and are freed the same way.
+	static void operator delete(void* memory) {
+		::operator delete(memory);
+	}
+
+	StructType* const m_type;
+
+	[[nodiscard]] Value* fields() noexcept {
+		return reinterpret_cast<Value*>(this + 1);
+	}
+
+	[[nodiscard]] const Value* fields() const noexcept {
+		return reinterpret_cast<const Value*>(this + 1);
+	}
+
+	[[nodiscard]] u32 num_fields() const noexcept {
+		return m_num_fields;
+	}
+
+  private:
+	explicit Struct(StructType& type) noexcept
+		: Obj{ObjType::struct_}, m_num_fields{type.num_fields()}, m_type{&type} {};
+
+	void trace(GC& gc);
+	size_t size() const {
+		return sizeof(Struct) + m_num_fields * sizeof(Value);
+	}
+};
+
+static_assert(sizeof(Struct) % alignof(Value) == 0, "Struct fields must be aligned.");
+
+} // namespace vy
@@ -11,14 +11,19 @@ namespace vy {
 // and linear probing.
 class Table final : public Obj {
 	friend GC;
+	friend Obj;
 
   public:
+	/// @brief Creates an empty table. The entries buffer is only allocated once the first key is
+	/// inserted, so empty tables take no more memory than the `Table` object itself.
 	explicit Table() noexcept : Obj{ObjType::table} {};
 	~Table();
 
-	/// IMPORTANT: `DefaultCapacity` must always be a power of two, since we are using the `&` trick
-	/// to calculate fast mod.
-	static constexpr size_t DefaultCapacity = 16;
+	/// @brief The capacity of the entries buffer when the first key is inserted.
+	/// IMPORTANT: `MinCapacity` must always be a power of two, since we are using the `&` trick
+	/// to calculate fast mod. With the load factor below, a table of this size fits 7 keys, which
+	/// covers most records. Probing so few slots is about as fast as a linear search.
+	static constexpr size_t MinCapacity = 8;
 	static constexpr u8 GrowthFactor = 2;
 	static constexpr float LoadFactor = 0.85;
 
@@ -45,16 +50,36 @@ class Table final : public Obj {
 	/// @return The number of key-value pairs that are active in this table.
 	size_t length() const;
 
+	/// @brief Grows the table so that [num_entries] entries can be inserted without rehashing.
+	void reserve(size_t num_entries);
+
+	/// @brief Makes this table a copy of [shape], a table that maps each of it's keys to an index
+	/// into [values]. Every key is then set to the value at it's index. The table must be empty.
+	void copy_shape(const Table& shape, const Value* values);
+
+	/// @brief Calls [fn] with the key and the value of every live entry in the table.
+	template <typename Fn>
+	void for_each(Fn&& fn) const {
+		for (size_t i = 0; i < m_cap; ++i) {
+			const Entry& entry = m_entries[i];
+			if (VYSE_IS_NIL(entry.key) or VYSE_IS_UNDEFINED(entry.key)) continue;
+			fn(entry.key, entry.value);
+		}
+	}
+
 	/// @brief Takes a string C string on the heap. checks if
 	/// a vyse::String exists with the same characters.
 	/// @return A pointer to the string object, if found
 	/// inside the table, else nullptr.
 	String* find_string(const char* chars, size_t length, size_t hash) const;
 
-	/// Returns the total number of alive entries in
-	/// this hashtable. values that have been set to nil
-	/// don't count.
-	virtual size_t size() const override;
+	/// @brief Returns the hash of [value], which must not be nil. Values that compare equal with
+	/// `==` always have the same hash, so native containers can share the table's hashing.
+	static size_t hash_value(Value value);
+	static size_t hash_object(Obj* object);
+
+	/// @brief Returns the number of bytes used by this table, including it's entries buffer.
+	size_t size() const;
 
 	/// An Entry represents a key-value pair
 	/// in the hashtable, both the key and the
@@ -76,7 +101,8 @@ class Table final : public Obj {
 	};
 
   private:
-	Entry* m_entries = new Entry[DefaultCapacity];
+	/// @brief The entries buffer, which is null until a key is inserted.
+	Entry* m_entries = nullptr;
 	/// @brief Total number of entries.
 	/// This includes all tombstones (values that have been
 	/// removed from the table).
@@ -85,15 +111,15 @@ class Table final : public Obj {
 	/// A tombstone is an entry that was inserted at some
 	/// point but was then removed by calling `Table::remove`.
 	size_t m_num_tombstones = 0;
-	size_t m_cap = DefaultCapacity;
-
-	size_t hash_value(Value value) const;
-	size_t hash_object(Obj* object) const;
+	size_t m_cap = 0;
 
 	/// @brief If the hashtable is [LoadFactor]th full
 	/// then grows the entries buffer.
 	void ensure_capacity();
 
+	/// @brief Re-inserts all live entries into a new buffer of [new_cap] entries.
+	void resize(size_t new_cap);
+
 	/// @brief Using a key and it's hash, returns the slot in the
 	/// entries array where the key should be inserted.
 	template <typename Th, typename Rt>
@@ -128,11 +154,7 @@ class Table final : public Obj {
 		}
 	}
 
-	virtual void trace(GC& gc) override;
-
-	/// @brief Deletes all the string keys that
-	/// aren't marked as 'alive' by the previous GC mark phase.
-	void delete_white_string_keys();
+	void trace(GC& gc);
 };
 
 bool operator==(const Table::Entry& a, const Table::Entry& b);
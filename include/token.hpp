@@ -97,7 +97,9 @@ enum class TokenType {
 	Fn,
 	Return,
 	Break,
-	Continue
+	Continue,
+	Match,
+	Struct
 
 	// clang-format on
 };
@@ -4,6 +4,8 @@
 namespace vy {
 
 class Upvalue final : public Obj {
+	friend Obj;
+
   public:
 	explicit constexpr Upvalue(Value* v) noexcept : Obj(ObjType::upvalue), m_value{v} {};
 	~Upvalue() = default;
@@ -12,8 +14,8 @@ class Upvalue final : public Obj {
 	Upvalue* next_upval = nullptr; // next upvalue in the VM's upvalue list.
 
   private:
-	void trace(GC& gc) override;
-	size_t size() const override {
+	void trace(GC& gc);
+	size_t size() const {
 		return sizeof(Upvalue);
 	}
 };
@@ -8,7 +8,8 @@
 
 namespace vy {
 
-class UserData : public Obj {
+class UserData final : public Obj {
+	friend Obj;
 	VYSE_NO_DEFAULT_CONSTRUCT(UserData);
 
 	using TraceFn = void(GC& gc, void* t);
@@ -68,16 +69,12 @@ class UserData : public Obj {
 		return false;
 	}
 
-	[[nodiscard]] size_t size() const override {
+	[[nodiscard]] size_t size() const {
 		return sizeof(UserData);
 	}
 
-	[[nodiscard]] const char* to_cstring() const override {
-		return "userdata";
-	}
-
   protected:
-	void trace(GC& gc) override {
+	void trace(GC& gc) {
 		gc.mark(m_proto);
 		if (m_tracer) {
 			m_tracer(gc, m_data);
@@ -82,6 +82,19 @@ class Args {
 		return check_and_get<T>(tag);
 	}
 
+	/// @brief Same as `next`, but raises an error if the argument is frozen. Functions that modify
+	/// the table or list they are passed must get it through this.
+	template <typename T>
+	[[nodiscard]] T& next_mutable() noexcept(false) {
+		T& object = next<T>();
+		if (object.is_frozen()) {
+			const std::string message =
+				std::string("Attempt to modify a frozen ") + otype_to_string(object.tag) + ".";
+			throw CMiscException(m_fname, message.c_str());
+		}
+		return object;
+	}
+
 	template <typename T>
 	T* next_udata_arg() noexcept(false) {
 		const Value arg = next_arg();
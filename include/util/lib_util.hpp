@@ -13,7 +13,15 @@ void bad_arg_error(VM& vm, const char* fname, int argn, const char* expected_typ
 				   const char* received_type);
 
 /// @brief add a key with name [name] and value of type cfunction [cfn] to the table [proto]
-void add_libfn(VM& vm, Table& proto, const char* name, NativeFn cfn);
+/// @return The closure wrapping [cfn].
+CClosure& add_libfn(VM& vm, Table& proto, const char* name, NativeFn cfn);
+
+/// @brief Three way comparison of two numbers or two strings that doesn't go through the VM.
+/// Strings are ordered byte-wise. Used by the sorting and searching library functions.
+/// @param result Set to a negative number, zero, or a positive number when [a] is less than, equal
+/// to, or greater than [b] respectively.
+/// @return false if [a] and [b] can't be ordered natively, true otherwise.
+bool compare_values(Value a, Value b, int& result) noexcept;
 
 /// @brief Reports an error and returns false if the native function with name [fname] does not
 /// have between [min_args] and [max_args] arguments. When [max_args] is not provided, then it
@@ -26,6 +26,10 @@ class NativeModule {
 	/// via the module
 	void add_cclosures(const std::pair<const char*, NativeFn>* funcs, std::size_t num_funcs);
 
+	/// @brief Tags the native function [fname], which must already be in the module, as the
+	/// intrinsic [id] so that the VM can run calls to it in place.
+	void set_intrinsic(const char* fname, Intrinsic id);
+
   private:
 	VM* const m_vm;
 	Table* const m_table;
@@ -17,43 +17,82 @@ enum class ObjType : u8 {
 	table,
 	list,
 	user_data,
+	struct_type,
+	struct_,
 };
 
 /// Objects always live on the heap. A value which is an object contains a pointer
 /// to this data on the heap. The `tag` specifies what kind of object this is.
+/// Objects have no vtable: `trace`, `size` and destruction switch on the `tag` and call the
+/// methods of the object's type directly. This keeps the header down to 16 bytes, the tail of which
+/// can be used by the fields of the deriving class.
 class Obj {
 	// The VM and the Garbage Collector need access to the mark bit and the `next` pointer. So we'll
 	// declare them as friend classes.
 	friend VM;
 	friend GC;
-	friend Table;
+	// Frozen regions allocate and free their objects themselves.
+	friend FrozenRegion;
+
+  private:
+	/// Objects are allocated with `new`, so the lowest bit of their addresses is always 0.
+	static constexpr uintptr_t MarkBit = 1;
+
+	/// @brief pointer to the next object in the VM's GC linked list. The lowest bit is set when
+	/// this object has been 'marked' as alive in the currently active garbage collection cycle.
+	uintptr_t m_next = 0;
 
   public:
 	const ObjType tag;
 
+  private:
+	/// @brief Whether this object belongs to a `FrozenRegion`, and may never be modified.
+	bool m_frozen = false;
+
+  public:
 	explicit constexpr Obj(ObjType tt) noexcept : tag{tt} {}
 	constexpr Obj(Obj&& o) = default;
 	constexpr Obj(Obj const& o) = default;
 
-	virtual ~Obj() = default;
+	const char* to_cstring() const;
 
-	virtual const char* to_cstring() const;
+	/// @brief returns the size of this object in bytes.
+	size_t size() const;
+
+	/// @brief Whether this object is part of a frozen region. Frozen objects are shared between
+	/// VMs, so all writes to them must be refused.
+	[[nodiscard]] bool is_frozen() const noexcept {
+		return m_frozen;
+	}
 
   protected:
-	/// @brief pointer to the next object in the VM's GC linked list.
-	Obj* next = nullptr;
+	/// Objects are destroyed with `destroy`, which calls the destructor of the right type.
+	~Obj() = default;
+
+	/// @brief Traces all the references that this object contains to other values, by calling the
+	/// `trace` method of it's type.
+	void trace(GC& gc);
+
+	/// @brief Destroys [object] and frees it's memory.
+	static void destroy(Obj* object);
+
+	[[nodiscard]] Obj* next() const noexcept {
+		return reinterpret_cast<Obj*>(m_next & ~MarkBit);
+	}
+
+	void set_next(Obj* next) noexcept {
+		m_next = reinterpret_cast<uintptr_t>(next) | (m_next & MarkBit);
+	}
+
 	/// @brief Whether this object has been 'marked' as alive in the most
 	/// currently active garbage collection cycle (if any).
-	/// TODO: use the MSB in the `next` pointer for this task?
-	bool marked = false;
-
-	/// @brief Traces all the references that this object
-	/// contains to other values. Is overriden by deriving
-	/// class.
-	virtual void trace(GC& gc) = 0;
+	[[nodiscard]] bool marked() const noexcept {
+		return m_next & MarkBit;
+	}
 
-	/// @brief returns the size of this object in bytes.
-	virtual size_t size() const = 0;
+	void set_marked(bool marked) noexcept {
+		m_next = marked ? m_next | MarkBit : m_next & ~MarkBit;
+	}
 };
 
 enum class ValueType : u8 { Number, Bool, Object, Nil, Undefined, MiscData };
@@ -145,6 +184,10 @@ void print_value(Value v);
 	(VYSE_IS_OBJECT(v) and VYSE_AS_OBJECT(v)->tag == vy::ObjType::codeblock)
 #define VYSE_IS_CCLOSURE(v) (VYSE_IS_OBJECT(v) and VYSE_AS_OBJECT(v)->tag == vy::ObjType::c_closure)
 #define VYSE_IS_UDATA(v) (VYSE_IS_OBJECT(v) and VYSE_AS_OBJECT(v)->tag == vy::ObjType::user_data)
+#define VYSE_IS_STRUCT_TYPE(v)                                                                     \
+	(VYSE_IS_OBJECT(v) and VYSE_AS_OBJECT(v)->tag == vy::ObjType::struct_type)
+#define VYSE_IS_STRUCT(v) (VYSE_IS_OBJECT(v) and VYSE_AS_OBJECT(v)->tag == vy::ObjType::struct_)
+#define VYSE_IS_FROZEN(v) (VYSE_IS_OBJECT(v) and VYSE_AS_OBJECT(v)->is_frozen())
 
 #define VYSE_IS_FALSY(v) ((VYSE_IS_BOOL(v) and !(VYSE_AS_BOOL(v))) or VYSE_IS_NIL(v))
 #define VYSE_IS_TRUTHY(v) (!VYSE_IS_FALSY(v))
@@ -161,6 +204,8 @@ void print_value(Value v);
 #define VYSE_AS_TABLE(v) (static_cast<Table*>(VYSE_AS_OBJECT(v)))
 #define VYSE_AS_LIST(v) (static_cast<List*>(VYSE_AS_OBJECT(v)))
 #define VYSE_AS_UDATA(v) (static_cast<UserData*>(VYSE_AS_OBJECT(v)))
+#define VYSE_AS_STRUCT_TYPE(v) (static_cast<vy::StructType*>(VYSE_AS_OBJECT(v)))
+#define VYSE_AS_STRUCT(v) (static_cast<vy::Struct*>(VYSE_AS_OBJECT(v)))
 
 #define VYSE_CAST_INT(v) (s64(VYSE_AS_NUM(v)))
 
@@ -1,13 +1,19 @@
 #pragma once
 #include "common.hpp"
 #include "compiler.hpp"
+#include "format.hpp"
+#include "frozen.hpp"
 #include "gc.hpp"
 #include "libloader.hpp"
+#include "profile.hpp"
+#include "string_set.hpp"
+#include "struct.hpp"
 #include "table.hpp"
 #include "userdata.hpp"
 #include "value.hpp"
 #include "vm_stack.hpp"
 #include <functional>
+#include <memory>
 #include <source.hpp>
 #include <unordered_map>
 
@@ -118,6 +124,20 @@ class VM {
 
 	ModuleLoader find_module = nullptr;
 
+	/// When true, function bodies are only scanned when a script is compiled, and each function is
+	/// compiled the first time it is called. This speeds up loading scripts that only use a few of
+	/// the functions they define, but syntax errors inside a function are only reported once it is
+	/// called.
+	bool lazy_compile = false;
+
+	/// Feedback from an earlier run that every script is specialized with before it runs. The
+	/// profile must outlive the VM. See `profile.hpp`.
+	const Profile* profile = nullptr;
+
+	/// When true, the VM records feedback about the scripts it runs, which `save_profile` adds to a
+	/// profile. This has to be set before the first script is run.
+	bool record_profile = false;
+
 	/// Maximum size of the call stack. If the call stack
 	/// size exceeds this, then there is a stack overflow.
 	static constexpr size_t MaxCallStack = 1024;
@@ -150,6 +170,14 @@ class VM {
 		/// are represented as a stack offsets from this base.
 		Value* base = nullptr;
 
+		/// The number of extra arguments passed to a variadic function that were left on the
+		/// stack, right below [base].
+		u32 num_varargs = 0;
+
+		/// The number of slots that the frame was moved up by to make room for the varargs
+		/// below it. The return value is written to `base - shift`, where the callee was.
+		u32 shift = 0;
+
 		CallFrame* next = nullptr;
 		CallFrame* prev = nullptr;
 
@@ -181,7 +209,8 @@ class VM {
 
 	bool init();
 
-	ExitCode runcode(std::string code);
+	/// @brief Compiles and runs [code], as if it were the contents of the file at [path].
+	ExitCode runcode(std::string code, std::string path = "<script>");
 	ExitCode runfile(std::string file, std::string code = "");
 	ExitCode run();
 
@@ -206,6 +235,8 @@ class VM {
 		static_assert(!std::is_same_v<T, String>, "Use 'VM::make_string' to make string objects.");
 		static_assert(!std::is_same_v<T, UserData>,
 					  "Use 'VM::make_udata' to make UserData objects.");
+		static_assert(!std::is_same_v<T, Struct>,
+					  "Use 'VM::make_struct' to make struct instances.");
 
 		T* object = new T(std::forward<Args>(args)...);
 		register_object(object);
@@ -219,6 +250,13 @@ class VM {
 		return *udata;
 	}
 
+	/// @brief Makes an instance of [type] with all of it's fields set to nil.
+	Struct& make_struct(StructType& type) {
+		Struct* instance = Struct::make(type);
+		register_object(instance);
+		return *instance;
+	}
+
 	/// TODO: Refactor this logic out from vm.hpp to gc.cpp
 	inline void register_object(Obj* o) noexcept {
 		VYSE_ASSERT(o != nullptr, "Attempt to register NULL object.");
@@ -237,7 +275,7 @@ class VM {
 		}
 #endif
 
-		o->next = m_gc.m_objects;
+		o->set_next(m_gc.m_objects);
 		m_gc.m_objects = o;
 		m_gc.bytes_allocated += o->size();
 	}
@@ -304,6 +342,38 @@ class VM {
 		return m_gc.bytes_allocated;
 	}
 
+	/// @brief Makes the frozen [region] readable by this VM, which keeps it alive for as long as
+	/// the VM itself. Frozen objects are not counted in `memory`.
+	/// @return The root value of the region.
+	Value adopt(std::shared_ptr<const FrozenRegion> region);
+
+	/// @brief Like `adopt`, but the region is only kept alive until the garbage collector finds
+	/// no more references to it's objects, and it's size is counted in `memory` meanwhile. The
+	/// root must be made reachable before anything else is allocated.
+	Value adopt_collectable(std::shared_ptr<const FrozenRegion> region);
+
+	/// @return The region that [value] belongs to, or nullptr if it isn't frozen. This is how a host
+	/// hands a table frozen by a script over to other VMs.
+	[[nodiscard]] std::shared_ptr<const FrozenRegion> frozen_region(Value value) const;
+
+	/// @brief Specializes [script], which was just compiled from the current source, with the
+	/// feedback about it in [profile], and starts recording feedback about it if [record_profile]
+	/// is set.
+	void prepare_script(CodeBlock& script);
+
+	/// @brief Adds the feedback recorded about every script that has been run to [profile].
+	void save_profile(Profile& profile) const;
+
+	/// @brief Compiles the body of a function that was left uncompiled because of [lazy_compile].
+	/// @return false if there was a compile error.
+	bool compile_lazy(CodeBlock& code);
+
+	/// @brief The path of the source file that is being run.
+	[[nodiscard]] inline std::string_view get_current_file() const {
+		if (m_sources.empty()) return "";
+		return m_sources.back().path;
+	}
+
 	/// @brief calls a callable object that is present at a depth of [argc] - 1 in the stack,
 	/// followed by argc arguments.
 	/// @param argc number of a arguments.
@@ -339,6 +409,10 @@ class VM {
 	/// @brief The Dynamic library loader used to load dyn_libs
 	DynLoader dynloader;
 
+	/// @brief Format strings that have been compiled by `String.fmt`, keyed by the interned format
+	/// string. An entry is dropped by the garbage collector when it's key string gets freed.
+	std::unordered_map<const String*, FormatTemplate> format_cache;
+
   private:
 	VMConfig m_config;
 
@@ -347,6 +421,9 @@ class VM {
 	bool m_has_error = false;
 	Compiler* m_compiler = nullptr;
 
+	/// Records type feedback when [record_profile] is set, null otherwise.
+	std::unique_ptr<ProfileRecorder> m_recorder;
+
 	/// @brief Whether or not the garbage collector is allowed to collect garbage. This can be
 	/// turned on or off using `VM::gc_off`
 	bool can_collect = true;
@@ -378,14 +455,26 @@ class VM {
 	const Block* m_current_block = nullptr;
 
 	// Vyse interns all strings. If two separate string values are identical, they point
-	// to the same object in heap. To deduplicate strings, we use a table.
-	Table interned_strings;
+	// to the same object in heap. To deduplicate strings, we use a set of all live strings.
+	StringSet interned_strings;
 
 	/// @brief A map of all global variables.
 	/// Since vyse strings are interned, using a `String*` as the key does not lead to any
 	/// problems.
 	std::unordered_map<String*, Value> m_global_vars;
 
+	/// @brief A frozen region that values in this VM may refer to.
+	struct AdoptedRegion {
+		std::shared_ptr<const FrozenRegion> region;
+		/// Whether the region is kept until the VM is destroyed. Other regions are given up by the
+		/// garbage collector once none of their objects are reachable.
+		bool pinned = false;
+		/// Set by the garbage collector when it reaches an object of the region.
+		bool marked = false;
+	};
+
+	std::unordered_map<const FrozenRegion*, AdoptedRegion> m_frozen_regions;
+
 	/// @brief Compile the current source and return a `Closure` which when called will execute
 	/// [code]
 	[[nodiscard]] Closure* compile_source();
@@ -393,7 +482,17 @@ class VM {
 	/// @brief Call any callable value from within the VM. Note that this is only used to call
 	/// instructions from inside a vyse script. To call anything from a C/C++ program, the
 	/// `VM::call` method is used instead.
-	bool op_call(Value value, u8 argc);
+	bool op_call(Value value, int argc);
+
+	/// @brief Calls the method [name] of the receiver that is on the stack below it's [argc] - 1
+	/// arguments. The slot above the arguments must be free, since the method is placed below the
+	/// receiver.
+	/// @return true if the call succeeded, false if there was an error.
+	bool invoke(const Value& name, int argc);
+
+	/// @brief Creates an instance of [type] from the `argc` arguments on the stack, which are
+	/// assigned to the fields in the order they were declared in. Fields left out are nil.
+	bool construct_struct(StructType& type, int argc);
 
 	/// @brief Call a vyse closure which has `argc` args on the stack.
 	bool call_closure(Closure* func, int argc);
@@ -410,6 +509,17 @@ class VM {
 	/// list.
 	int prep_vararg_call(int num_params, int num_args);
 
+	/// @brief Prepares the VM's stack for a variadic function call without allocating a list.
+	/// The callee and it's [num_params] - 1 fixed arguments are copied above the [num_varargs]
+	/// extra arguments, which stay on the stack below the new frame. The variadic parameter's
+	/// slot is set to nil.
+	/// @return The number of slots the callee was moved up by.
+	u32 shift_vararg_call(int num_params, u32 num_varargs);
+
+	/// @brief Returns true if the varargs of the current call frame are on the stack rather than
+	/// in a list. [rest] is the value in the variadic parameter's slot.
+	bool varargs_on_stack(const Value& rest) const noexcept;
+
 	/// @brief Get a value's prototype.
 	/// If no prototype is found, returns `nullptr`.
 	inline Table* get_proto(const Value& value) {
@@ -486,6 +596,25 @@ class VM {
 	/// @return true if there are no runtime errors, false otherwise.
 	bool set_field_of_udata(const UserData& udata, const Value& key, const Value value);
 
+	/// @brief Stores `value.key` in [result], where [value] is not a table. This is the slow path
+	/// of `table_get`.
+	/// @return true if there are no runtime errors, false otherwise.
+	bool get_field(const Value& value, const Value& key, Value& result);
+
+	/// @brief Performs `value.key = field_value`, where [value] is not a table. This is the slow
+	/// path of `table_set`.
+	/// @return true if there are no runtime errors, false otherwise.
+	bool set_field(const Value& value, const Value& key, const Value& field_value);
+
+	/// @brief Stores the field [key] of [instance] in [result]. Structs can't gain new fields, so
+	/// reading a field they weren't declared with is an error.
+	/// @return true if there are no runtime errors, false otherwise.
+	bool get_field_of_struct(const Struct& instance, const Value& key, Value& result);
+
+	/// @brief Sets the field [key] of [instance] to [value].
+	/// @return true if there are no runtime errors, false otherwise.
+	bool set_field_of_struct(Struct& instance, const Value& key, const Value& value);
+
 	/// @brief performs the `lhs[key] = rhs` operation.
 	/// @return true if the operation was successful, false if there was an error instead.
 	bool subscript_set(const Value& lhs, const Value& key, const Value& rhs);
@@ -506,6 +635,15 @@ class VM {
 	/// generally used for loading functions and objects from the standard library.
 	void add_stdlib_object(const char* name, Obj* o);
 
+	/// @brief The feedback being recorded about the function that is running.
+	Profile::Function& recorded_function();
+
+	/// @brief Records that the site at [offset] in the function that is running saw [target].
+	void record_site(Profile::Site::Kind kind, size_t offset, const char* target);
+
+	/// @brief Records the type of [object] at the `struct_get` or `struct_set` that was just read.
+	void record_field_site(Value object);
+
 	/// @brief Prepares the VM CallStack for the very first
 	/// function call, which is the toplevel userscript.
 	void invoke_script(Closure* closure);
@@ -519,11 +657,6 @@ class VM {
 		m_sources.push_back(std::move(source));
 	}
 
-	[[nodiscard]] inline std::string_view get_current_file() const {
-		if (m_sources.empty()) return "";
-		return m_sources.back().path;
-	}
-
 	inline void pop_source() {
 		assert(!m_sources.empty());
 		m_sources.pop_back();
@@ -12,9 +12,117 @@
 
 // OP(name, arity, stack_effect),
 OP(load_const, 1, 1), OP(get_global, 1, 1), OP(set_global, 1, -1), OP(table_get, 1, 0),
-	OP(table_set, 1, -1), OP(table_get_no_pop, 1, 1), OP(set_var, 1, -1), OP(get_var, 1, 1),
+	OP(table_set, 1, -1), OP(table_get_no_pop, 1, 1),
+
+	/// Operand: Idx (a constant list [Lo, Target0, Target1, ...])
+	/// A = POP()
+	/// if A is an integer and Lo <= A < Lo + #Targets, and Target(A - Lo) is not nil ->
+	///   ip = Target(A - Lo)
+	/// Dispatches a `match` statement whose patterns are densely packed integers.
+	OP(jump_table, 1, -1),
+
+	/// Operand: Idx (a constant table mapping patterns to targets)
+	/// A = POP()
+	/// if CONSTANTS[Idx][A] is not nil -> ip = CONSTANTS[Idx][A]
+	/// Dispatches a `match` statement whose patterns are sparse number, string or bool constants.
+	OP(match_table, 1, -1),
+
+	/// Operand: Idx (a constant table mapping each field name to it's position)
+	/// N = #CONSTANTS[Idx]
+	/// Pops N values, and pushes a table whose fields are set to those values.
+	/// Creates a table literal whose keys are all identifiers by copying the shape in
+	/// CONSTANTS[Idx] instead of inserting the keys one at a time.
+	OP(table_from_shape, 1, 1), /* special stack effect */
+
+	OP(set_var, 1, -1), OP(get_var, 1, 1),
 	OP(set_upval, 1, -1), OP(get_upval, 1, 1), OP(make_func, -1, 1), /* special arity */
-	OP(prep_method_call, 1, 1),
+
+	/// The vararg instructions take the stack slot of a function's variadic parameter as their
+	/// operand. Unless that slot already holds a list, the varargs are read from the stack where
+	/// the caller left them.
+
+	/// Operand: Slot
+	/// PUSH(#varargs)
+	OP(vararg_len, 1, 1),
+
+	/// Operand: Slot
+	/// INDEX = POP()
+	/// PUSH(varargs[INDEX])
+	OP(vararg_get, 1, 0),
+
+	/// Operand: Slot
+	/// If the varargs are still on the stack, collects them into a list and stores it in Slot.
+	/// PUSH(VAR(Slot))
+	OP(vararg_pack, 1, 1),
+
+	/// Operand: Slot
+	/// PUSH(varargs[0]), ..., PUSH(varargs[N - 1])
+	/// PUSH(N)
+	OP(vararg_spread, 1, 1), /* special stack effect */
+
+	/// Operand: N (a size hint)
+	/// Pushes a new table with room for N fields.
+	OP(new_table, 1, 1),
+
+	/// Operand: N (a size hint)
+	/// Pushes a new list with room for N items.
+	OP(new_list, 1, 1),
+
+	/// Operand: N
+	/// Pops N values and appends them (in order) to the list below them.
+	OP(list_append_n, 1, 0), /* special stack effect */
+
+	/// Operand: N
+	/// PUSH(PEEK(N))
+	/// Reads an argument of a call whose callee has been inlined.
+	OP(peek, 1, 1),
+
+	/// Operand: N
+	/// R = POP()
+	/// Pops N values, then PUSH(R).
+	/// Removes the callee and arguments from below the result of an inlined call.
+	OP(inline_return, 1, 0), /* special stack effect */
+
+	/// Operands: NameIdx, NumArgs (including the receiver)
+	/// Stack: [receiver, args...] -> [method, receiver, args...]
+	/// method = receiver[CONSTANTS[NameIdx]]
+	/// Calls the method with the receiver as it's first argument.
+	OP(invoke, 2, 1), /* special arity */
+
+	/// Operands: NameIdx, NumArgs
+	/// N = POP()
+	/// Same as `invoke`, but with N more arguments pushed by a `vararg_spread`.
+	OP(invoke_spread, 2, 0), /* special arity */
+
+	/// Operands: NameIdx, IntrinsicId
+	/// Stack: [receiver] -> [result]
+	/// Same as `invoke` with no arguments besides the receiver, but if the method is the builtin
+	/// tagged IntrinsicId, it is run in place without a call.
+	OP(invoke_intrinsic, 2, 1), /* special arity */
+
+	/// Operands: CodeIdx, NumArgs
+	/// Stack: [callee, args...]
+	/// if callee is a closure of CONSTANTS[CodeIdx] -> ip = ip + 3 (skip the next jmp)
+	/// else call callee with NumArgs arguments.
+	/// Precedes a `jmp` over the inlined body of CONSTANTS[CodeIdx].
+	OP(inline_guard, 2, 0), /* special arity */
+
+	/// Operands: TypeIdx, Slot
+	/// Stack: [object] -> [value]
+	/// if object is an instance of the struct CONSTANTS[TypeIdx] -> value = object.fields[Slot]
+	/// else value = object[name], where name is the field in Slot of CONSTANTS[TypeIdx].
+	OP(struct_get, 2, 0), /* special arity */
+
+	/// Operands: TypeIdx, Slot
+	/// Stack: [object, value] -> [value]
+	/// Same as `struct_get`, but sets the field to value.
+	OP(struct_set, 2, -1), /* special arity */
+
+	/// Operand: IntrinsicId
+	/// Stack: [callee, arg] -> [result]
+	/// If callee is the builtin tagged IntrinsicId, it is run in place without a call.
+	/// else call callee with 1 argument.
+	OP(call_intrinsic, 1, 0), /* special stack effect */
 
 	// Note that calling function pushes a new call
 	// frame onto the stack, therefore it does not count
@@ -22,6 +130,11 @@ OP(load_const, 1, 1), OP(get_global, 1, 1), OP(set_global, 1, -1), OP(table_get,
 	// closure.
 	OP(call_func, 1, 0), /* special stack effect */
 
+	/// Operand: NumArgs
+	/// N = POP()
+	/// Same as `call_func`, but with N more arguments pushed by a `vararg_spread`.
+	OP(call_spread, 1, -1), /* special stack effect */
+
 	OP(pop, 0, -1),
 
 	// binary ops
@@ -30,6 +143,11 @@ OP(load_const, 1, 1), OP(get_global, 1, 1), OP(set_global, 1, -1), OP(table_get,
 	OP(rshift, 0, -1), OP(band, 0, -1), OP(bxor, 0, -1), OP(bor, 0, -1), OP(gt, 0, -1),
 	OP(lt, 0, -1), OP(gte, 0, -1), OP(lte, 0, -1),
 
+	/// Same as `add`, `sub`, `mult`, `gt`, `lt`, `gte` and `lte`, but the compiler has proven
+	/// that both operands are numbers, so their types are not checked.
+	OP(add_nn, 0, -1), OP(sub_nn, 0, -1), OP(mult_nn, 0, -1), OP(gt_nn, 0, -1), OP(lt_nn, 0, -1),
+	OP(gte_nn, 0, -1), OP(lte_nn, 0, -1),
+
 	/// Insert the value at PEEK(1) into the array PEEK(2)
 	/// and pop top
 	/// el = POP()
@@ -43,9 +161,6 @@ OP(load_const, 1, 1), OP(get_global, 1, 1), OP(set_global, 1, -1), OP(table_get,
 	OP(load_nil, 0, 1), OP(close_upval, 0, -1), OP(return_val, 0, 0), /* special stack effect */
 
 	// table indexing
-	OP(new_table, 0, 1), // create a new table and push it onto the stack
-	OP(new_list, 0, 1),	 // create a new list  and push it onto the stack
-
 	/// value = POP()
 	/// k     = POP()
 	/// t     = POP()
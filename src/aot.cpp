@@ -0,0 +1,595 @@
+#include "str_format.hpp"
+#include <aot.hpp>
+#include <cmath>
+#include <cstring>
+#include <debug.hpp>
+#include <sstream>
+#include <vector>
+
+namespace vy::aot {
+
+using Op = Opcode;
+
+u32 checksum(const CodeBlock& code) {
+	// 32 bit FNV-1a.
+	u32 hash = 2166136261u;
+	const auto mix = [&hash](u8 byte) { hash = (hash ^ byte) * 16777619u; };
+
+	for (const Op op : code.block().code) mix(u8(op));
+	for (const Value& value : code.block().constant_pool) {
+		mix(u8(value.tag));
+		if (VYSE_IS_NUM(value)) {
+			u8 bytes[sizeof(number)];
+			const number num = VYSE_AS_NUM(value);
+			std::memcpy(bytes, &num, sizeof(number));
+			for (const u8 byte : bytes) mix(byte);
+		} else if (VYSE_IS_BOOL(value)) {
+			mix(VYSE_AS_BOOL(value));
+		}
+	}
+
+	mix(u8(code.param_count()));
+	return hash;
+}
+
+std::string export_name(std::string_view name) {
+	return "aot_module_" + std::string(name);
+}
+
+/// @brief Formats [num] as a C++ expression that evaluates to exactly the same number.
+static std::string number_literal(number num) {
+	if (std::isnan(num)) return "NAN";
+	if (std::isinf(num)) return num > 0 ? "HUGE_VAL" : "-HUGE_VAL";
+
+	char buf[64];
+	if (num == std::trunc(num) and std::abs(num) < 1e15) {
+		std::snprintf(buf, sizeof(buf), "%.1f", num);
+	} else {
+		// Hexadecimal floating point literals are exact.
+		std::snprintf(buf, sizeof(buf), "%a", num);
+	}
+	return buf;
+}
+
+/// @brief Formats [text] as a sequence of C++ string literals, one per line.
+static std::string string_literal(std::string_view text) {
+	std::string out = "\t\"";
+	for (const char c : text) {
+		switch (c) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\t': out += "\\t"; break;
+		case '\r': out += "\\r"; break;
+		case '\n': out += "\\n\"\n\t\""; break;
+		default:
+			if (u8(c) < 0x20 or u8(c) >= 0x7f) {
+				char buf[8];
+				std::snprintf(buf, sizeof(buf), "\\%03o", unsigned(u8(c)));
+				out += buf;
+			} else {
+				out += c;
+			}
+		}
+	}
+	out += "\"";
+
+	// Don't end with an empty literal if the text ends with a newline.
+	const std::string_view empty_line = "\n\t\"\"";
+	const size_t n = empty_line.size();
+	if (out.size() > n and out.compare(out.size() - n, n, empty_line) == 0) {
+		out.resize(out.size() - n);
+	}
+	return out;
+}
+
+/// @brief Translates the bytecode of a single function to a C++ function. Every value on the
+/// function's stack frame becomes a local variable of the C++ function, so the height of the stack
+/// must be known at each instruction.
+class FunctionTranslator {
+  public:
+	FunctionTranslator(const CodeBlock& code, u32 index)
+		: m_code{code}, m_block{code.block()}, m_index{index} {}
+
+	/// @brief Finds the height of the stack at each reachable instruction.
+	/// @return false if the function can't be translated, in which case `error()` explains why.
+	bool analyze() {
+		if (m_code.is_lazy()) return fail("it has not been compiled");
+		if (m_code.is_vararg()) return fail("it is variadic");
+		if (m_code.upval_count() > 0) return fail("it captures variables");
+		if (m_block.code.empty()) return fail("it has no code");
+
+		m_depth.assign(m_block.op_count(), -1);
+		m_is_target.assign(m_block.op_count(), false);
+		m_length.assign(m_block.op_count(), 1);
+
+		// The stack frame starts with the callee, followed by the parameters.
+		std::vector<size_t> worklist;
+		if (!flow(0, m_code.param_count() + 1, worklist)) return false;
+
+		while (!worklist.empty()) {
+			size_t pc = worklist.back();
+			worklist.pop_back();
+
+			// Follow the code from [pc] until it stops falling through to the next instruction.
+			while (true) {
+				Step step;
+				if (!step_at(pc, m_depth[pc], step)) return false;
+				m_length[pc] = step.length;
+				if (step.target != NoTarget) {
+					m_is_target[step.target] = true;
+					if (!flow(step.target, step.target_depth, worklist)) return false;
+				}
+
+				if (!step.falls_through) break;
+				const size_t next = pc + step.length;
+				if (next >= m_block.op_count()) return fail("it runs past the end of it's code");
+				if (m_depth[next] != -1) {
+					if (m_depth[next] != step.depth) return fail("it's stack height is unknown");
+					break;
+				}
+				m_depth[next] = step.depth;
+				pc = next;
+			}
+		}
+
+		return true;
+	}
+
+	/// @brief Appends the C++ translation of the function to [out].
+	void emit(std::ostream& out) const {
+		kt::format_str(out, "// {}, line {}.\n", m_code.name_cstr(), m_block.line_at(0));
+		kt::format_str(out, "bool {}(const Value* frame, u32{}, Value& result) {\n", fn_name(),
+					   m_has_calls ? " depth" : "");
+
+		out << "\t[[maybe_unused]] Value s0 = frame[0]";
+		const int num_params = m_code.param_count();
+		for (int i = 1; i <= num_params; ++i) kt::format_str(out, ", s{} = frame[{}]", i, i);
+		for (int i = num_params + 1; i < m_max_depth; ++i) kt::format_str(out, ", s{}", i);
+		out << ";\n\n";
+
+		for (size_t pc = 0; pc < m_block.op_count();) {
+			if (m_depth[pc] == -1) {
+				// unreachable code.
+				++pc;
+				continue;
+			}
+
+			if (m_is_target[pc]) kt::format_str(out, "L{}:\n", pc);
+			const std::string stmt = emit_instr(pc, m_depth[pc]);
+			out << ((stmt.empty() and m_is_target[pc]) ? "\t;\n" : stmt);
+			pc += m_length[pc];
+		}
+
+		out << "}\n\n";
+	}
+
+	[[nodiscard]] std::string fn_name() const {
+		return "fn_" + std::to_string(m_index);
+	}
+
+	[[nodiscard]] const std::string& error() const noexcept {
+		return m_error;
+	}
+
+  private:
+	static constexpr size_t NoTarget = size_t(-1);
+
+	/// @brief The effect of an instruction on the stack and on control flow.
+	struct Step {
+		size_t length = 1;
+		/// Height of the stack after the instruction, if it falls through.
+		int depth = 0;
+		bool falls_through = true;
+		size_t target = NoTarget;
+		/// Height of the stack after the instruction, if it jumps to [target].
+		int target_depth = 0;
+	};
+
+	const CodeBlock& m_code;
+	const Block& m_block;
+	const u32 m_index;
+
+	/// @brief Height of the stack before each instruction, or -1 if it is unreachable.
+	std::vector<int> m_depth;
+	std::vector<bool> m_is_target;
+	/// @brief Length of each reachable instruction, including it's operands.
+	std::vector<size_t> m_length;
+	int m_max_depth = 0;
+	bool m_has_calls = false;
+	std::string m_error;
+
+	bool fail(std::string reason) {
+		m_error = std::move(reason);
+		return false;
+	}
+
+	bool flow(size_t pc, int depth, std::vector<size_t>& worklist) {
+		if (pc >= m_block.op_count()) return fail("it jumps out of it's code");
+		if (m_depth[pc] == -1) {
+			m_depth[pc] = depth;
+			worklist.push_back(pc);
+		} else if (m_depth[pc] != depth) {
+			return fail("it's stack height is unknown");
+		}
+		return true;
+	}
+
+	[[nodiscard]] u8 operand(size_t pc, size_t n) const {
+		return u8(m_block.code[pc + n]);
+	}
+
+	[[nodiscard]] u16 jump_distance(size_t pc) const {
+		return u16((operand(pc, 1) << 8) | operand(pc, 2));
+	}
+
+	/// @brief Computes the effect of the instruction at [pc] when the height of the stack is
+	/// [depth], and checks that it can be translated.
+	bool step_at(size_t pc, int depth, Step& step) {
+		const Op op = m_block.code[pc];
+		const auto needs = [&](size_t num_operands, int num_values) {
+			if (pc + num_operands >= m_block.op_count()) return fail("it's code is truncated");
+			if (depth < num_values) return fail("it's stack underflows");
+			step.length = num_operands + 1;
+			return true;
+		};
+
+		const auto result = [&](int delta) {
+			step.depth = depth + delta;
+			m_max_depth = std::max(m_max_depth, std::max(depth, step.depth));
+			return true;
+		};
+
+		switch (op) {
+		case Op::load_const: {
+			if (!needs(1, 0)) return false;
+			const Value v = m_block.constant_pool[operand(pc, 1)];
+			if (!VYSE_IS_NUM(v) and !VYSE_IS_BOOL(v) and !VYSE_IS_NIL(v)) {
+				return fail(kt::format_str("it uses a {} constant", value_type_name(v)));
+			}
+			return result(1);
+		}
+
+		case Op::load_nil: return needs(0, 0) and result(1);
+
+		case Op::get_var:
+			return needs(1, 0) and (operand(pc, 1) < depth or fail("it reads past it's frame")) and
+				   result(1);
+
+		case Op::set_var:
+			return needs(1, 1) and
+				   (operand(pc, 1) < depth - 1 or fail("it writes past it's frame")) and
+				   result(-1);
+
+		case Op::pop: return needs(0, 1) and result(-1);
+
+		case Op::add:
+		case Op::sub:
+		case Op::mult:
+		case Op::div:
+		case Op::mod:
+		case Op::exp:
+		case Op::add_nn:
+		case Op::sub_nn:
+		case Op::mult_nn:
+		case Op::gt:
+		case Op::lt:
+		case Op::gte:
+		case Op::lte:
+		case Op::gt_nn:
+		case Op::lt_nn:
+		case Op::gte_nn:
+		case Op::lte_nn:
+		case Op::eq:
+		case Op::neq:
+		case Op::lshift:
+		case Op::rshift:
+		case Op::band:
+		case Op::bxor:
+		case Op::bor: return needs(0, 2) and result(-1);
+
+		case Op::negate:
+		case Op::lnot:
+		case Op::bnot: return needs(0, 1) and result(0);
+
+		case Op::jmp:
+			if (!needs(2, 0)) return false;
+			step.falls_through = false;
+			step.target = pc + 3 + jump_distance(pc);
+			step.target_depth = depth;
+			return result(0);
+
+		case Op::jmp_back:
+			if (!needs(2, 0)) return false;
+			if (jump_distance(pc) > pc + 3) return fail("it jumps out of it's code");
+			step.falls_through = false;
+			step.target = pc + 3 - jump_distance(pc);
+			step.target_depth = depth;
+			return result(0);
+
+		case Op::jmp_if_true_or_pop:
+		case Op::jmp_if_false_or_pop:
+			if (!needs(2, 1)) return false;
+			step.target = pc + 3 + jump_distance(pc);
+			step.target_depth = depth;
+			return result(-1);
+
+		case Op::pop_jmp_if_false:
+			if (!needs(2, 1)) return false;
+			step.target = pc + 3 + jump_distance(pc);
+			step.target_depth = depth - 1;
+			return result(-1);
+
+		// [counter, limit, step] -> [counter, limit, step, i], then jump to the `for_loop`.
+		case Op::for_prep:
+			if (!needs(2, 3)) return false;
+			step.falls_through = false;
+			step.target = pc + 3 + jump_distance(pc);
+			step.target_depth = depth + 1;
+			return result(1);
+
+		case Op::for_loop:
+			if (!needs(2, 4)) return false;
+			if (jump_distance(pc) > pc + 3) return fail("it jumps out of it's code");
+			step.target = pc + 3 - jump_distance(pc);
+			step.target_depth = depth;
+			return result(0);
+
+		case Op::call_func: {
+			if (!needs(1, 1)) return false;
+			const int argc = operand(pc, 1);
+			if (argc + 1 > depth) return fail("it's stack underflows");
+			// Only calls to the function itself can be translated, so they must pass exactly as
+			// many arguments as it takes.
+			if (u32(argc) != m_code.param_count()) {
+				return fail(kt::format_str("it makes a call with {} arguments", argc));
+			}
+			m_has_calls = true;
+			return result(-argc);
+		}
+
+		case Op::return_val:
+			if (!needs(0, 1)) return false;
+			step.falls_through = false;
+			return result(0);
+
+		default: return fail(kt::format_str("it uses '{}'", op2s(op)));
+		}
+	}
+
+	/// @brief Returns the C++ code for the instruction at [pc], where the height of the stack is
+	/// [depth].
+	[[nodiscard]] std::string emit_instr(size_t pc, int depth) const {
+		const Op op = m_block.code[pc];
+		const auto slot = [](int index) { return "s" + std::to_string(index); };
+		const std::string top = depth > 0 ? slot(depth - 1) : "";
+		const std::string below = depth > 1 ? slot(depth - 2) : "";
+
+		// Hands the call back to the interpreter unless [cond] holds.
+		const auto guard = [](const std::string& cond) {
+			return kt::format_str("\tif (!({})) return false;\n", cond);
+		};
+
+		const auto check_nums = [&] {
+			return guard(kt::format_str("VYSE_IS_NUM({}) and VYSE_IS_NUM({})", below, top));
+		};
+
+		const auto arith = [&](const char* op, bool checked) {
+			return (checked ? check_nums() : "") +
+				   kt::format_str("\t{} = VYSE_NUM(VYSE_AS_NUM({}) {} VYSE_AS_NUM({}));\n", below,
+								  below, op, top);
+		};
+
+		const auto compare = [&](const char* op, bool checked) {
+			return (checked ? check_nums() : "") +
+				   kt::format_str("\t{} = VYSE_BOOL(VYSE_AS_NUM({}) {} VYSE_AS_NUM({}));\n", below,
+								  below, op, top);
+		};
+
+		const auto bitwise = [&](const char* op) {
+			return check_nums() +
+				   kt::format_str("\t{} = VYSE_NUM(VYSE_CAST_INT({}) {} VYSE_CAST_INT({}));\n",
+								  below, below, op, top);
+		};
+
+		const auto falsy = [](const std::string& v) {
+			return kt::format_str("VYSE_IS_NIL({}) or VYSE_IS_FALSE({})", v, v);
+		};
+
+		const auto jump_target = [&] {
+			const u16 dist = jump_distance(pc);
+			return (op == Op::jmp_back or op == Op::for_loop) ? pc + 3 - dist : pc + 3 + dist;
+		};
+
+		switch (op) {
+		case Op::load_const: {
+			const Value v = m_block.constant_pool[operand(pc, 1)];
+			std::string literal = "VYSE_NIL";
+			if (VYSE_IS_NUM(v)) literal = "VYSE_NUM(" + number_literal(VYSE_AS_NUM(v)) + ")";
+			if (VYSE_IS_BOOL(v)) literal = VYSE_AS_BOOL(v) ? "VYSE_BOOL(true)" : "VYSE_BOOL(false)";
+			return kt::format_str("\t{} = {};\n", slot(depth), literal);
+		}
+
+		case Op::load_nil: return kt::format_str("\t{} = VYSE_NIL;\n", slot(depth));
+		case Op::get_var: return kt::format_str("\t{} = {};\n", slot(depth), slot(operand(pc, 1)));
+		case Op::set_var: return kt::format_str("\t{} = {};\n", slot(operand(pc, 1)), top);
+		case Op::pop: return "";
+
+		case Op::add: return arith("+", true);
+		case Op::sub: return arith("-", true);
+		case Op::mult: return arith("*", true);
+		case Op::add_nn: return arith("+", false);
+		case Op::sub_nn: return arith("-", false);
+		case Op::mult_nn: return arith("*", false);
+
+		case Op::div:
+			return check_nums() + guard(kt::format_str("VYSE_AS_NUM({}) != 0", below)) +
+				   arith("/", false);
+
+		case Op::mod:
+			return check_nums() +
+				   kt::format_str("\t{} = VYSE_NUM(std::fmod(VYSE_AS_NUM({}), VYSE_AS_NUM({})));\n",
+								  below, below, top);
+
+		case Op::exp:
+			return check_nums() +
+				   kt::format_str("\t{} = VYSE_NUM(std::pow(VYSE_AS_NUM({}), VYSE_AS_NUM({})));\n",
+								  below, below, top);
+
+		case Op::gt: return compare(">", true);
+		case Op::lt: return compare("<", true);
+		case Op::gte: return compare(">=", true);
+		case Op::lte: return compare("<=", true);
+		case Op::gt_nn: return compare(">", false);
+		case Op::lt_nn: return compare("<", false);
+		case Op::gte_nn: return compare(">=", false);
+		case Op::lte_nn: return compare("<=", false);
+
+		case Op::eq:
+			return kt::format_str("\t{} = VYSE_BOOL(aot::equal({}, {}));\n", below, top, below);
+		case Op::neq:
+			return kt::format_str("\t{} = VYSE_BOOL(!aot::equal({}, {}));\n", below, top, below);
+
+		case Op::lshift: return bitwise("<<");
+		case Op::rshift: return bitwise(">>");
+		case Op::band: return bitwise("&");
+		case Op::bxor: return bitwise("^");
+		case Op::bor: return bitwise("|");
+
+		case Op::negate:
+			return guard(kt::format_str("VYSE_IS_NUM({})", top)) +
+				   kt::format_str("\t{} = VYSE_NUM(-VYSE_AS_NUM({}));\n", top, top);
+
+		case Op::bnot:
+			return guard(kt::format_str("VYSE_IS_NUM({})", top)) +
+				   kt::format_str("\t{} = VYSE_NUM(~VYSE_CAST_INT({}));\n", top, top);
+
+		case Op::lnot: return kt::format_str("\t{} = VYSE_BOOL({});\n", top, falsy(top));
+
+		case Op::jmp:
+		case Op::jmp_back: return kt::format_str("\tgoto L{};\n", jump_target());
+
+		case Op::jmp_if_true_or_pop:
+			return kt::format_str("\tif (!({})) goto L{};\n", falsy(top), jump_target());
+
+		case Op::jmp_if_false_or_pop:
+		case Op::pop_jmp_if_false:
+			return kt::format_str("\tif ({}) goto L{};\n", falsy(top), jump_target());
+
+		case Op::for_prep: {
+			const std::string counter = slot(depth - 3), limit = slot(depth - 2);
+			return guard(kt::format_str("VYSE_IS_NUM({}) and VYSE_IS_NUM({}) and VYSE_IS_NUM({})",
+										counter, limit, top)) +
+				   kt::format_str("\t{} = VYSE_NUM(VYSE_AS_NUM({}) - VYSE_AS_NUM({}));\n", counter,
+								  counter, top) +
+				   kt::format_str("\t{} = {};\n", slot(depth), counter) +
+				   kt::format_str("\tgoto L{};\n", jump_target());
+		}
+
+		case Op::for_loop: {
+			const std::string counter = slot(depth - 4), limit = slot(depth - 3),
+							  step = slot(depth - 2);
+			std::ostringstream out;
+			out << "\t{\n";
+			kt::format_str(out, "\t\tconst number step = VYSE_AS_NUM({});\n", step);
+			kt::format_str(out, "\t\t{} = VYSE_NUM(VYSE_AS_NUM({}) + step);\n", counter, counter);
+			kt::format_str(out, "\t\t{} = {};\n", top, counter);
+			kt::format_str(out,
+						   "\t\tif (step >= 0 ? VYSE_AS_NUM({}) < VYSE_AS_NUM({})\n"
+						   "\t\t              : VYSE_AS_NUM({}) >= VYSE_AS_NUM({})) goto L{};\n",
+						   counter, limit, counter, limit, jump_target());
+			out << "\t}\n";
+			return out.str();
+		}
+
+		case Op::call_func: {
+			const int argc = operand(pc, 1);
+			const int callee = depth - argc - 1;
+			std::ostringstream out;
+			out << "\t{\n";
+			kt::format_str(out,
+						   "\t\tif (!VYSE_IS_OBJECT({}) or VYSE_AS_OBJECT({}) != "
+						   "VYSE_AS_OBJECT(frame[0]) or\n\t\t    depth == 0) return false;\n",
+						   slot(callee), slot(callee));
+			out << "\t\tconst Value args[] = {" << slot(callee);
+			for (int i = 1; i <= argc; ++i) out << ", " << slot(callee + i);
+			out << "};\n";
+			out << "\t\tValue ret;\n";
+			kt::format_str(out, "\t\tif (!{}(args, depth - 1, ret)) return false;\n", fn_name());
+			kt::format_str(out, "\t\t{} = ret;\n", slot(callee));
+			out << "\t}\n";
+			return out.str();
+		}
+
+		case Op::return_val: return kt::format_str("\tresult = {};\n\treturn true;\n", top);
+
+		default: VYSE_UNREACHABLE(); return "";
+		}
+	}
+};
+
+std::string translate(const CodeBlock& script, std::string_view source, std::string_view name) {
+	std::ostringstream functions;
+	std::ostringstream table;
+
+	walk_code_blocks(script, [&](const CodeBlock& code, u32 index) {
+		// The top level code of the script only runs once.
+		if (index == 0) return;
+
+		FunctionTranslator translator{code, index};
+		if (!translator.analyze()) {
+			const u32 line = code.block().code.empty() ? 0 : code.block().line_at(0);
+			kt::format_str(functions, "// {}, line {}, is not translated: {}.\n\n",
+						   code.name_cstr(), line, translator.error());
+			return;
+		}
+
+		translator.emit(functions);
+		kt::format_str(table, "\t{{}, {}u, {}},\n", index, checksum(code), translator.fn_name());
+	});
+
+	std::ostringstream out;
+	kt::format_str(out, "// Generated by `vy --emit-cpp` from the module '{}'. Do not edit.\n",
+				   name);
+	out << "// Build this file into a shared library named after the module, and place it next to\n"
+		   "// the module's source file. `import` will then run the functions below in place of\n"
+		   "// their bytecode.\n";
+	out << "#include <aot.hpp>\n#include <cmath>\n\nusing namespace vy;\n\nnamespace {\n\n";
+	out << functions.str();
+
+	const std::string entries = table.str();
+	if (!entries.empty()) out << "const aot::Function functions[] = {\n" << entries << "};\n\n";
+
+	out << "const char source[] =\n" << string_literal(source) << ";\n\n";
+	if (entries.empty()) {
+		out << "const aot::Module module{source, nullptr, 0};\n\n";
+	} else {
+		out << "const aot::Module module{source, functions, sizeof(functions) / "
+			   "sizeof(functions[0])};\n\n";
+	}
+
+	out << "} // namespace\n\n";
+	kt::format_str(out, "VYSE_API const aot::Module* {}() {\n\treturn &module;\n}\n",
+				   export_name(name));
+	return out.str();
+}
+
+size_t attach(CodeBlock& script, const Module& module) {
+	size_t num_attached = 0;
+
+	// The functions of a module are listed in the order of their position in the walk.
+	const Function* next = module.functions;
+	const Function* const end = module.functions + module.num_functions;
+
+	walk_code_blocks(script, [&](CodeBlock& code, u32 index) {
+		while (next != end and next->index < index) ++next;
+		if (next == end or next->index != index) return;
+		if (!code.is_lazy() and next->checksum == checksum(code)) {
+			code.m_compiled = next->fn;
+			++num_attached;
+		}
+	});
+
+	return num_attached;
+}
+
+} // namespace vy::aot
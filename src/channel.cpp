@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <channel.hpp>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vm.hpp>
+
+namespace vy {
+
+namespace {
+
+/// @brief The named channels of the process. A channel is removed from it when it is closed.
+struct Registry {
+	std::mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<Channel>> channels;
+};
+
+Registry& registry() {
+	static Registry registry;
+	return registry;
+}
+
+/// @brief Waits a little longer on each call. It starts by yielding the thread, so that a message
+/// that is about to arrive is picked up quickly, and then sleeps, so that a VM waiting on a quiet
+/// channel doesn't keep a core busy.
+class Backoff {
+  public:
+	void wait() {
+		if (m_step < YieldSteps) {
+			std::this_thread::yield();
+		} else {
+			const uint doublings = std::min(m_step - YieldSteps, 5u);
+			std::this_thread::sleep_for(std::min(MaxSleep, MinSleep * (1 << doublings)));
+		}
+		++m_step;
+	}
+
+  private:
+	static constexpr uint YieldSteps = 64;
+	static constexpr std::chrono::microseconds MinSleep{50};
+	static constexpr std::chrono::microseconds MaxSleep{1000};
+	uint m_step = 0;
+};
+
+} // namespace
+
+/// @return The number of slots in a channel with room for [capacity] messages.
+static size_t num_slots(size_t capacity) noexcept {
+	size_t slots = 2;
+	while (slots < capacity) slots <<= 1;
+	return slots;
+}
+
+Channel::Channel(size_t capacity)
+	: m_slots(new Slot[num_slots(capacity)]), m_mask(num_slots(capacity) - 1) {
+	VYSE_ASSERT(capacity <= MaxCapacity, "Channel capacity too large.");
+	for (size_t i = 0; i <= m_mask; ++i) {
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+std::shared_ptr<Channel> Channel::open(const std::string& name, size_t capacity) {
+	Registry& channels = registry();
+	std::lock_guard<std::mutex> lock(channels.mutex);
+
+	std::shared_ptr<Channel>& channel = channels.channels[name];
+	if (channel == nullptr) {
+		channel = std::make_shared<Channel>(capacity);
+		channel->m_name = name;
+	}
+	return channel;
+}
+
+bool Channel::pack(Value value, Message& message, Value& bad_value) {
+	message = Message{value, nullptr, false};
+	if (!VYSE_IS_OBJECT(value)) return true;
+
+	const Obj& object = *VYSE_AS_OBJECT(value);
+	if (object.is_frozen()) {
+		message.region = FrozenRegion::of(object);
+		return true;
+	}
+
+	message.region = FrozenRegion::freeze(value, bad_value);
+	if (message.region == nullptr) return false;
+	message.value = message.region->root();
+	message.copy = true;
+	return true;
+}
+
+Value Channel::unpack(VM& vm, const Message& message) {
+	if (message.region == nullptr) return message.value;
+	if (message.copy) return message.region->thaw(vm);
+	vm.adopt_collectable(message.region);
+	return message.value;
+}
+
+bool Channel::try_send(Message& message) {
+	size_t pos = m_send_pos.load(std::memory_order_relaxed);
+	while (true) {
+		Slot& slot = m_slots[pos & m_mask];
+		const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		const auto diff = std::ptrdiff_t(sequence - pos);
+		if (diff == 0) {
+			// The slot is free. Claim it, unless another sender got to it first.
+			if (m_send_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.message = std::move(message);
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			// The slot still holds a message from the previous lap, so the channel is full.
+			return false;
+		} else {
+			pos = m_send_pos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool Channel::try_recv(Message& message) {
+	size_t pos = m_recv_pos.load(std::memory_order_relaxed);
+	while (true) {
+		Slot& slot = m_slots[pos & m_mask];
+		const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		const auto diff = std::ptrdiff_t(sequence - (pos + 1));
+		if (diff == 0) {
+			if (m_recv_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				message = std::move(slot.message);
+				slot.message = Message{};
+				// Free the slot for the send that is one lap ahead.
+				slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			// Nothing has been sent to this slot yet, so the channel is empty.
+			return false;
+		} else {
+			pos = m_recv_pos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool Channel::send(Message& message) {
+	for (Backoff backoff;; backoff.wait()) {
+		if (is_closed()) return false;
+		if (try_send(message)) return true;
+	}
+}
+
+bool Channel::recv(Message& message) {
+	for (Backoff backoff;; backoff.wait()) {
+		if (try_recv(message)) return true;
+		// A message may have been sent just before the channel was closed.
+		if (is_closed()) return try_recv(message);
+	}
+}
+
+void Channel::close() {
+	if (m_closed.exchange(true, std::memory_order_acq_rel)) return;
+	if (m_name.empty()) return;
+
+	Registry& channels = registry();
+	std::lock_guard<std::mutex> lock(channels.mutex);
+	const auto it = channels.channels.find(m_name);
+	if (it != channels.channels.end() and it->second.get() == this) channels.channels.erase(it);
+}
+
+size_t Channel::length() const noexcept {
+	const size_t sent = m_send_pos.load(std::memory_order_acquire);
+	const size_t received = m_recv_pos.load(std::memory_order_acquire);
+	return sent > received ? sent - received : 0;
+}
+
+} // namespace vy
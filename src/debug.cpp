@@ -22,10 +22,10 @@ const char* op2s(Op op) {
 }
 
 static void print_line(const Block& block, size_t index) {
-	if (index == 0 or block.lines[index] == block.lines[index - 1]) {
+	if (index == 0 or block.line_at(index) == block.line_at(index - 1)) {
 		printf("   |	");
 	} else {
-		printf("\n%04d	", block.lines[index]);
+		printf("\n%04d	", block.line_at(index));
 	}
 }
 
@@ -69,12 +69,22 @@ static size_t instr_two_operand(const Block& block, size_t index) {
 	return 3;
 }
 
+static size_t constant_arg_instr(const Block& block, Op op, size_t index) {
+	const u8 name_index = u8(block.code[index + 1]);
+	const u8 argc = u8(block.code[index + 2]);
+	print_line(block, index);
+	printf("%-4zu  %-22s  %d\t(", index, op2s(op), name_index);
+	print_value(block.constant_pool[name_index]);
+	printf(") %d\n", argc);
+	return 3;
+}
+
 size_t disassemble_instr(const Block& block, Op op, size_t offset) {
 
 	if (op == Op::make_func) {
 		const int old_loc = offset;
 
-		printf("%04d	", block.lines[offset]);
+		printf("%04d	", block.line_at(offset));
 		printf("%-4zu  %-22s  ", offset++, op2s(op));
 		print_value(block.constant_pool[(size_t)block.code[offset]]);
 		printf("\n");
@@ -91,6 +101,11 @@ size_t disassemble_instr(const Block& block, Op op, size_t offset) {
 		return offset - old_loc + 1;
 	}
 
+	if (op == Op::invoke or op == Op::invoke_spread or op == Op::invoke_intrinsic or
+		op == Op::inline_guard or op == Op::struct_get or op == Op::struct_set) {
+		return constant_arg_instr(block, op, offset);
+	}
+
 	if (op >= Op_0_operands_start and op <= Op_0_operands_end) {
 		return simple_instr(block, op, offset);
 	} else if (op >= Op_const_start and op <= Op_const_end) {
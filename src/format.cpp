@@ -0,0 +1,317 @@
+#include "str_format.hpp"
+#include <cctype>
+#include <cmath>
+#include <compiler.hpp>
+#include <cstdio>
+#include <format.hpp>
+#include <string.hpp>
+#include <value.hpp>
+
+namespace vy {
+
+static bool is_align_char(char c) {
+	return c == '<' or c == '>' or c == '^';
+}
+
+static bool is_type_char(char c) {
+	switch (c) {
+	case 'f':
+	case 'e':
+	case 'g':
+	case 'd':
+	case 'x':
+	case 'X':
+	case 'o':
+	case 'b':
+	case 's': return true;
+	default: return false;
+	}
+}
+
+/// @brief Reads a run of decimal digits starting at [pos] into [value], advancing [pos] past
+/// them.
+/// @return false if the number is larger than [max].
+static bool read_uint(std::string_view text, size_t& pos, u32 max, u32& value) {
+	value = 0;
+	bool fits = true;
+	while (pos < text.size() and isdigit(text[pos])) {
+		// Once the number is too large, the rest of it's digits are only skipped.
+		if (fits) {
+			value = value * 10 + (text[pos] - '0');
+			fits = value <= max;
+		}
+		++pos;
+	}
+	return fits;
+}
+
+/// @brief parses the spec [text] (the part after ':' in a replacement field) into [spec].
+static std::string parse_spec(std::string_view text, FormatSpec& spec) {
+	size_t pos = 0;
+
+	if (text.size() >= 2 and is_align_char(text[1])) {
+		spec.fill = text[0];
+		spec.align = text[1];
+		pos = 2;
+	} else if (!text.empty() and is_align_char(text[0])) {
+		spec.align = text[0];
+		pos = 1;
+	}
+
+	if (pos < text.size() and (text[pos] == '+' or text[pos] == '-')) {
+		spec.sign = text[pos++];
+	}
+
+	if (pos < text.size() and text[pos] == '0') {
+		spec.zero_pad = true;
+		++pos;
+	}
+
+	if (!read_uint(text, pos, MaxFormatWidth, spec.width)) {
+		return kt::format_str("width is larger than {}", MaxFormatWidth);
+	}
+
+	if (pos < text.size() and text[pos] == '.') {
+		++pos;
+		if (pos == text.size() or !isdigit(text[pos])) return "expected precision after '.'";
+		u32 precision = 0;
+		if (!read_uint(text, pos, MaxFormatWidth, precision)) {
+			return kt::format_str("precision is larger than {}", MaxFormatWidth);
+		}
+		spec.precision = int(precision);
+	}
+
+	if (pos < text.size() and is_type_char(text[pos])) {
+		spec.type = text[pos++];
+	}
+
+	if (pos != text.size()) {
+		return kt::format_str("unexpected '{}' in format spec", text[pos]);
+	}
+
+	return "";
+}
+
+std::string compile_format(std::string_view fmt, FormatTemplate& out) {
+	u32 next_auto_index = 0;
+	size_t literal_start = 0;
+
+	const auto add_literal = [&](size_t end) {
+		if (end > literal_start) {
+			FormatPiece piece;
+			piece.offset = literal_start;
+			piece.length = end - literal_start;
+			out.pieces.push_back(piece);
+			out.literal_length += piece.length;
+		}
+	};
+
+	for (size_t i = 0; i < fmt.size(); ++i) {
+		const char c = fmt[i];
+		if (c == '}') {
+			if (i + 1 == fmt.size() or fmt[i + 1] != '}') {
+				return kt::format_str("unmatched '}' at index {}", i);
+			}
+			// emit the literal text including the first '}' and skip the second.
+			add_literal(i + 1);
+			literal_start = i + 2;
+			++i;
+			continue;
+		}
+
+		if (c != '{') continue;
+
+		if (i + 1 < fmt.size() and fmt[i + 1] == '{') {
+			add_literal(i + 1);
+			literal_start = i + 2;
+			++i;
+			continue;
+		}
+
+		const size_t close = fmt.find('}', i);
+		if (close == std::string_view::npos) {
+			return kt::format_str("unterminated replacement field at index {}", i);
+		}
+
+		add_literal(i);
+
+		std::string_view field = fmt.substr(i + 1, close - i - 1);
+		FormatPiece piece;
+
+		size_t pos = 0;
+		if (pos < field.size() and isdigit(field[pos])) {
+			u32 arg_index = 0;
+			if (!read_uint(field, pos, Compiler::MaxFuncParams - 1, arg_index)) {
+				return kt::format_str("argument index larger than {} at index {}",
+									  Compiler::MaxFuncParams - 1, i);
+			}
+			piece.arg_index = int(arg_index);
+		} else {
+			piece.arg_index = next_auto_index++;
+		}
+
+		if (pos < field.size()) {
+			if (field[pos] != ':') {
+				return kt::format_str("invalid replacement field '{{}}' at index {}", field, i);
+			}
+
+			std::string error = parse_spec(field.substr(pos + 1), piece.spec);
+			if (!error.empty()) return error;
+		}
+
+		out.num_args = std::max(out.num_args, u32(piece.arg_index + 1));
+		out.pieces.push_back(piece);
+
+		i = close;
+		literal_start = close + 1;
+	}
+
+	add_literal(fmt.size());
+	return "";
+}
+
+/// @brief Appends [text] to [out], padded to the width in [spec]. [default_align] is used when
+/// the spec doesn't specify an alignment. [sign_len] is the number of leading characters in
+/// [text] that make up the sign, which zero padding is inserted after.
+static void write_padded(std::string& out, std::string_view text, const FormatSpec& spec,
+						 char default_align, size_t sign_len = 0) {
+	if (text.size() >= spec.width) {
+		out.append(text);
+		return;
+	}
+
+	const size_t padding = spec.width - text.size();
+
+	if (spec.zero_pad and spec.align == 0) {
+		out.append(text.substr(0, sign_len));
+		out.append(padding, '0');
+		out.append(text.substr(sign_len));
+		return;
+	}
+
+	const char align = spec.align ? spec.align : default_align;
+	size_t left = 0;
+	if (align == '>') {
+		left = padding;
+	} else if (align == '^') {
+		left = padding / 2;
+	}
+
+	out.append(left, spec.fill);
+	out.append(text);
+	out.append(padding - left, spec.fill);
+}
+
+/// @brief Writes the integer [n] in base [base] to [buf], which must be large enough to hold
+/// 64 binary digits. Returns the number of characters written.
+static size_t write_uint(char* buf, u64 n, u32 base, bool upper) {
+	const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char tmp[64];
+	size_t len = 0;
+	do {
+		tmp[len++] = digits[n % base];
+		n /= base;
+	} while (n != 0);
+
+	for (size_t i = 0; i < len; ++i) buf[i] = tmp[len - i - 1];
+	return len;
+}
+
+static std::string format_number(std::string& out, number num, const FormatSpec& spec) {
+	// Large enough for a sign followed by 64 binary digits.
+	char buf[72];
+	size_t len = 0;
+
+	const bool negative = std::signbit(num) and !std::isnan(num);
+	if (negative) {
+		buf[len++] = '-';
+	} else if (spec.sign == '+') {
+		buf[len++] = '+';
+	}
+
+	const number magnitude = std::fabs(num);
+
+	switch (spec.type) {
+	case 'd':
+	case 'x':
+	case 'X':
+	case 'o':
+	case 'b': {
+		if (!std::isfinite(magnitude) or magnitude >= 18446744073709551616.0 or
+			!is_integer(magnitude)) {
+			return kt::format_str("format type '{}' requires an integer, got {}", spec.type,
+								  value_to_string(VYSE_NUM(num)));
+		}
+
+		const u32 base = spec.type == 'd' ? 10 : spec.type == 'o' ? 8 : spec.type == 'b' ? 2 : 16;
+		len += write_uint(buf + len, u64(magnitude), base, spec.type == 'X');
+		write_padded(out, std::string_view(buf, len), spec, '>', len > 0 and !isdigit(buf[0]));
+		return "";
+	}
+
+	case 0:
+		if (spec.precision < 0) {
+			std::string text = value_to_string(VYSE_NUM(magnitude));
+			text.insert(0, buf, len);
+			write_padded(out, text, spec, '>', len);
+			return "";
+		}
+		[[fallthrough]];
+
+	case 'f':
+	case 'e':
+	case 'g': {
+		const int precision = spec.precision < 0 ? 6 : spec.precision;
+		const char conv[] = {'%', '.', '*', spec.type == 0 ? 'f' : spec.type, '\0'};
+		const int n = std::snprintf(nullptr, 0, conv, precision, magnitude);
+
+		std::string text(buf, len);
+		const size_t sign_len = len;
+		text.resize(sign_len + n);
+		std::snprintf(text.data() + sign_len, n + 1, conv, precision, magnitude);
+		write_padded(out, text, spec, '>', sign_len);
+		return "";
+	}
+
+	case 's': {
+		FormatSpec str_spec = spec;
+		str_spec.type = 0;
+		std::string text = value_to_string(VYSE_NUM(num));
+		if (spec.precision >= 0 and size_t(spec.precision) < text.size()) {
+			text.resize(spec.precision);
+		}
+		write_padded(out, text, str_spec, '<');
+		return "";
+	}
+
+	default: VYSE_UNREACHABLE();
+	}
+
+	return "";
+}
+
+std::string format_value(std::string& out, Value value, const FormatSpec& spec) {
+	if (VYSE_IS_NUM(value)) return format_number(out, VYSE_AS_NUM(value), spec);
+
+	if (spec.type != 0 and spec.type != 's') {
+		return kt::format_str("format type '{}' requires a number, got {}", spec.type,
+							  value_type_name(value));
+	}
+
+	if (VYSE_IS_STRING(value)) {
+		const String* string = VYSE_AS_STRING(value);
+		std::string_view text(string->c_str(), string->len());
+		if (spec.precision >= 0) text = text.substr(0, spec.precision);
+		write_padded(out, text, spec, '<');
+		return "";
+	}
+
+	std::string text = value_to_string(value);
+	if (spec.precision >= 0 and size_t(spec.precision) < text.size()) {
+		text.resize(spec.precision);
+	}
+	write_padded(out, text, spec, '<');
+	return "";
+}
+
+} // namespace vy
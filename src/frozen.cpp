@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <frozen.hpp>
+#include <function.hpp>
+#include <list.hpp>
+#include <struct.hpp>
+#include <table.hpp>
+#include <unordered_map>
+#include <upvalue.hpp>
+#include <vm.hpp>
+
+namespace vy {
+
+namespace {
+
+/// @brief Copies a graph of values into a frozen region. Each object is copied once: when it is
+/// first reached, an empty copy is made and queued, and the queue is then drained by filling in the
+/// copies. This keeps deep graphs from overflowing the C++ stack.
+class Freezer {
+  public:
+	/// @param vm The VM that functions in the graph belong to, or nullptr if functions can't be
+	/// frozen.
+	explicit Freezer(FrozenRegion& region, std::vector<Obj*>& objects,
+					 std::vector<std::shared_ptr<const FrozenRegion>>& dependencies,
+					 VM* vm) noexcept
+		: m_region(region), m_objects(objects), m_dependencies(dependencies), m_vm(vm) {}
+
+	/// @return false if a value that can't be frozen was reached, which is stored in [bad_value].
+	bool copy_graph(Value value, Value& root, Value& bad_value) {
+		if (!copy(value, root)) {
+			bad_value = value;
+			return false;
+		}
+
+		while (!m_pending.empty()) {
+			const auto [original, copy] = m_pending.back();
+			m_pending.pop_back();
+			if (!fill(*original, *copy, bad_value)) return false;
+		}
+
+		return true;
+	}
+
+  private:
+	const FrozenRegion& m_region;
+	std::vector<Obj*>& m_objects;
+	std::vector<std::shared_ptr<const FrozenRegion>>& m_dependencies;
+	VM* const m_vm;
+	std::unordered_map<const Obj*, Obj*> m_copies;
+	std::vector<std::pair<const Obj*, Obj*>> m_pending;
+
+	/// @brief Sets [out] to the copy of [value], making an empty one if there is none yet.
+	/// @return false if [value] can't be frozen.
+	bool copy(Value value, Value& out) {
+		if (!VYSE_IS_OBJECT(value)) {
+			out = value;
+			return true;
+		}
+
+		const Obj* const object = VYSE_AS_OBJECT(value);
+		if (const auto it = m_copies.find(object); it != m_copies.end()) {
+			out = VYSE_OBJECT(it->second);
+			return true;
+		}
+
+		if (object->is_frozen()) {
+			std::shared_ptr<const FrozenRegion> region = FrozenRegion::of(*object);
+			const bool known = region.get() == &m_region or
+							   std::find(m_dependencies.begin(), m_dependencies.end(), region) !=
+								   m_dependencies.end();
+			if (!known) {
+				m_dependencies.push_back(std::move(region));
+			}
+			out = value;
+			return true;
+		}
+
+		Obj* copy = nullptr;
+		switch (object->tag) {
+		case ObjType::string: {
+			const String* const string = static_cast<const String*>(object);
+			copy = new String(string->c_str(), string->len());
+			break;
+		}
+		case ObjType::table: copy = new Table(); break;
+		case ObjType::list: copy = new List(); break;
+		default:
+			if (m_vm == nullptr) return false;
+			copy = copy_code(*VYSE_AS_OBJECT(value));
+			if (copy == nullptr) return false;
+		}
+
+		m_objects.push_back(copy);
+		m_copies.emplace(object, copy);
+		// Strings hold no references, so they are complete as soon as they are made.
+		if (object->tag != ObjType::string) m_pending.emplace_back(object, copy);
+
+		out = VYSE_OBJECT(copy);
+		return true;
+	}
+
+	/// @brief Makes an empty copy of a function, or of an object that only functions refer to.
+	/// @return nullptr if [object] can't be frozen. Closures can't be frozen if they assign to a
+	/// variable they captured, since the variable is frozen along with them. Closures that are made
+	/// later from frozen code are checked by the VM instead, when they assign to it.
+	Obj* copy_code(Obj& object) {
+		switch (object.tag) {
+		case ObjType::closure: {
+			const Closure& closure = static_cast<const Closure&>(object);
+			CodeBlock& code_block = *closure.m_codeblock;
+			if (code_block.is_lazy() and !m_vm->compile_lazy(code_block)) return nullptr;
+			if (code_block.assigns_upvals()) return nullptr;
+
+			Value code;
+			if (!copy(VYSE_OBJECT(closure.m_codeblock), code)) return nullptr;
+			return new Closure(VYSE_AS_PROTO(code), closure.m_codeblock->upval_count());
+		}
+
+		case ObjType::codeblock: {
+			CodeBlock& code = static_cast<CodeBlock&>(object);
+			if (code.is_lazy() and !m_vm->compile_lazy(code)) return nullptr;
+			Value name;
+			copy(VYSE_OBJECT(const_cast<String*>(code.name())), name);
+			return new CodeBlock(VYSE_AS_STRING(name), code);
+		}
+
+		case ObjType::c_closure: {
+			const CClosure& cclosure = static_cast<const CClosure&>(object);
+			CClosure* const copy = new CClosure(cclosure.cfunc());
+			copy->m_intrinsic = cclosure.m_intrinsic;
+			return copy;
+		}
+
+		case ObjType::upvalue: {
+			Upvalue* const copy = new Upvalue(nullptr);
+			copy->m_value = &copy->closed;
+			return copy;
+		}
+
+		case ObjType::struct_type: {
+			Value name;
+			copy(VYSE_OBJECT(static_cast<StructType&>(object).m_name), name);
+			return new StructType(VYSE_AS_STRING(name));
+		}
+
+		default: return nullptr;
+		}
+	}
+
+	/// @brief Fills the empty [copy] with copies of the values in [original].
+	bool fill(const Obj& original, Obj& copy, Value& bad_value) {
+		bool ok = true;
+		const auto copy_into = [&](Value value, Value& out) {
+			if (ok and !this->copy(value, out)) {
+				bad_value = value;
+				ok = false;
+			}
+			return ok;
+		};
+
+		switch (original.tag) {
+		case ObjType::list: {
+			const List& list = static_cast<const List&>(original);
+			List& list_copy = static_cast<List&>(copy);
+			list_copy.reserve(list.length());
+			for (size_t i = 0; i < list.length(); ++i) {
+				Value item;
+				if (!copy_into(list[i], item)) return false;
+				list_copy.append(item);
+			}
+			return true;
+		}
+
+		case ObjType::table: {
+			const Table& table = static_cast<const Table&>(original);
+			Table& table_copy = static_cast<Table&>(copy);
+			table_copy.reserve(table.length());
+			table.for_each([&](Value key, Value value) {
+				Value key_copy, value_copy;
+				if (copy_into(key, key_copy) and copy_into(value, value_copy)) {
+					table_copy.set(key_copy, value_copy);
+				}
+			});
+
+			if (ok and table.m_proto_table != nullptr) {
+				Value proto;
+				if (!copy_into(VYSE_OBJECT(table.m_proto_table), proto)) return false;
+				table_copy.m_proto_table = VYSE_AS_TABLE(proto);
+			}
+			return ok;
+		}
+
+		case ObjType::closure: {
+			const Closure& closure = static_cast<const Closure&>(original);
+			Closure& closure_copy = static_cast<Closure&>(copy);
+			for (u32 i = 0; i < closure.m_codeblock->upval_count(); ++i) {
+				Value upval;
+				if (!copy_into(VYSE_OBJECT(closure.get_upval(i)), upval)) return false;
+				closure_copy.set_upval(i, static_cast<Upvalue*>(VYSE_AS_OBJECT(upval)));
+			}
+			return true;
+		}
+
+		case ObjType::codeblock: {
+			const Block& block = static_cast<const CodeBlock&>(original).block();
+			Block& block_copy = static_cast<CodeBlock&>(copy).block();
+			const std::vector<Value>& constants = block.constant_pool;
+			std::vector<Value>& constants_copy = block_copy.constant_pool;
+			for (size_t i = 0; i < constants.size(); ++i) {
+				if (!copy_into(constants[i], constants_copy[i])) return false;
+			}
+			return true;
+		}
+
+		case ObjType::c_closure: {
+			const CClosure& cclosure = static_cast<const CClosure&>(original);
+			if (cclosure.m_values == nullptr) return true;
+			Value values;
+			if (!copy_into(VYSE_OBJECT(cclosure.m_values), values)) return false;
+			static_cast<CClosure&>(copy).m_values = VYSE_AS_LIST(values);
+			return true;
+		}
+
+		case ObjType::upvalue: {
+			const Upvalue& upval = static_cast<const Upvalue&>(original);
+			return copy_into(*upval.m_value, static_cast<Upvalue&>(copy).closed);
+		}
+
+		case ObjType::struct_type: {
+			const StructType& type = static_cast<const StructType&>(original);
+			StructType& type_copy = static_cast<StructType&>(copy);
+			type_copy.m_fields.reserve(type.m_fields.size());
+			for (String* field : type.m_fields) {
+				Value field_copy;
+				copy_into(VYSE_OBJECT(field), field_copy);
+				type_copy.m_fields.push_back(VYSE_AS_STRING(field_copy));
+			}
+			return true;
+		}
+
+		default: VYSE_UNREACHABLE(); return false;
+		}
+	}
+};
+
+/// @brief Copies the objects of a region into a VM. This mirrors the `Freezer`.
+class Thawer {
+  public:
+	explicit Thawer(VM& vm, const FrozenRegion& region) noexcept : m_vm(vm), m_region(region) {}
+
+	Value copy_graph(Value root) {
+		const Value root_copy = copy(root);
+		while (!m_pending.empty()) {
+			const auto [original, copy] = m_pending.back();
+			m_pending.pop_back();
+			fill(*original, *copy);
+		}
+		return root_copy;
+	}
+
+  private:
+	VM& m_vm;
+	const FrozenRegion& m_region;
+	std::unordered_map<const Obj*, Obj*> m_copies;
+	std::vector<std::pair<const Obj*, Obj*>> m_pending;
+
+	Value copy(Value value) {
+		if (!VYSE_IS_OBJECT(value)) return value;
+
+		const Obj* const object = VYSE_AS_OBJECT(value);
+		if (const auto it = m_copies.find(object); it != m_copies.end()) {
+			return VYSE_OBJECT(it->second);
+		}
+
+		std::shared_ptr<const FrozenRegion> region = FrozenRegion::of(*object);
+		if (region.get() != &m_region) {
+			m_vm.adopt_collectable(std::move(region));
+			return value;
+		}
+
+		Obj* copy = nullptr;
+		switch (object->tag) {
+		case ObjType::string: {
+			const String* const string = static_cast<const String*>(object);
+			copy = &m_vm.make_string(string->c_str(), string->len());
+			break;
+		}
+		case ObjType::table: copy = &m_vm.make<Table>(); break;
+		case ObjType::list: copy = &m_vm.make<List>(); break;
+		default: VYSE_UNREACHABLE();
+		}
+
+		m_copies.emplace(object, copy);
+		if (object->tag != ObjType::string) m_pending.emplace_back(object, copy);
+		return VYSE_OBJECT(copy);
+	}
+
+	void fill(const Obj& original, Obj& copy) {
+		if (original.tag == ObjType::list) {
+			const List& list = static_cast<const List&>(original);
+			List& list_copy = static_cast<List&>(copy);
+			list_copy.reserve(list.length());
+			for (size_t i = 0; i < list.length(); ++i) list_copy.append(this->copy(list[i]));
+			return;
+		}
+
+		const Table& table = static_cast<const Table&>(original);
+		Table& table_copy = static_cast<Table&>(copy);
+		table_copy.reserve(table.length());
+		table.for_each([&](Value key, Value value) {
+			table_copy.set(this->copy(key), this->copy(value));
+		});
+		if (table.m_proto_table != nullptr) {
+			table_copy.m_proto_table = VYSE_AS_TABLE(this->copy(VYSE_OBJECT(table.m_proto_table)));
+		}
+	}
+};
+
+} // namespace
+
+std::shared_ptr<const FrozenRegion> FrozenRegion::freeze(Value value, Value& bad_value) {
+	return make(value, bad_value, nullptr);
+}
+
+std::shared_ptr<const FrozenRegion> FrozenRegion::freeze_code(VM& vm, Value value,
+																Value& bad_value) {
+	return make(value, bad_value, &vm);
+}
+
+std::shared_ptr<const FrozenRegion> FrozenRegion::make(Value value, Value& bad_value, VM* vm) {
+	std::shared_ptr<FrozenRegion> region(new FrozenRegion());
+	Freezer freezer(*region, region->m_objects, region->m_dependencies, vm);
+	if (!freezer.copy_graph(value, region->m_root, bad_value)) return nullptr;
+
+	for (Obj* object : region->m_objects) {
+		object->m_frozen = true;
+		// Frozen objects are never in a GC's list of objects, so their `next` pointer is used to
+		// find the region they belong to instead. They are also always marked, so that a GC that
+		// reaches one stops there without writing to it.
+		object->m_next = reinterpret_cast<uintptr_t>(region.get()) | Obj::MarkBit;
+		region->m_size += object->size();
+	}
+
+	return region;
+}
+
+FrozenRegion::~FrozenRegion() {
+	for (Obj* object : m_objects) Obj::destroy(object);
+}
+
+std::shared_ptr<const FrozenRegion> FrozenRegion::of(const Obj& object) {
+	return owner(object).shared_from_this();
+}
+
+const FrozenRegion& FrozenRegion::owner(const Obj& object) noexcept {
+	VYSE_ASSERT(object.is_frozen(), "Object is not frozen.");
+	return *reinterpret_cast<const FrozenRegion*>(object.m_next & ~Obj::MarkBit);
+}
+
+Value FrozenRegion::thaw(VM& vm) const {
+	// The copies aren't reachable from any root until they are returned, so the GC is kept from
+	// running while they are made.
+	vm.gc_off();
+	const Value root = Thawer(vm, *this).copy_graph(m_root);
+	vm.gc_on();
+	return root;
+}
+
+} // namespace vy
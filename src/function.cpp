@@ -12,6 +12,20 @@ u32 CodeBlock::add_param() {
 	return m_num_params;
 }
 
+CodeBlock::CodeBlock(String* name, const CodeBlock& other)
+	: Obj{ObjType::codeblock},
+	  m_compiled{other.m_compiled},
+	  m_name{name},
+	  m_num_params{other.m_num_params},
+	  m_num_upvals{other.m_num_upvals},
+	  max_stack_size{other.max_stack_size},
+	  m_block{other.m_block},
+	  m_is_variadic{other.m_is_variadic},
+	  m_collects_varargs{other.m_collects_varargs},
+	  m_assigns_upvals{other.m_assigns_upvals} {
+	VYSE_ASSERT(!other.is_lazy(), "Attempt to copy a function that hasn't been compiled.");
+}
+
 void CodeBlock::trace(GC& gc) {
 	gc.mark_object(m_name);
 	for (Value val : m_block.constant_pool) {
@@ -3,32 +3,57 @@
 
 namespace vy {
 
-List::List(size_t mincap)
-	: Obj(ObjType::list),
-	  m_capacity(pow2ceil(mincap + 1)), m_values{(Value*)malloc(sizeof(Value) * m_capacity)} {
+List::List(size_t mincap) : Obj(ObjType::list) {
+	if (mincap == 0) return;
+	reserve(mincap);
 	m_num_entries = mincap;
 	for (uint i = 0; i < m_num_entries; ++i) m_values[i] = VYSE_NIL;
 }
 
 List::~List() {
-	delete[] m_values;
+	free(m_values);
 }
 
 void List::ensure_capacity() {
 	VYSE_ASSERT(m_capacity >= m_num_entries, "Impossible list capacity.");
 	if (m_num_entries + 1 >= m_capacity) {
-		m_capacity *= GrowthFactor;
+		m_capacity = m_capacity == 0 ? MinCapacity : m_capacity * GrowthFactor;
 		m_values = (Value*)realloc(m_values, m_capacity * sizeof(Value));
 	}
 }
 
+void List::reserve(size_t num_items) {
+	// Like `ensure_capacity`, this keeps at least one free slot at the end.
+	if (num_items < m_capacity) return;
+	m_capacity = pow2ceil(num_items + 1);
+	m_values = (Value*)realloc(m_values, m_capacity * sizeof(Value));
+}
+
 void List::append(Value value) {
+	VYSE_ASSERT(!is_frozen(), "Attempt to modify a frozen list.");
 	ensure_capacity();
 	m_values[m_num_entries] = value;
 	++m_num_entries;
 }
 
+void List::append_n(const Value* values, size_t count) {
+	VYSE_ASSERT(!is_frozen(), "Attempt to modify a frozen list.");
+	reserve(m_num_entries + count);
+	std::memcpy(m_values + m_num_entries, values, count * sizeof(Value));
+	m_num_entries += count;
+}
+
+void List::insert(size_t index, Value value) {
+	VYSE_ASSERT(!is_frozen(), "Attempt to modify a frozen list.");
+	VYSE_ASSERT(index <= m_num_entries, "List index out of range!");
+	ensure_capacity();
+	std::memmove(m_values + index + 1, m_values + index, (m_num_entries - index) * sizeof(Value));
+	m_values[index] = value;
+	++m_num_entries;
+}
+
 Value List::pop() noexcept {
+	VYSE_ASSERT(!is_frozen(), "Attempt to modify a frozen list.");
 	if (m_num_entries > 0) {
 		return m_values[--m_num_entries];
 	}
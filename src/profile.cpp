@@ -0,0 +1,263 @@
+#include <aot.hpp>
+#include <fstream>
+#include <profile.hpp>
+#include <sstream>
+#include <struct.hpp>
+#include <vm.hpp>
+
+namespace vy {
+
+using Op = Opcode;
+
+/// The first line of every profile file. The number is bumped whenever the format, or the
+/// meaning of the feedback in it, changes.
+static constexpr const char* ProfileHeader = "vyse-profile 1";
+
+struct MathIntrinsic {
+	const char* name;
+	Intrinsic id;
+};
+
+static constexpr MathIntrinsic math_intrinsics[] = {
+	{"sqrt", Intrinsic::sqrt}, {"floor", Intrinsic::floor}, {"ceil", Intrinsic::ceil},
+	{"abs", Intrinsic::abs},   {"sin", Intrinsic::sin},		{"cos", Intrinsic::cos},
+};
+
+const char* Profile::math_intrinsic_name(Intrinsic id) noexcept {
+	for (const MathIntrinsic& intrinsic : math_intrinsics) {
+		if (intrinsic.id == id) return intrinsic.name;
+	}
+	return nullptr;
+}
+
+static Intrinsic math_intrinsic(const std::string& name) noexcept {
+	for (const MathIntrinsic& intrinsic : math_intrinsics) {
+		if (name == intrinsic.name) return intrinsic.id;
+	}
+	return Intrinsic::none;
+}
+
+void Profile::Function::add_site(u32 offset, Site::Kind kind, const char* target) {
+	const auto [it, inserted] = sites.try_emplace(offset, Site{kind, target});
+	// A site that has seen more than one target can't be specialized.
+	if (!inserted and it->second.target != target) it->second.target.clear();
+}
+
+u64 Profile::hash_source(std::string_view source) noexcept {
+	// 64 bit FNV-1a.
+	u64 hash = 14695981039346656037ull;
+	for (const char c : source) hash = (hash ^ u8(c)) * 1099511628211ull;
+	return hash;
+}
+
+const Profile::Script* Profile::find(std::string_view source) const {
+	const u64 hash = hash_source(source);
+	for (const Script& script : m_scripts) {
+		if (script.source_hash == hash) return &script;
+	}
+	return nullptr;
+}
+
+void Profile::add(Script script) {
+	for (Script& old : m_scripts) {
+		if (old.source_hash == script.source_hash) {
+			old = std::move(script);
+			return;
+		}
+	}
+	m_scripts.push_back(std::move(script));
+}
+
+bool Profile::save(const std::string& path) const {
+	std::ofstream out(path);
+	out << ProfileHeader << '\n';
+	for (const Script& script : m_scripts) {
+		out << "script " << std::hex << script.source_hash << std::dec << ' ' << script.path
+			<< '\n';
+		for (const Function& func : script.functions) {
+			out << "function " << func.checksum << ' ' << func.compiled << ' ' << func.calls << ' '
+				<< func.loop_iterations << '\n';
+			for (const auto& [offset, site] : func.sites) {
+				out << "site " << offset << (site.kind == Site::Kind::call ? " call" : " field");
+				if (!site.target.empty()) out << ' ' << site.target;
+				out << '\n';
+			}
+		}
+	}
+	return bool(out);
+}
+
+bool Profile::load(const std::string& path) {
+	std::ifstream in(path);
+	std::string line;
+	if (!std::getline(in, line) or line != ProfileHeader) return false;
+
+	std::vector<Script> scripts;
+	while (std::getline(in, line)) {
+		std::istringstream fields(line);
+		std::string kind;
+		fields >> kind;
+
+		if (kind == "script") {
+			Script script;
+			fields >> std::hex >> script.source_hash >> std::dec;
+			fields.get();
+			std::getline(fields, script.path);
+			scripts.push_back(std::move(script));
+		} else if (kind == "function" and !scripts.empty()) {
+			Function func;
+			fields >> func.checksum >> func.compiled >> func.calls >> func.loop_iterations;
+			scripts.back().functions.push_back(std::move(func));
+		} else if (kind == "site" and !scripts.empty() and !scripts.back().functions.empty()) {
+			u32 offset = 0;
+			std::string site_kind, target;
+			fields >> offset >> site_kind;
+			if (site_kind != "call" and site_kind != "field") return false;
+			// A site that saw more than one target has none.
+			if (!fields.fail() and !fields.eof()) fields >> target;
+			const Site::Kind kind = site_kind == "call" ? Site::Kind::call : Site::Kind::field;
+			scripts.back().functions.back().sites[offset] = Site{kind, std::move(target)};
+		} else {
+			return false;
+		}
+
+		if (fields.fail()) return false;
+	}
+
+	for (Script& script : scripts) add(std::move(script));
+	return true;
+}
+
+/// @brief The struct types declared in a script, by name. A name declared more than once maps to
+/// nullptr, since a site that saw it can't tell which of them it was.
+using StructTypes = std::unordered_map<std::string, StructType*>;
+
+/// @brief Points the `struct_get` or `struct_set` at [offset] in [code] at [type].
+static bool specialize_field(CodeBlock& code, u32 offset, StructType& type) {
+	Block& block = code.block();
+	if (offset + 2 >= block.op_count()) return false;
+
+	const Op op = block.code[offset];
+	if (op != Op::struct_get and op != Op::struct_set) return false;
+
+	const Value guess = block.constant_pool[u8(block.code[offset + 1])];
+	const StructType& guessed_type = *VYSE_AS_STRUCT_TYPE(guess);
+	if (&guessed_type == &type) return false;
+
+	const String* const field = guessed_type.m_fields[u8(block.code[offset + 2])];
+	const int slot = type.field_index(VYSE_OBJECT(const_cast<String*>(field)));
+	if (slot == -1 or block.constant_pool.size() > UINT8_MAX) return false;
+
+	block.code[offset + 1] = Op(block.add_value(VYSE_OBJECT(&type)));
+	block.code[offset + 2] = Op(slot);
+	return true;
+}
+
+/// @brief Turns the call with one argument at [offset] in [code] into a call of the intrinsic
+/// [id]. Both instructions take the same space.
+static bool specialize_call(CodeBlock& code, u32 offset, Intrinsic id) {
+	Block& block = code.block();
+	if (offset + 1 >= block.op_count()) return false;
+	if (block.code[offset] != Op::call_func or u8(block.code[offset + 1]) != 1) return false;
+
+	block.code[offset] = Op::call_intrinsic;
+	block.code[offset + 1] = Op(id);
+	return true;
+}
+
+static size_t specialize(CodeBlock& code, const Profile::Function& feedback,
+						 const StructTypes& struct_types) {
+	size_t num_specialized = 0;
+	for (const auto& [offset, site] : feedback.sites) {
+		if (site.target.empty()) continue;
+
+		if (site.kind == Profile::Site::Kind::call) {
+			const Intrinsic id = math_intrinsic(site.target);
+			if (id != Intrinsic::none and specialize_call(code, offset, id)) ++num_specialized;
+			continue;
+		}
+
+		const auto it = struct_types.find(site.target);
+		if (it == struct_types.end() or it->second == nullptr) continue;
+		if (specialize_field(code, offset, *it->second)) ++num_specialized;
+	}
+	return num_specialized;
+}
+
+size_t Profile::apply(VM& vm, CodeBlock& script, const Script& feedback,
+					  ProfileRecorder* recorder) {
+	// First, compile the functions that had been compiled, so that the walk finds the same
+	// functions as the one the feedback was recorded in.
+	std::vector<std::pair<CodeBlock*, const Function*>> functions;
+	walk_code_blocks(script, [&](CodeBlock& code, u32 index) {
+		if (index >= feedback.functions.size()) return;
+		const Function& func = feedback.functions[index];
+		if (code.is_lazy() and func.compiled and !vm.compile_lazy(code)) return;
+		// A function with a C++ translation doesn't run it's bytecode.
+		if (code.is_lazy() or code.m_compiled != nullptr) return;
+		if (func.checksum == aot::checksum(code)) functions.emplace_back(&code, &func);
+	});
+
+	StructTypes struct_types;
+	walk_code_blocks(script, [&](CodeBlock& code, u32) {
+		for (const Value& value : code.block().constant_pool) {
+			if (!VYSE_IS_STRUCT_TYPE(value)) continue;
+			StructType* const type = VYSE_AS_STRUCT_TYPE(value);
+			const auto [it, inserted] = struct_types.try_emplace(type->m_name->c_str(), type);
+			if (!inserted and it->second != type) it->second = nullptr;
+		}
+	});
+
+	size_t num_specialized = 0;
+	for (const auto& [code, func] : functions) {
+		if (recorder != nullptr) recorder->seed(*code, *func);
+		num_specialized += specialize(*code, *func, struct_types);
+	}
+	return num_specialized;
+}
+
+void ProfileRecorder::add_script(CodeBlock& script, const SourceCode& source) {
+	m_scripts.push_back({&script, source.path, Profile::hash_source(source.code)});
+}
+
+void ProfileRecorder::seed(const CodeBlock& code, const Profile::Function& feedback) {
+	Profile::Function& func = function(code);
+	func.checksum = feedback.checksum;
+	func.calls += feedback.calls;
+	func.loop_iterations += feedback.loop_iterations;
+	for (const auto& [offset, site] : feedback.sites) {
+		func.add_site(offset, site.kind, site.target.c_str());
+	}
+}
+
+Profile::Function& ProfileRecorder::function(const CodeBlock& code) {
+	const auto [it, inserted] = m_functions.try_emplace(&code);
+	if (inserted) {
+		it->second.checksum = aot::checksum(code);
+		it->second.compiled = true;
+	}
+	return it->second;
+}
+
+void ProfileRecorder::save(Profile& profile) const {
+	for (const RecordedScript& recorded : m_scripts) {
+		Profile::Script script;
+		script.path = recorded.path;
+		script.source_hash = recorded.source_hash;
+		walk_code_blocks(*recorded.code, [&](const CodeBlock& code, u32) {
+			const auto it = m_functions.find(&code);
+			if (it != m_functions.end()) {
+				script.functions.push_back(it->second);
+				return;
+			}
+
+			Profile::Function func;
+			func.compiled = !code.is_lazy();
+			if (func.compiled) func.checksum = aot::checksum(code);
+			script.functions.push_back(std::move(func));
+		});
+		profile.add(std::move(script));
+	}
+}
+
+} // namespace vy
@@ -1,5 +1,9 @@
+#include <function.hpp>
 #include <gc.hpp>
 #include <list.hpp>
+#include <struct.hpp>
+#include <upvalue.hpp>
+#include <userdata.hpp>
 #include <value.hpp>
 #include <vm.hpp>
 
@@ -11,11 +15,80 @@
 
 namespace vy {
 
+using OT = ObjType;
+
+// The per-type dispatch for objects lives here, next to the GC loops that call it, so that they
+// can inline it.
+
+size_t Obj::size() const {
+	switch (tag) {
+	case OT::string: return static_cast<const String*>(this)->size();
+	case OT::codeblock: return static_cast<const CodeBlock*>(this)->size();
+	case OT::closure: return static_cast<const Closure*>(this)->size();
+	case OT::c_closure: return static_cast<const CClosure*>(this)->size();
+	case OT::upvalue: return static_cast<const Upvalue*>(this)->size();
+	case OT::table: return static_cast<const Table*>(this)->size();
+	case OT::list: return static_cast<const List*>(this)->size();
+	case OT::user_data: return static_cast<const UserData*>(this)->size();
+	case OT::struct_type: return static_cast<const StructType*>(this)->size();
+	case OT::struct_: return static_cast<const Struct*>(this)->size();
+	}
+	VYSE_UNREACHABLE();
+	return 0;
+}
+
+void Obj::trace(GC& gc) {
+	switch (tag) {
+	case OT::string: return static_cast<String*>(this)->trace(gc);
+	case OT::codeblock: return static_cast<CodeBlock*>(this)->trace(gc);
+	case OT::closure: return static_cast<Closure*>(this)->trace(gc);
+	case OT::c_closure: return static_cast<CClosure*>(this)->trace(gc);
+	case OT::upvalue: return static_cast<Upvalue*>(this)->trace(gc);
+	case OT::table: return static_cast<Table*>(this)->trace(gc);
+	case OT::list: return static_cast<List*>(this)->trace(gc);
+	case OT::user_data: return static_cast<UserData*>(this)->trace(gc);
+	case OT::struct_type: return static_cast<StructType*>(this)->trace(gc);
+	case OT::struct_: return static_cast<Struct*>(this)->trace(gc);
+	}
+	VYSE_UNREACHABLE();
+}
+
+void Obj::destroy(Obj* object) {
+	switch (object->tag) {
+	case OT::string: delete static_cast<String*>(object); return;
+	case OT::codeblock: delete static_cast<CodeBlock*>(object); return;
+	case OT::closure: delete static_cast<Closure*>(object); return;
+	case OT::c_closure: delete static_cast<CClosure*>(object); return;
+	case OT::upvalue: delete static_cast<Upvalue*>(object); return;
+	case OT::table: delete static_cast<Table*>(object); return;
+	case OT::list: delete static_cast<List*>(object); return;
+	case OT::user_data: delete static_cast<UserData*>(object); return;
+	case OT::struct_type: delete static_cast<StructType*>(object); return;
+	case OT::struct_: delete static_cast<Struct*>(object); return;
+	}
+	VYSE_UNREACHABLE();
+}
+
 void GC::mark_object(Obj* o) {
-	if (o == nullptr or o->marked) return;
+	if (o == nullptr) return;
+	if (o->marked()) {
+		// Frozen objects always look marked, so that they are never traced or written to.
+		if (o->is_frozen()) mark_region(*o);
+		return;
+	}
 	GC_LOG("marked: %p [%s] \n", (void*)o, value_to_string(VYSE_OBJECT(o)).c_str());
-	o->marked = true;
-	m_gray_objects.push(o);
+	o->set_marked(true);
+	// Strings don't refer to other objects, so there is nothing to trace.
+	if (o->tag != OT::string) m_gray_objects.push(o);
+}
+
+void GC::mark_region(const Obj& frozen) {
+	const FrozenRegion& region = FrozenRegion::owner(frozen);
+	VM::AdoptedRegion& adopted = m_vm->m_frozen_regions[&region];
+	// A region that wasn't adopted is one that an adopted region refers to. The VM now refers to
+	// it directly, so it has to outlive the region that brought it in.
+	if (adopted.region == nullptr) adopted.region = region.shared_from_this();
+	adopted.marked = true;
 }
 
 void GC::mark_compiler_roots() {
@@ -88,9 +161,43 @@ size_t GC::sweep() {
 	GC_LOG("-- Sweep --\n");
 
 	// Delete all the interned strings that haven't been reached by now.
-	m_vm->interned_strings.delete_white_string_keys();
+	m_vm->interned_strings.remove_if([](const String* string) { return !string->marked(); });
+
+	auto& regions = m_vm->m_frozen_regions;
+	const auto is_alive = [&](const String* string) {
+		if (!string->is_frozen()) return string->marked();
+		const auto it = regions.find(&FrozenRegion::owner(*string));
+		return it != regions.end() and (it->second.pinned or it->second.marked);
+	};
+
+	// Compiled format strings are cached by address, so the cache entries of strings that are
+	// about to be freed must go too.
+	auto& format_cache = m_vm->format_cache;
+	for (auto it = format_cache.begin(); it != format_cache.end();) {
+		if (is_alive(it->first)) {
+			++it;
+		} else {
+			it = format_cache.erase(it);
+		}
+	}
 
 	size_t bytes_freed = 0;
+	// Tables and lists grow after they have been allocated, so the size they were accounted with
+	// can be out of date. The live objects are measured again to keep `bytes_allocated` honest.
+	size_t bytes_live = 0;
+
+	// Frozen regions made or received by scripts are given up once none of their objects can be
+	// reached. Other VMs may still share them, so they are only freed with their last reference.
+	for (auto it = regions.begin(); it != regions.end();) {
+		VM::AdoptedRegion& adopted = it->second;
+		if (adopted.pinned or adopted.marked) {
+			if (!adopted.pinned) bytes_live += adopted.region->size();
+			adopted.marked = false;
+			++it;
+		} else {
+			it = regions.erase(it);
+		}
+	}
 
 	// By this point, the reachable parts of the heap has been scanned once and all objects that
 	// were reachable from the root set have been marked as alive. Now we can re-scan the entire
@@ -99,27 +206,28 @@ size_t GC::sweep() {
 	Obj* prev = nullptr;
 	Obj* current = m_objects;
 	while (current != nullptr) {
-		if (current->marked) {
-			current->marked = false;
+		if (current->marked()) {
+			current->set_marked(false);
+			bytes_live += current->size();
 			prev = current;
-			current = current->next;
+			current = current->next();
 		} else {
-			Obj* next = current->next;
+			Obj* next = current->next();
 
 			GC_LOG("Freed: %s", value_to_string(VYSE_OBJECT(current)).c_str());
 
 			bytes_freed += current->size();
-			delete current;
+			Obj::destroy(current);
 			if (prev == nullptr) {
 				m_objects = next;
 			} else {
-				prev->next = next;
+				prev->set_next(next);
 			}
 			current = next;
 		}
 	}
 
-	bytes_allocated -= bytes_freed;
+	bytes_allocated = bytes_live;
 	next_gc = bytes_allocated * (1 + GCHeapGrowth);
 	GC_LOG("-- [GC END] Freed %zu bytes | Next: %zu --\n\n", bytes_freed, next_gc);
 	return bytes_freed;
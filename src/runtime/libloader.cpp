@@ -1,10 +1,17 @@
 #include "source.hpp"
 #include "util/args.hpp"
+#include <aot.hpp>
 #include <cstdlib>
 #include <filesystem>
+#include <frozen.hpp>
 #include <iostream>
 #include <libloader.hpp>
 #include <list.hpp>
+#include <memory>
+#include <mutex>
+#include <stdlib/native_modules.hpp>
+#include <stdlib/vychannel.hpp>
+#include <stdlib/vyparallel.hpp>
 #include <string_view>
 #include <util/lib_util.hpp>
 #include <vm.hpp>
@@ -19,35 +26,180 @@ struct StdModule final {
 	const char* dll_name;
 };
 
-Value DynLoader::read_std_lib(VM& vm, const StdModule& module) {
-	if (std_dlls_path.empty()) return VYSE_NIL;
+/// @brief A module added with `register_native_module`.
+struct RegisteredModule final {
+	explicit RegisteredModule(NativeModuleLoader load) noexcept : load(load) {}
 
-	std::string init_func_name = std::string("load_") + module.module_name;
-	std::string dll_name{module.dll_name};
+	const NativeModuleLoader load;
 
-	auto cached_it = cached_dyn_libs.find(dll_name);
-	if (cached_it == cached_dyn_libs.end()) {
-		Lib lib(dll_name, std_dlls_path);
-		cached_dyn_libs.emplace(dll_name, std::move(lib));
+	/// Guards [built] and [table], which are set by the first VM that imports the module.
+	std::mutex mutex;
+	bool built = false;
+	/// The frozen table of the module, or nullptr if it couldn't be frozen.
+	std::shared_ptr<const FrozenRegion> table;
+
+	/// @return A new table with the fields of the module, made in [vm].
+	Value make(VM& vm);
+};
+
+/// @brief The native modules of the process, and the shared libraries they were found in.
+class ModuleRegistry final {
+	VYSE_NO_COPY(ModuleRegistry);
+	VYSE_NO_MOVE(ModuleRegistry);
+
+  public:
+	static ModuleRegistry& get() {
+		static ModuleRegistry registry;
+		return registry;
+	}
+
+	void add(const char* name, NativeModuleLoader load) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_modules[name] = std::make_shared<RegisteredModule>(load);
 	}
 
-	const Lib& lib = cached_dyn_libs.find(dll_name)->second;
-	if (!lib) return VYSE_NIL;
+	/// @return The module called [name], or nullptr if there is none.
+	std::shared_ptr<RegisteredModule> find(const char* name) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto it = m_modules.find(name);
+		return it == m_modules.end() ? nullptr : it->second;
+	}
 
-	if (auto init_lib = lib.find<void(VM*, Table*)>(init_func_name)) {
-		Table& t = vm.make<Table>();
-		init_lib(&vm, &t);
-		return VYSE_OBJECT(&t);
+	/// @return The function [func_name] of the shared library [dll_name] in the directory [path],
+	/// or nullptr if either of them can't be found.
+	NativeModuleLoader find_loader(const std::string& dll_name, const std::string& path,
+								   const std::string& func_name) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_libs.find(dll_name);
+		if (it == m_libs.end()) it = m_libs.emplace(dll_name, DynLoader::Lib(dll_name, path)).first;
+
+		const DynLoader::Lib& lib = it->second;
+		if (!lib) return nullptr;
+		return lib.find<void(VM*, Table*)>(func_name);
 	}
 
-	return VYSE_NIL;
+  private:
+	ModuleRegistry() {
+		// Modules that keep state shared by every VM in the process are always linked in, since
+		// each shared library that links vyse gets a copy of it's own.
+		add("channel", stdlib::channel::load_channel);
+		add("parallel", stdlib::parallel::load_parallel);
+
+#ifdef VYSE_STATIC_STDLIB
+		add("math", stdlib::math::load_math);
+		add("stats", stdlib::stats::load_stats);
+		add("time", stdlib::time::load_time);
+		add("heapq", stdlib::algo::load_heapq);
+		add("bisect", stdlib::algo::load_bisect);
+		add("collections", stdlib::collections::load_collections);
+#endif
+	}
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, std::shared_ptr<RegisteredModule>> m_modules;
+	/// Shared libraries are never closed, since the functions of the modules loaded from them may
+	/// be called by any VM until the process exits.
+	std::unordered_map<std::string, DynLoader::Lib> m_libs;
+};
+
+void register_native_module(const char* name, NativeModuleLoader load) {
+	VYSE_ASSERT(name != nullptr and load != nullptr, "Bad native module.");
+	ModuleRegistry::get().add(name, load);
+}
+
+Value RegisteredModule::make(VM& vm) {
+	std::shared_ptr<const FrozenRegion> region;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!built) {
+			built = true;
+			Table& module = vm.make<Table>();
+			GCLock module_lock = vm.gc_lock(&module);
+			load(&vm, &module);
+
+			Value bad_value;
+			table = FrozenRegion::freeze_code(vm, VYSE_OBJECT(&module), bad_value);
+			if (table == nullptr) return VYSE_OBJECT(&module);
+		}
+		region = table;
+	}
+
+	if (region == nullptr) {
+		Table& module = vm.make<Table>();
+		GCLock module_lock = vm.gc_lock(&module);
+		load(&vm, &module);
+		return VYSE_OBJECT(&module);
+	}
+
+	// Only the entries of the table are copied, so that scripts can still add fields to the
+	// module. The values are the frozen functions shared by every VM.
+	const Table& frozen = *VYSE_AS_TABLE(vm.adopt(std::move(region)));
+	Table& module = vm.make<Table>();
+	GCLock module_lock = vm.gc_lock(&module);
+	module.reserve(frozen.length());
+	frozen.for_each([&](Value key, Value value) {
+		// Frozen strings aren't interned, so the keys are interned in [vm] to keep field lookups
+		// on the module as fast as they are on any other table.
+		if (VYSE_IS_STRING(key)) {
+			const String& name = *VYSE_AS_STRING(key);
+			key = VYSE_OBJECT(&vm.make_string(name.c_str(), name.len()));
+		}
+		module.set(key, value);
+	});
+	return VYSE_OBJECT(&module);
+}
+
+NativeModuleLoader DynLoader::find_std_lib(const StdModule& module) const {
+	if (std_dlls_path.empty()) return nullptr;
+	const std::string init_func_name = std::string("load_") + module.module_name;
+	return ModuleRegistry::get().find_loader(module.dll_name, std_dlls_path, init_func_name);
+}
+
+/// @brief Normalizes [path], so that different spellings of a module's path are the same key.
+static std::string module_key(const std::string& path) {
+	return std::filesystem::path(path).lexically_normal().string();
+}
+
+const aot::Module* DynLoader::find_compiled_module(const std::string& path) {
+	const std::string key = module_key(path);
+	if (auto it = compiled_modules.find(key); it != compiled_modules.end()) return it->second;
+
+	const std::filesystem::path module_path{key};
+	const std::string name = module_path.stem().string();
+	Lib lib(name, module_path.parent_path().string());
+
+	const aot::Module* module = nullptr;
+	if (lib) {
+		if (auto get_module = lib.find<const aot::Module*()>(aot::export_name(name))) {
+			module = get_module();
+		}
+	}
+
+	// Keep the library loaded for as long as the module's functions may be called.
+	if (module != nullptr) cached_dyn_libs.emplace(key, std::move(lib));
+	compiled_modules.emplace(key, module);
+	return module;
 }
 
-static constexpr std::array<StdModule, 1> std_modules = {{
+void DynLoader::add_compiled_module(const std::string& path, const aot::Module& module) {
+	compiled_modules[module_key(path)] = &module;
+}
+
+static constexpr std::array<StdModule, 6> std_modules = {{
 #ifdef _WIN32
 	{"math", "libvymath"},
+	{"stats", "libvystats"},
+	{"time", "libvytime"},
+	{"heapq", "libvyalgo"},
+	{"bisect", "libvyalgo"},
+	{"collections", "libvycollections"},
 #else
 	{"math", "vymath"},
+	{"stats", "vystats"},
+	{"time", "vytime"},
+	{"heapq", "vyalgo"},
+	{"bisect", "vyalgo"},
+	{"collections", "vycollections"},
 #endif
 }};
 
@@ -55,10 +207,17 @@ Value load_std_module(VM& vm, int argc) {
 	util::Args args{vm, "load_std_module", 1, argc};
 	const String& modname = args.next<String>();
 
+	if (const auto module = ModuleRegistry::get().find(modname.c_str())) return module->make(vm);
+
 	for (const StdModule& module : std_modules) {
-		if (strcmp(module.module_name, modname.c_str()) == 0) {
-			return vm.dynloader.read_std_lib(vm, module);
-		}
+		if (strcmp(module.module_name, modname.c_str()) != 0) continue;
+
+		// A module found in a shared library is registered, so that the library is only searched
+		// for once.
+		const NativeModuleLoader load = vm.dynloader.find_std_lib(module);
+		if (load == nullptr) return VYSE_NIL;
+		register_native_module(module.module_name, load);
+		return ModuleRegistry::get().find(module.module_name)->make(vm);
 	}
 
 	return VYSE_NIL;
@@ -119,10 +278,24 @@ Value load_module_from_fs(VM& vm, int argc) {
 
 	auto maybe_source = SourceCode::from_path(resolved_module_path);
 	if (!maybe_source.has_value()) return VYSE_NIL;
-	
+
+	// A C++ translation of the module is only used if it was made from the module's current source.
+	const aot::Module* compiled = vm.dynloader.find_compiled_module(resolved_module_path);
+	if (compiled != nullptr and maybe_source->code != compiled->source) compiled = nullptr;
+
+	// Translations are attached to the module's functions by walking their bytecode, so all of them
+	// have to be compiled up front.
+	const bool lazy_compile = vm.lazy_compile;
+	vm.lazy_compile = lazy_compile and compiled == nullptr;
 	Closure* file_func = vm.compile(maybe_source.value());
+	vm.lazy_compile = lazy_compile;
+	if (compiled != nullptr and file_func != nullptr) {
+		aot::attach(*file_func->m_codeblock, *compiled);
+	}
+
 	vm.ensure_slots(1);
 	vm.m_stack.push(VYSE_OBJECT(file_func));
+	if (file_func != nullptr) vm.prepare_script(*file_func->m_codeblock);
 	vm.call(0);
 
 	vm.pop_source();
@@ -1,6 +1,7 @@
 #include "../str_format.hpp"
 #include "userdata.hpp"
 #include "util.hpp"
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <filesystem>
@@ -21,7 +22,8 @@
 
 #define ERROR(...) runtime_error(kt::format_str(__VA_ARGS__))
 #define INDEX_ERROR(v) ERROR("Attempt to index a '{}' value.", value_type_name(v))
-#define CURRENT_LINE() (m_current_block->lines[ip - 1])
+#define FROZEN_ERROR(v) ERROR("Attempt to modify a frozen {}.", value_type_name(v))
+#define CURRENT_LINE() (m_current_block->line_at(ip - 1))
 
 #define CHECK_TYPE(v, typ, ...)                                                                    \
 	if (!VYSE_CHECK_TT(v, typ)) {                                                                  \
@@ -86,6 +88,22 @@ using OT = ObjType;
 		}                                                                                          \
 	} while (false);
 
+// Arithmetic and comparison on operands that the compiler has proven to be numbers.
+#define UNCHECKED_BINOP(op)                                                                        \
+	do {                                                                                           \
+		VYSE_ASSERT(VYSE_IS_NUM(PEEK(1)) and VYSE_IS_NUM(PEEK(2)), "Operand is not a number.");    \
+		const number r = VYSE_AS_NUM(POP());                                                       \
+		Value& l = PEEK(1);                                                                        \
+		VYSE_SET_NUM(l, VYSE_AS_NUM(l) op r);                                                      \
+	} while (false);
+
+#define UNCHECKED_CMP_OP(op)                                                                       \
+	do {                                                                                           \
+		VYSE_ASSERT(VYSE_IS_NUM(PEEK(1)) and VYSE_IS_NUM(PEEK(2)), "Operand is not a number.");    \
+		const number r = VYSE_AS_NUM(POP());                                                       \
+		PEEK(1) = VYSE_BOOL(VYSE_AS_NUM(PEEK(1)) op r);                                            \
+	} while (false);
+
 #define BIT_BINOP(op, proto_method_name)                                                           \
 	Value& b = PEEK(1);                                                                            \
 	Value& a = PEEK(2);                                                                            \
@@ -97,6 +115,30 @@ using OT = ObjType;
 		return ExitCode::RuntimeError;                                                             \
 	}
 
+/// @brief Computes the unary math intrinsic [id] of [x], the same as the native function tagged
+/// with it would.
+static number run_math_intrinsic(Intrinsic id, number x) {
+	switch (id) {
+	case Intrinsic::sqrt: return std::sqrt(x);
+	case Intrinsic::floor: return std::floor(x);
+	case Intrinsic::ceil: return std::ceil(x);
+	case Intrinsic::abs: return std::abs(x);
+	case Intrinsic::sin: return std::sin(x);
+	case Intrinsic::cos: return std::cos(x);
+	default: VYSE_UNREACHABLE(); return x;
+	}
+}
+
+/// @brief Runs the list method intrinsic [id] on [list], storing the result in [result].
+/// @return false if the intrinsic can't handle the call, in which case the method must be called
+/// normally to report the error.
+static bool run_list_intrinsic(Intrinsic id, List& list, Value& result) {
+	if (id != Intrinsic::list_pop) return false;
+	if (list.length() == 0 or list.is_frozen()) return false;
+	result = list.pop();
+	return true;
+}
+
 #ifdef VYSE_DEBUG_RUNTIME
 void print_stack(Value* stack, size_t sp) {
 	printf("(%zu)[ ", sp);
@@ -130,6 +172,14 @@ ExitCode VM::run() {
 		case Op::gte: CMP_OP(>=, "__gte"); break;
 		case Op::lte: CMP_OP(<=, "__lte"); break;
 
+		case Op::add_nn: UNCHECKED_BINOP(+); break;
+		case Op::sub_nn: UNCHECKED_BINOP(-); break;
+		case Op::mult_nn: UNCHECKED_BINOP(*); break;
+		case Op::gt_nn: UNCHECKED_CMP_OP(>); break;
+		case Op::lt_nn: UNCHECKED_CMP_OP(<); break;
+		case Op::gte_nn: UNCHECKED_CMP_OP(>=); break;
+		case Op::lte_nn: UNCHECKED_CMP_OP(<=); break;
+
 		case Op::div: {
 			Value& l = PEEK(2);
 			const Value& r = PEEK(1);
@@ -227,6 +277,16 @@ ExitCode VM::run() {
 			break;
 		}
 
+		case Op::vararg_len: {
+			const Value rest = GET_VAR(NEXT_BYTE());
+			if (varargs_on_stack(rest)) {
+				PUSH(VYSE_NUM(m_current_frame->num_varargs));
+				break;
+			}
+			PUSH(rest);
+			[[fallthrough]];
+		}
+
 		case Op::len: {
 			const Value v = POP();
 			if (VYSE_IS_LIST(v)) {
@@ -278,9 +338,32 @@ ExitCode VM::run() {
 			break;
 		}
 
+		case Op::jump_table: {
+			const List& targets = *VYSE_AS_LIST(READ_VALUE());
+			const Value subject = POP();
+			if (!VYSE_IS_NUM(subject)) break;
+
+			// targets[0] holds the smallest pattern, and the rest hold the jump target for each
+			// pattern from there on (or nil, if there is no arm for that number).
+			const number index = VYSE_AS_NUM(subject) - VYSE_AS_NUM(targets[0]);
+			if (index >= 0 and index < targets.length() - 1 and is_integer(index)) {
+				const Value target = targets[size_t(index) + 1];
+				if (!VYSE_IS_NIL(target)) ip = size_t(VYSE_AS_NUM(target));
+			}
+			break;
+		}
+
+		case Op::match_table: {
+			const Table& targets = *VYSE_AS_TABLE(READ_VALUE());
+			const Value target = targets.get(POP());
+			if (!VYSE_IS_NIL(target)) ip = size_t(VYSE_AS_NUM(target));
+			break;
+		}
+
 		case Op::jmp_back: {
 			const u16 dist = FETCH_SHORT();
 			ip -= dist;
+			if (m_recorder != nullptr) ++recorded_function().loop_iterations;
 			break;
 		}
 
@@ -322,10 +405,12 @@ ExitCode VM::run() {
 			if (nstep >= 0) {
 				if (VYSE_AS_NUM(counter) < VYSE_AS_NUM(limit)) {
 					ip -= FETCH_SHORT();
+					if (m_recorder != nullptr) ++recorded_function().loop_iterations;
 					break;
 				} // else fall to 'ip += 2'
 			} else if (VYSE_AS_NUM(counter) >= VYSE_AS_NUM(limit)) {
 				ip -= FETCH_SHORT();
+				if (m_recorder != nullptr) ++recorded_function().loop_iterations;
 				break;
 			}
 
@@ -345,11 +430,78 @@ ExitCode VM::run() {
 			break;
 		}
 
+		case Op::vararg_get: {
+			const Value rest = GET_VAR(NEXT_BYTE());
+			Value& index = PEEK(1);
+			if (!varargs_on_stack(rest)) {
+				if (!get_subscript_of_value(rest, index, index)) return ExitCode::RuntimeError;
+				break;
+			}
+
+			const u32 num_varargs = m_current_frame->num_varargs;
+			if (!VYSE_IS_NUM(index)) return ERROR("List index not a number.");
+			const number idx = VYSE_AS_NUM(index);
+			if (idx < 0 or idx >= num_varargs) {
+				return ERROR("List index out of bounds. (index: {}, length: {})", idx, num_varargs);
+			}
+			index = m_current_frame->base[s64(idx) - num_varargs];
+			break;
+		}
+
+		case Op::vararg_pack: {
+			Value& rest = GET_VAR(NEXT_BYTE());
+			if (varargs_on_stack(rest)) {
+				const u32 num_varargs = m_current_frame->num_varargs;
+				const Value* const varargs = m_current_frame->base - num_varargs;
+				List& list = make<List>(num_varargs);
+				for (u32 i = 0; i < num_varargs; ++i) list[i] = varargs[i];
+				rest = VYSE_OBJECT(&list);
+			}
+			PUSH(rest);
+			break;
+		}
+
+		case Op::vararg_spread: {
+			const Value rest = GET_VAR(NEXT_BYTE());
+			u32 count;
+			if (varargs_on_stack(rest)) {
+				count = m_current_frame->num_varargs;
+				ensure_slots(count + 1);
+				const Value* const varargs = m_current_frame->base - count;
+				for (u32 i = 0; i < count; ++i) PUSH(varargs[i]);
+			} else if (VYSE_IS_LIST(rest)) {
+				const List& list = *VYSE_AS_LIST(rest);
+				count = list.length();
+				ensure_slots(count + 1);
+				for (u32 i = 0; i < count; ++i) PUSH(list[i]);
+			} else {
+				return ERROR("Attempt to spread a {} value.", value_type_name(rest));
+			}
+			PUSH(VYSE_NUM(count));
+			break;
+		}
+
+		case Op::peek: {
+			const u8 depth = NEXT_BYTE();
+			PUSH(PEEK(depth));
+			break;
+		}
+
+		case Op::inline_return: {
+			const Value result = POP();
+			m_stack.popn(NEXT_BYTE());
+			PUSH(result);
+			break;
+		}
+
 		case Op::set_upval: {
 			const u8 idx = NEXT_BYTE();
 			VYSE_ASSERT(m_current_frame->func->tag == OT::closure, "enclosing frame a CClosure!");
 			Closure* const cl = static_cast<Closure*>(m_current_frame->func);
-			*cl->get_upval(idx)->m_value = POP();
+			Upvalue* const upval = cl->get_upval(idx);
+			// Variables captured by a frozen function are shared by every VM that calls it.
+			if (upval->is_frozen()) return ERROR("Attempt to assign to a frozen variable.");
+			*upval->m_value = POP();
 			break;
 		}
 
@@ -404,14 +556,26 @@ ExitCode VM::run() {
 		}
 
 		case Op::new_list: {
-			PUSH(VYSE_OBJECT(&make<List>()));
+			List& list = make<List>();
+			list.reserve(NEXT_BYTE());
+			PUSH(VYSE_OBJECT(&list));
+			break;
+		}
+
+		case Op::list_append_n: {
+			// Only emitted for list literals, so the value below the items is always a list.
+			const u8 count = NEXT_BYTE();
+			VYSE_AS_LIST(PEEK(count + 1))->append_n(m_stack.top - count, count);
+			POPN(count);
 			break;
 		}
 
 		case Op::list_append: {
 			Value& vlist = PEEK(2);
-			if (VYSE_IS_LIST(vlist)) {
+			if (VYSE_IS_LIST(vlist) and !VYSE_IS_FROZEN(vlist)) {
 				VYSE_AS_LIST(vlist)->append(POP());
+			} else if (VYSE_IS_FROZEN(vlist)) {
+				return FROZEN_ERROR(vlist);
 			} else {
 				return ERROR("Attempt to append to a {} value. (Can only append to lists)",
 							 value_type_name(vlist));
@@ -420,7 +584,21 @@ ExitCode VM::run() {
 		}
 
 		case Op::new_table: {
-			PUSH(VYSE_OBJECT(&make<Table>()));
+			Table& table = make<Table>();
+			table.reserve(NEXT_BYTE());
+			PUSH(VYSE_OBJECT(&table));
+			break;
+		}
+
+		case Op::table_from_shape: {
+			const Table& shape = *VYSE_AS_TABLE(READ_VALUE());
+			const size_t num_fields = shape.length();
+			// The field values stay on the stack until they're copied into the table, so that
+			// the GC can see them if allocating the table triggers a collection.
+			Table& table = make<Table>();
+			table.copy_shape(shape, m_stack.top - num_fields);
+			POPN(num_fields);
+			PUSH(VYSE_OBJECT(&table));
 			break;
 		}
 
@@ -451,15 +629,10 @@ ExitCode VM::run() {
 			if (VYSE_IS_NIL(key)) return ERROR("Table key cannot be nil.");
 			const Value value = POP();
 			Value& object = PEEK(1);
-			if (VYSE_IS_TABLE(object)) {
+			if (VYSE_IS_TABLE(object) and !VYSE_IS_FROZEN(object)) {
 				VYSE_AS_TABLE(object)->set(key, value);
-			} else if (VYSE_IS_UDATA(object)) {
-				const UserData& udata = *VYSE_AS_UDATA(object);
-				if (!set_field_of_udata(udata, key, value)) {
-					return ExitCode::RuntimeError;
-				}
-			} else {
-				return INDEX_ERROR(object);
+			} else if (!set_field(object, key, value)) {
+				return ExitCode::RuntimeError;
 			}
 
 			m_stack.top[-1] = value; // assignment returns it's RHS
@@ -474,13 +647,8 @@ ExitCode VM::run() {
 			Value& dst = m_stack.top[-1];
 			if (VYSE_IS_TABLE(lhs)) {
 				dst = VYSE_AS_TABLE(lhs)->get(rhs);
-			} else if (VYSE_IS_UDATA(lhs)) {
-				const UserData& udata = *VYSE_AS_UDATA(lhs);
-				if (!get_field_of_udata(udata, rhs, dst)) {
-					return ExitCode::RuntimeError;
-				}
-			} else {
-				return INDEX_ERROR(lhs);
+			} else if (!get_field(lhs, rhs, dst)) {
+				return ExitCode::RuntimeError;
 			}
 			break;
 		}
@@ -492,16 +660,55 @@ ExitCode VM::run() {
 			const Value& rhs = READ_VALUE();
 			if (VYSE_IS_TABLE(lhs)) {
 				PUSH(VYSE_AS_TABLE(lhs)->get(rhs));
-			} else if (VYSE_IS_UDATA(lhs)) {
-				const UserData& udata = *VYSE_AS_UDATA(lhs);
+			} else {
 				Value result;
-				if (!get_field_of_udata(udata, rhs, result)) {
+				if (!get_field(lhs, rhs, result)) return ExitCode::RuntimeError;
+				PUSH(result);
+			}
+			break;
+		}
+
+		// struct.field
+		case Op::struct_get: {
+			const StructType* type = VYSE_AS_STRUCT_TYPE(READ_VALUE());
+			const u8 slot = NEXT_BYTE();
+			Value& object = m_stack.top[-1];
+			if (m_recorder != nullptr) record_field_site(object);
+			if (VYSE_IS_STRUCT(object) and VYSE_AS_STRUCT(object)->m_type == type) {
+				object = VYSE_AS_STRUCT(object)->fields()[slot];
+			} else {
+				// The value is not an instance of the struct the compiler expected, so the field is
+				// looked up by it's name.
+				const Value name = VYSE_OBJECT(type->m_fields[slot]);
+				const Value lhs = object;
+				if (VYSE_IS_TABLE(lhs)) {
+					object = VYSE_AS_TABLE(lhs)->get(name);
+				} else if (!get_field(lhs, name, object)) {
 					return ExitCode::RuntimeError;
 				}
-				PUSH(result);
+			}
+			break;
+		}
+
+		// struct.field = value
+		case Op::struct_set: {
+			const StructType* type = VYSE_AS_STRUCT_TYPE(READ_VALUE());
+			const u8 slot = NEXT_BYTE();
+			const Value value = POP();
+			Value& object = PEEK(1);
+			if (m_recorder != nullptr) record_field_site(object);
+			if (VYSE_IS_STRUCT(object) and VYSE_AS_STRUCT(object)->m_type == type) {
+				VYSE_AS_STRUCT(object)->fields()[slot] = value;
 			} else {
-				return INDEX_ERROR(lhs);
+				const Value name = VYSE_OBJECT(type->m_fields[slot]);
+				if (VYSE_IS_TABLE(object) and !VYSE_IS_FROZEN(object)) {
+					VYSE_AS_TABLE(object)->set(name, value);
+				} else if (!set_field(object, name, value)) {
+					return ExitCode::RuntimeError;
+				}
 			}
+
+			m_stack.top[-1] = value; // assignment returns it's RHS
 			break;
 		}
 
@@ -532,29 +739,84 @@ ExitCode VM::run() {
 			break;
 		}
 
-		// tbl <- POP()
-		// PUSH(tbl[READ_VALUE()])
-		// PUSH(tbl)
+		// receiver:method(args...)
 		/// TODO: take care of overloaded `__indx`
-		case Op::prep_method_call: {
-			const Value vtable = PEEK(1);
-			const Value vkey = READ_VALUE();
-			VYSE_ASSERT(VYSE_IS_STRING(vkey), "method name not a string.");
+		case Op::invoke_spread:
+		case Op::invoke: {
+			const Value name = READ_VALUE();
+			VYSE_ASSERT(VYSE_IS_STRING(name), "method name not a string.");
+			int argc = NEXT_BYTE();
+			if (op == Op::invoke_spread) argc += VYSE_AS_NUM(POP());
+			if (!invoke(name, argc)) return ExitCode::RuntimeError;
+			break;
+		}
 
-			if (VYSE_IS_NIL(vtable)) return INDEX_ERROR(vtable);
-			if (VYSE_IS_TABLE(vtable)) {
-				m_stack.top[-1] = VYSE_AS_TABLE(vtable)->get(vkey);
-			} else {
-				m_stack.top[-1] = index_proto(vtable, vkey);
+		case Op::invoke_intrinsic: {
+			const Value name = READ_VALUE();
+			const auto id = static_cast<Intrinsic>(NEXT_BYTE());
+			Value& receiver = PEEK(1);
+
+			// Only lists have intrinsic methods for now.
+			if (VYSE_IS_LIST(receiver)) {
+				const Value method = index_proto(receiver, name);
+				if (VYSE_IS_CCLOSURE(method) and VYSE_AS_CCLOSURE(method)->m_intrinsic == id and
+					run_list_intrinsic(id, *VYSE_AS_LIST(receiver), receiver)) {
+					break;
+				}
+			}
+
+			if (!invoke(name, 1)) return ExitCode::RuntimeError;
+			break;
+		}
+
+		case Op::inline_guard: {
+			const Value code = READ_VALUE();
+			const u8 argc = NEXT_BYTE();
+			const Value callee = PEEK(argc + 1);
+			if (VYSE_IS_CLOSURE(callee) and
+				VYSE_AS_CLOSURE(callee)->m_codeblock == VYSE_AS_PROTO(code)) {
+				// skip the jump over the inlined body.
+				ip += 3;
+			} else if (!op_call(callee, argc)) {
+				return ExitCode::RuntimeError;
 			}
-			PUSH(vtable);
+			break;
+		}
 
+		case Op::call_intrinsic: {
+			const auto id = static_cast<Intrinsic>(NEXT_BYTE());
+			const Value callee = PEEK(2);
+			const Value arg = PEEK(1);
+			if (VYSE_IS_CCLOSURE(callee) and VYSE_AS_CCLOSURE(callee)->m_intrinsic == id and
+				VYSE_IS_NUM(arg)) {
+				DISCARD();
+				PEEK(1) = VYSE_NUM(run_math_intrinsic(id, VYSE_AS_NUM(arg)));
+			} else {
+				// A site specialized by a profile stops being specialized when it's next recorded.
+				if (m_recorder != nullptr) record_site(Profile::Site::Kind::call, ip - 2, "");
+				if (!op_call(callee, 1)) return ExitCode::RuntimeError;
+			}
 			break;
 		}
 
 		case Op::call_func: {
 			const u8 argc = NEXT_BYTE();
 			const Value value = PEEK(argc + 1);
+			if (m_recorder != nullptr and argc == 1) {
+				const char* intrinsic = nullptr;
+				if (VYSE_IS_CCLOSURE(value)) {
+					intrinsic = Profile::math_intrinsic_name(VYSE_AS_CCLOSURE(value)->m_intrinsic);
+				}
+				if (intrinsic == nullptr) intrinsic = "";
+				record_site(Profile::Site::Kind::call, ip - 2, intrinsic);
+			}
+			if (!op_call(value, argc)) return ExitCode::RuntimeError;
+			break;
+		}
+
+		case Op::call_spread: {
+			const int argc = NEXT_BYTE() + int(VYSE_AS_NUM(POP()));
+			const Value value = PEEK(argc + 1);
 			if (!op_call(value, argc)) return ExitCode::RuntimeError;
 			break;
 		}
@@ -562,9 +824,10 @@ ExitCode VM::run() {
 		case Op::return_val: {
 			const Value result = POP();
 			close_upvalues_upto(m_current_frame->base);
-			m_stack.top = m_current_frame->base + 1;
 
-			DISCARD();
+			// Varargs that were left on the stack sit below the base, so the result is written to
+			// the slot that the callee was originally called from.
+			m_stack.top = m_current_frame->base - m_current_frame->shift;
 			PUSH(result);
 
 			// No more code to run, the script has executed successfully.
@@ -638,20 +901,50 @@ Value VM::concatenate(const String* left, const String* right) {
 	std::memcpy(buf + left->len(), right->c_str(), right->len());
 
 	const size_t hash = hash_cstring(buf, length);
-	String* const interned = interned_strings.find_string(buf, length, hash);
+	String* const interned = interned_strings.find(buf, length, hash);
 
 	if (interned == nullptr) {
 		String* const res = &create_new_string(buf, length, hash);
-		Value vresult = VYSE_OBJECT(res);
-		interned_strings.set(vresult, VYSE_BOOL(true));
-		return vresult;
+		interned_strings.insert(res);
+		return VYSE_OBJECT(res);
 	} else {
 		delete[] buf;
 		return VYSE_OBJECT(interned);
 	}
 }
 
+Value VM::adopt(std::shared_ptr<const FrozenRegion> region) {
+	VYSE_ASSERT(region != nullptr, "Attempt to adopt a null region.");
+	const Value root = region->root();
+	AdoptedRegion& adopted = m_frozen_regions[region.get()];
+	if (adopted.region == nullptr) adopted.region = std::move(region);
+	adopted.pinned = true;
+	return root;
+}
+
+Value VM::adopt_collectable(std::shared_ptr<const FrozenRegion> region) {
+	VYSE_ASSERT(region != nullptr, "Attempt to adopt a null region.");
+	const Value root = region->root();
+	const auto [it, inserted] = m_frozen_regions.try_emplace(region.get());
+	if (inserted) {
+		m_gc.bytes_allocated += region->size();
+		it->second.region = std::move(region);
+	}
+	return root;
+}
+
+std::shared_ptr<const FrozenRegion> VM::frozen_region(Value value) const {
+	if (!VYSE_IS_FROZEN(value)) return nullptr;
+	return FrozenRegion::of(*VYSE_AS_OBJECT(value));
+}
+
 Value VM::get_global(String* name) const {
+	// Globals are keyed by interned strings, but the names used by frozen code are frozen strings.
+	if (name->is_frozen()) {
+		name = interned_strings.find(name->c_str(), name->len(), name->hash());
+		if (name == nullptr) return VYSE_UNDEF;
+	}
+
 	const auto search = m_global_vars.find(name);
 	if (search == m_global_vars.end()) return VYSE_UNDEF;
 	return search->second;
@@ -663,6 +956,11 @@ Value VM::get_global(const char* name) {
 }
 
 void VM::set_global(String* name, Value value) {
+	if (name->is_frozen()) {
+		if (VYSE_IS_OBJECT(value)) m_stack.push(value);
+		name = &make_string(name->c_str(), name->len());
+		if (VYSE_IS_OBJECT(value)) m_stack.pop();
+	}
 	m_global_vars[name] = value;
 }
 
@@ -686,6 +984,8 @@ void VM::set_global(const char* name, Value value) {
 #undef BINOP_ERROR
 #undef IS_VAL_TRUTHY
 #undef CMP_OP
+#undef UNCHECKED_BINOP
+#undef UNCHECKED_CMP_OP
 #undef PEEK
 #undef PUSH
 #undef DISCARD
@@ -709,6 +1009,7 @@ bool VM::init() {
 	Closure* const script = compile_source();
 	if (script == nullptr) return false;
 	invoke_script(script);
+	prepare_script(*script->m_codeblock);
 
 #ifdef VYSE_DEBUG_DISASSEMBLY
 	disassemble_block(script->name()->c_str(), *m_current_block);
@@ -766,8 +1067,8 @@ void VM::invoke_script(Closure* script) {
 	m_current_block = &script->m_codeblock->block();
 }
 
-ExitCode VM::runcode(std::string code) {
-	m_sources.push_back({"<script>", std::move(code)});
+ExitCode VM::runcode(std::string code, std::string path) {
+	m_sources.push_back({std::move(path), std::move(code)});
 	return interpret();
 }
 
@@ -797,6 +1098,8 @@ void VM::load_stdlib() {
 	add_stdlib_object("print", &make<CClosure>(stdlib::print));
 	add_stdlib_object("setproto", &make<CClosure>(stdlib::setproto));
 	add_stdlib_object("getproto", &make<CClosure>(stdlib::getproto));
+	add_stdlib_object("freeze", &make<CClosure>(stdlib::freeze));
+	add_stdlib_object("is_frozen", &make<CClosure>(stdlib::is_frozen));
 	add_stdlib_object("assert", &make<CClosure>(stdlib::assert_));
 	add_stdlib_object("input", &make<CClosure>(stdlib::input));
 	add_stdlib_object("import", &make<CClosure>(stdlib::import));
@@ -835,9 +1138,11 @@ Upvalue* VM::capture_upvalue(Value* slot) {
 	Upvalue* current = m_open_upvals;
 	Upvalue* prev = nullptr;
 
-	// keep going until we reach a slot whose depth is lower than what we've been looking for, or
-	// until we reach the end of the list.
-	while (current != nullptr and current->m_value < slot) {
+	// The list is sorted from the highest stack slot to the lowest, which lets
+	// `close_upvalues_upto` stop at the first upvalue below the slots being closed. Keep going
+	// until we reach a slot that is not above the one we've been looking for, or until we reach
+	// the end of the list.
+	while (current != nullptr and current->m_value > slot) {
 		prev = current;
 		current = current->next_upval;
 	}
@@ -877,16 +1182,48 @@ bool VM::call(int argc) {
 				"Invalid stack state or incorrect arg count.");
 
 	const Value& value = m_stack.peek(argc + 1);
+	const u32 frame_count = m_frame_count;
 	const bool ok = op_call(value, argc);
 
-	// If the called object was a CClosure then execution has already finished and no need to call
-	// run() from here.
-	if (VYSE_IS_CCLOSURE(value)) return ok;
+	// If the called object was a CClosure or a compiled function, or the call failed, then no new
+	// call frame was pushed and there is no need to call run() from here.
+	if (!ok or m_frame_count == frame_count) return ok;
 	const ExitCode ec = run();
 	return ec == ExitCode::Success;
 }
 
-bool VM::op_call(Value value, u8 argc) {
+bool VM::invoke(const Value& name, int argc) {
+	Value* const receiver = m_stack.top - argc;
+
+	Value method;
+	if (VYSE_IS_TABLE(*receiver)) {
+		method = VYSE_AS_TABLE(*receiver)->get(name);
+	} else if (VYSE_IS_UDATA(*receiver)) {
+		get_field_of_udata(*VYSE_AS_UDATA(*receiver), name, method);
+	} else if (VYSE_IS_STRUCT(*receiver)) {
+		if (!get_field_of_struct(*VYSE_AS_STRUCT(*receiver), name, method)) return false;
+	} else if (VYSE_IS_NIL(*receiver)) {
+		INDEX_ERROR(*receiver);
+		return false;
+	} else {
+		method = index_proto(*receiver, name);
+	}
+
+	// Move the receiver and arguments up by one slot so that the method sits right below
+	// them, where a callee is expected. The compiler has already reserved this slot.
+	for (Value* slot = m_stack.top; slot > receiver; --slot) *slot = slot[-1];
+	*receiver = method;
+	++m_stack.top;
+
+	if (VYSE_IS_CLOSURE(method) and m_frame_count < MaxCallStack) {
+		return call_closure(VYSE_AS_CLOSURE(method), argc);
+	} else if (VYSE_IS_CCLOSURE(method) and m_frame_count < MaxCallStack) {
+		return call_cclosure(VYSE_AS_CCLOSURE(method), argc);
+	}
+	return op_call(method, argc);
+}
+
+bool VM::op_call(Value value, int argc) {
 	if (VYSE_IS_NIL(value)) {
 		ERROR("Attempt to call a nil value.");
 		return false;
@@ -901,6 +1238,7 @@ bool VM::op_call(Value value, u8 argc) {
 		switch (VYSE_AS_OBJECT(value)->tag) {
 		case OT::closure: return call_closure(VYSE_AS_CLOSURE(value), argc);
 		case OT::c_closure: return call_cclosure(VYSE_AS_CCLOSURE(value), argc);
+		case OT::struct_type: return construct_struct(*VYSE_AS_STRUCT_TYPE(value), argc);
 		default: break; // fall
 		}
 	}
@@ -911,6 +1249,24 @@ bool VM::op_call(Value value, u8 argc) {
 	return ok;
 }
 
+bool VM::construct_struct(StructType& type, int argc) {
+	if (u32(argc) > type.num_fields()) {
+		ERROR("Struct '{}' has {} fields, but was constructed with {} values.", type.name_cstr(),
+			  type.num_fields(), argc);
+		return false;
+	}
+
+	// The arguments are still on the stack, so they are safe from the GC.
+	Struct& instance = make_struct(type);
+	Value* const fields = instance.fields();
+	const Value* const args = m_stack.top - argc;
+	for (int i = 0; i < argc; ++i) fields[i] = args[i];
+
+	POPN(argc);
+	m_stack.top[-1] = VYSE_OBJECT(&instance);
+	return true;
+}
+
 void VM::push_callframe(Obj* callee, int argc) {
 	VYSE_ASSERT(callee->tag == OT::c_closure or callee->tag == OT::closure,
 				"Non callable callframe pushed.");
@@ -934,6 +1290,8 @@ void VM::push_callframe(Obj* callee, int argc) {
 
 	m_current_frame->func = callee;
 	m_current_frame->base = m_stack.top - argc - 1;
+	m_current_frame->num_varargs = 0;
+	m_current_frame->shift = 0;
 
 	// Start new function from the first opcode
 	m_current_frame->ip = ip = 0;
@@ -964,11 +1322,99 @@ void VM::pop_callframe() noexcept {
 	}
 }
 
+bool VM::compile_lazy(CodeBlock& code) {
+	// A function may be called from a native function while a script is being compiled.
+	Compiler* const enclosing = m_compiler;
+	Compiler compiler{this, code};
+	const bool ok = compiler.compile_lazy();
+	m_compiler = enclosing;
+
+	if (!ok) {
+		// The compiler has already reported the error.
+		m_has_error = true;
+		return false;
+	}
+
+#ifdef VYSE_DEBUG_DISASSEMBLY
+	disassemble_block(code.name_cstr(), code.block());
+#endif
+
+	return true;
+}
+
+void VM::prepare_script(CodeBlock& script) {
+	const SourceCode& source = m_sources.back();
+	if (record_profile and m_recorder == nullptr) m_recorder = std::make_unique<ProfileRecorder>();
+	if (m_recorder != nullptr) {
+		// The recorder keeps pointers to the script's functions until the VM is destroyed.
+		gc_protect(&script);
+		m_recorder->add_script(script, source);
+	}
+
+	if (profile == nullptr) return;
+	const Profile::Script* const feedback = profile->find(source.code);
+	if (feedback != nullptr) Profile::apply(*this, script, *feedback, m_recorder.get());
+}
+
+void VM::save_profile(Profile& profile) const {
+	if (m_recorder != nullptr) m_recorder->save(profile);
+}
+
+Profile::Function& VM::recorded_function() {
+	VYSE_ASSERT(m_recorder != nullptr, "Feedback isn't being recorded.");
+	const Closure* const closure = static_cast<const Closure*>(m_current_frame->func);
+	return m_recorder->function(*closure->m_codeblock);
+}
+
+void VM::record_site(Profile::Site::Kind kind, size_t offset, const char* target) {
+	recorded_function().add_site(u32(offset), kind, target);
+}
+
+void VM::record_field_site(Value object) {
+	const char* const type_name =
+		VYSE_IS_STRUCT(object) ? VYSE_AS_STRUCT(object)->m_type->name_cstr() : "";
+	// The struct instruction and it's two operands have been read.
+	record_site(Profile::Site::Kind::field, ip - 3, type_name);
+}
+
 bool VM::call_closure(Closure* func, int num_args) {
-	const int num_params = func->m_codeblock->param_count();
+	if (func->m_codeblock->is_lazy() and !compile_lazy(*func->m_codeblock)) return false;
+	if (m_recorder != nullptr) ++m_recorder->function(*func->m_codeblock).calls;
+
+	const CodeBlock* const code = func->m_codeblock;
+	const int num_params = code->param_count();
 
-	// make sure there is enough room in the stack for this function call.
-	ensure_slots(func->m_codeblock->stack_size());
+	// make sure there is enough room in the stack for this function call. A variadic call may
+	// also copy the callee and it's parameters above the varargs.
+	ensure_slots(code->stack_size() + (code->is_vararg() ? num_params + 1 : 0));
+
+	if (code->is_vararg()) {
+		// Missing fixed parameters are padded with 'nil', and the rest of the arguments are varargs.
+		const int num_fixed = num_params - 1;
+		while (num_args < num_fixed) {
+			m_stack.push(VYSE_NIL);
+			num_args++;
+		}
+
+		const u32 num_varargs = num_args - num_fixed;
+		if (code->collects_varargs()) {
+			prep_vararg_call(num_params, num_args);
+			push_callframe(func, num_params);
+			return true;
+		}
+
+		u32 shift = 0;
+		if (num_varargs == 0) {
+			m_stack.push(VYSE_NIL);
+		} else {
+			shift = shift_vararg_call(num_params, num_varargs);
+		}
+
+		push_callframe(func, num_params);
+		m_current_frame->num_varargs = num_varargs;
+		m_current_frame->shift = shift;
+		return true;
+	}
 
 	// extra arguments are ignored and missing arguments are padded with 'nil'.
 	if (num_args < num_params) {
@@ -977,8 +1423,6 @@ bool VM::call_closure(Closure* func, int num_args) {
 			m_stack.push(VYSE_NIL);
 			num_args++;
 		}
-	} else if (func->m_codeblock->is_vararg()) {
-		num_args = prep_vararg_call(num_params, num_args);
 	} else {
 		while (num_args != num_params) {
 			m_stack.pop();
@@ -986,13 +1430,37 @@ bool VM::call_closure(Closure* func, int num_args) {
 		}
 	}
 
-	assert(num_args == num_params);
+	// A function translated to C++ runs in place, unless it hands the call back to the interpreter.
+	if (code->m_compiled != nullptr) {
+		Value result;
+		const u32 depth = MaxCallStack - m_frame_count - 1;
+		if (code->m_compiled(m_stack.top - num_args - 1, depth, result)) {
+			m_stack.popn(num_args);
+			m_stack.top[-1] = result;
+			return true;
+		}
+	}
+
 	push_callframe(func, num_args);
 	return true;
 }
 
+u32 VM::shift_vararg_call(int num_params, u32 num_varargs) {
+	// [callee, fixed args..., varargs...] -> [..., varargs..., callee, fixed args..., nil]
+	const Value* const callee = m_stack.top - num_varargs - num_params;
+	for (int i = 0; i < num_params; ++i) m_stack.push(callee[i]);
+	m_stack.push(VYSE_NIL);
+	return num_varargs + num_params;
+}
+
+bool VM::varargs_on_stack(const Value& rest) const noexcept {
+	if (!VYSE_IS_NIL(rest)) return false;
+	const Closure* const closure = static_cast<const Closure*>(m_current_frame->func);
+	return !closure->m_codeblock->collects_varargs();
+}
+
 int VM::prep_vararg_call(int num_params, int num_args) {
-	VYSE_ASSERT(num_args >= num_params, "bad call to VM::prep_vararg_call");
+	VYSE_ASSERT(num_args >= num_params - 1, "bad call to VM::prep_vararg_call");
 	List& vararg_list = make<List>();
 	int num_varargs = num_args - num_params + 1;
 	for (Value* arg = m_stack.top - num_varargs; arg < m_stack.top; ++arg) {
@@ -1100,6 +1568,13 @@ bool VM::get_field_of_value(Value const& value, Value const& key, Value& inout)
 		return true;
 	}
 
+	if (VYSE_IS_STRUCT(value)) {
+		const Struct& instance = *VYSE_AS_STRUCT(value);
+		const int slot = instance.m_type->field_index(key);
+		inout = slot == -1 ? VYSE_NIL : instance.fields()[slot];
+		return true;
+	}
+
 	Table* const proto = get_proto(value);
 	if (proto == nullptr) {
 		assert(VYSE_IS_NIL(value));
@@ -1146,6 +1621,46 @@ bool VM::set_field_of_udata(const UserData& udata, const Value& key, Value value
 	return true;
 }
 
+bool VM::get_field(const Value& value, const Value& key, Value& result) {
+	if (VYSE_IS_STRUCT(value)) return get_field_of_struct(*VYSE_AS_STRUCT(value), key, result);
+	if (VYSE_IS_UDATA(value)) return get_field_of_udata(*VYSE_AS_UDATA(value), key, result);
+	INDEX_ERROR(value);
+	return false;
+}
+
+bool VM::set_field(const Value& value, const Value& key, const Value& field_value) {
+	if (VYSE_IS_STRUCT(value)) return set_field_of_struct(*VYSE_AS_STRUCT(value), key, field_value);
+	if (VYSE_IS_UDATA(value)) return set_field_of_udata(*VYSE_AS_UDATA(value), key, field_value);
+	if (VYSE_IS_FROZEN(value)) {
+		FROZEN_ERROR(value);
+		return false;
+	}
+	INDEX_ERROR(value);
+	return false;
+}
+
+bool VM::get_field_of_struct(const Struct& instance, const Value& key, Value& result) {
+	const int slot = instance.m_type->field_index(key);
+	if (slot == -1) {
+		ERROR("No field '{}' in struct '{}'.", value_to_string(key), instance.m_type->name_cstr());
+		return false;
+	}
+
+	result = instance.fields()[slot];
+	return true;
+}
+
+bool VM::set_field_of_struct(Struct& instance, const Value& key, const Value& value) {
+	const int slot = instance.m_type->field_index(key);
+	if (slot == -1) {
+		ERROR("No field '{}' in struct '{}'.", value_to_string(key), instance.m_type->name_cstr());
+		return false;
+	}
+
+	instance.fields()[slot] = value;
+	return true;
+}
+
 bool VM::get_subscript_of_value(const Value& value, const Value& index, Value& result) {
 	if (VYSE_IS_NIL(value)) {
 		ERROR("Attempt to index a nil value.");
@@ -1201,6 +1716,8 @@ bool VM::get_subscript_of_value(const Value& value, const Value& index, Value& r
 			return get_field_of_udata(udata, index, result);
 		}
 
+		case OT::struct_: return get_field_of_struct(*static_cast<Struct*>(object), index, result);
+
 		default:; // fallthrough to default
 		}
 	}
@@ -1217,6 +1734,11 @@ bool VM::get_subscript_of_value(const Value& value, const Value& index, Value& r
 }
 
 bool VM::subscript_set(const Value& lhs, const Value& key, const Value& rhs) {
+	if (VYSE_IS_FROZEN(lhs)) {
+		FROZEN_ERROR(lhs);
+		return false;
+	}
+
 	if (VYSE_IS_LIST(lhs)) {
 		List& list = *VYSE_AS_LIST(lhs);
 		return list_index_set(list, key, rhs);
@@ -1235,6 +1757,10 @@ bool VM::subscript_set(const Value& lhs, const Value& key, const Value& rhs) {
 		return set_field_of_udata(*VYSE_AS_UDATA(lhs), key, rhs);
 	}
 
+	if (VYSE_IS_STRUCT(lhs)) {
+		return set_field_of_struct(*VYSE_AS_STRUCT(lhs), key, rhs);
+	}
+
 	ERROR("Attempt to index a {} value.", value_type_name(lhs));
 	return false;
 }
@@ -1268,7 +1794,7 @@ String& VM::take_string(char* buf, size_t len) {
 	const size_t hash = hash_cstring(buf, len);
 
 	// Look for an existing interened copy of the string.
-	String* interned = interned_strings.find_string(buf, len, hash);
+	String* interned = interned_strings.find(buf, len, hash);
 	if (interned != nullptr) {
 		// We now 'own' the string, so we are free to get rid of this buffer if we don't need it.
 		delete[] buf;
@@ -1276,7 +1802,7 @@ String& VM::take_string(char* buf, size_t len) {
 	}
 
 	String& string = create_new_string(buf, len, hash);
-	interned_strings.set(VYSE_OBJECT(&string), VYSE_BOOL(true));
+	interned_strings.insert(&string);
 	return string;
 }
 
@@ -1285,11 +1811,11 @@ String& VM::make_string(const char* chars, size_t length) {
 
 	// If an identical string has already been created, then return a reference to the existing
 	// string instead.
-	String* const interned = interned_strings.find_string(chars, length, hash);
+	String* const interned = interned_strings.find(chars, length, hash);
 	if (interned != nullptr) return *interned;
 
 	String* const string = &create_new_string(chars, length, hash);
-	interned_strings.set(VYSE_OBJECT(string), VYSE_BOOL(true));
+	interned_strings.insert(string);
 
 	return *string;
 }
@@ -1392,10 +1918,9 @@ ExitCode VM::runtime_error(const std::string& message) {
 		const Closure& func = *static_cast<Closure*>(frame->func);
 
 		const Block& block = func.m_codeblock->block();
-		VYSE_ASSERT(frame->ip < block.lines.size(),
-					"IP not in range for std::vector<u32> block.lines.");
+		VYSE_ASSERT(frame->ip < block.op_count(), "IP not in range for block.");
 
-		const u32 line = block.lines[frame->ip];
+		const u32 line = block.line_at(frame->ip);
 		if (frame == base_frame) {
 			error_str += kt::format_str("\t[line {}] in {}", line, func.name_cstr());
 		} else {
@@ -1411,7 +1936,7 @@ ExitCode VM::runtime_error(const std::string& message) {
 		const size_t diff = trace_depth - MaxStackTraceDepth;
 		error_str += "\t.\n\t.\n\t.\n\t" + std::to_string(diff) + " not shown.\n";
 		Closure* const scriptfn = static_cast<Closure*>(base_frame->func);
-		const int line = scriptfn->m_codeblock->block().lines[base_frame->ip];
+		const int line = scriptfn->m_codeblock->block().line_at(base_frame->ip);
 		error_str += kt::format_str("\t[line {}] in function {}.\n", line, scriptfn->name_cstr());
 	}
 
@@ -1450,8 +1975,8 @@ char* default_readline(const VM&) {
 VM::~VM() {
 	if (m_gc.m_objects == nullptr) return;
 	for (Obj* object = m_gc.m_objects; object != nullptr;) {
-		Obj* const next = object->next;
-		delete object;
+		Obj* const next = object->next();
+		Obj::destroy(object);
 		object = next;
 	}
 
@@ -1,4 +1,5 @@
 #include "../str_format.hpp"
+#include <frozen.hpp>
 #include <libloader.hpp>
 #include <list.hpp>
 #include <stdlib/base.hpp>
@@ -55,6 +56,7 @@ Value stdlib::setproto(VM& vm, int argc) {
 
 	Table* table = VYSE_AS_TABLE(vtable);
 	const Table* prototype = VYSE_AS_TABLE(vproto);
+	args.check(!table->is_frozen(), "Attempt to modify a frozen table.");
 
 	// Check for cyclic prototypes.
 	while (prototype != nullptr) {
@@ -77,6 +79,25 @@ vy::Value vy::stdlib::getproto(VM& vm, int argc) {
 	return VYSE_OBJECT(table.m_proto_table);
 }
 
+Value stdlib::freeze(VM& vm, int argc) {
+	Args args(vm, "freeze", 1, argc);
+	const Value value = args.next_arg();
+	// Primitives can't be modified anyway, and everything a frozen object refers to is frozen too.
+	if (!VYSE_IS_OBJECT(value) or VYSE_IS_FROZEN(value)) return value;
+
+	Value bad_value;
+	std::shared_ptr<const FrozenRegion> region = FrozenRegion::freeze(value, bad_value);
+	args.check(region != nullptr,
+			   kt::format_str("Cannot freeze a {} value.", value_type_name(bad_value)).c_str());
+	return vm.adopt_collectable(std::move(region));
+}
+
+Value stdlib::is_frozen(VM& vm, int argc) {
+	Args args(vm, "is_frozen", 1, argc);
+	const Value value = args.next_arg();
+	return VYSE_BOOL(VYSE_IS_FROZEN(value));
+}
+
 Value stdlib::assert_(VM& vm, int argc) {
 	static constexpr const char* fname = "assert";
 
@@ -1,9 +1,11 @@
 #include "../str_format.hpp"
+#include <algorithm>
 #include <list.hpp>
 #include <stdlib/vy_list.hpp>
 #include <util/args.hpp>
 #include <util/lib_util.hpp>
 #include <value.hpp>
+#include <vector>
 #include <vm.hpp>
 
 #define CHECK_ARG_TYPE(n, type)                                                                    \
@@ -49,6 +51,10 @@ Value fill(VM& vm, int argc) {
 	if (!check_arg_type(vm, 0, ObjType::list, fname)) return VYSE_NIL;
 	List& list = *VYSE_AS_LIST(vm.get_arg(0));
 	Value value = vm.get_arg(1);
+	if (list.is_frozen()) {
+		cfn_error(vm, fname, "Attempt to modify a frozen list.");
+		return VYSE_NIL;
+	}
 
 	size_t list_len = list.length();
 	for (uint i = 0; i < list_len; ++i) {
@@ -182,11 +188,79 @@ Value filter(VM& vm, int argc) {
 
 Value pop(VM& vm, int argc) {
 	Args args(vm, "List.pop", 1, argc);
-	List& list = args.next<List>();
+	List& list = args.next_mutable<List>();
 	args.check(list.length() > 0, "Attempt to pop from an empty list");
 	return list.pop();
 }
 
+/// @brief Checks that all [len] values can be ordered against each other natively, i.e they are
+/// either all numbers or all strings. Throws an error attributed to [args] otherwise.
+static void check_sortable(Args& args, const Value* values, size_t len) {
+	for (size_t i = 1; i < len; ++i) {
+		int order;
+		if (!compare_values(values[0], values[i], order)) {
+			args.check(false, kt::format_str("Cannot compare {} with {} (at index {}).",
+											 value_type_name(values[0]),
+											 value_type_name(values[i]), i));
+		}
+	}
+}
+
+static bool value_less(const Value& a, const Value& b) {
+	int order;
+	compare_values(a, b, order);
+	return order < 0;
+}
+
+/// @brief list:sort([key]) sorts the list in place, in ascending order. The sort is stable.
+/// The elements (or the keys returned by `key(element)`) must all be numbers or all be strings.
+/// The key function is called exactly once per element.
+Value sort(VM& vm, int argc) {
+	Args args(vm, "List.sort", 1, argc);
+	List& list = args.next_mutable<List>();
+	const size_t len = list.length();
+	Value* const values = len == 0 ? nullptr : &list[0];
+
+	if (!args.has_next()) {
+		check_sortable(args, values, len);
+		std::stable_sort(values, values + len, value_less);
+		return VYSE_OBJECT(&list);
+	}
+
+	const Value key_fn = args.next_arg();
+	args.check(VYSE_IS_CLOSURE(key_fn) or VYSE_IS_CCLOSURE(key_fn),
+			   kt::format_str("Bad arg #2. Expected function, got {}.", value_type_name(key_fn)));
+
+	List& keys = vm.make<List>();
+	GCLock lock = vm.gc_lock(&keys);
+
+	vm.ensure_slots(2);
+	for (size_t i = 0; i < len; ++i) {
+		// A key function that shrinks the list would make the next element read out of bounds.
+		args.check(list.length() == len, "List was modified by the key function.");
+		vm.m_stack.push(key_fn);
+		vm.m_stack.push(list[i]);
+		if (!vm.call(1)) return VYSE_NIL;
+		keys.append(vm.m_stack.pop());
+	}
+
+	args.check(list.length() == len, "List was modified by the key function.");
+	const Value* const key_values = keys.data();
+	check_sortable(args, key_values, len);
+
+	std::vector<size_t> order(len);
+	for (size_t i = 0; i < len; ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [key_values](size_t a, size_t b) {
+		return value_less(key_values[a], key_values[b]);
+	});
+
+	// `keys` is no longer needed, so reuse it to hold the elements in sorted order.
+	for (size_t i = 0; i < len; ++i) keys[i] = list[order[i]];
+	for (size_t i = 0; i < len; ++i) list[i] = keys[i];
+
+	return VYSE_OBJECT(&list);
+}
+
 void load_list_proto(VM& vm) {
 	Table& list_proto = *vm.prototypes.list;
 	add_libfn(vm, list_proto, "foreach", foreach);
@@ -196,7 +270,8 @@ void load_list_proto(VM& vm) {
 	add_libfn(vm, list_proto, "map", map);
 	add_libfn(vm, list_proto, "reduce", reduce);
 	add_libfn(vm, list_proto, "filter", filter);
-	add_libfn(vm, list_proto, "pop", pop);
+	add_libfn(vm, list_proto, "pop", pop).m_intrinsic = Intrinsic::list_pop;
+	add_libfn(vm, list_proto, "sort", sort);
 }
 
 } // namespace vy::stdlib::primitives
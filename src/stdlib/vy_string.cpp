@@ -2,6 +2,7 @@
 #include <cctype>
 #include <cmath>
 #include <cstdlib>
+#include <format.hpp>
 #include <stdlib/vy_string.hpp>
 #include <util/args.hpp>
 #include <util/lib_util.hpp>
@@ -270,6 +271,42 @@ static Value slice(VM& vm, int argc) {
 	return VYSE_OBJECT(&vm.take_string(buf, end - start + 1));
 }
 
+/// @brief String.fmt(format, ...) renders its arguments into the format string. The format
+/// string is compiled once and cached, so formatting in a loop only pays for the rendering.
+static Value fmt(VM& vm, int argc) {
+	Args args(vm, "String.fmt", 1, argc);
+	const String& format = args.next<String>();
+
+	auto cached = vm.format_cache.find(&format);
+	if (cached == vm.format_cache.end()) {
+		FormatTemplate compiled;
+		const std::string error =
+			compile_format(std::string_view(format.c_str(), format.len()), compiled);
+		args.check(error.empty(), FMT("Bad format string: {}.", error));
+		cached = vm.format_cache.emplace(&format, std::move(compiled)).first;
+	}
+
+	const FormatTemplate& tmpl = cached->second;
+	const u32 num_args = argc - 1;
+	args.check(num_args >= tmpl.num_args,
+			   FMT("Format string expects {} argument(s), got {}.", tmpl.num_args, num_args));
+
+	std::string result;
+	result.reserve(tmpl.literal_length + num_args * 8);
+
+	for (const FormatPiece& piece : tmpl.pieces) {
+		if (piece.arg_index < 0) {
+			result.append(format.c_str() + piece.offset, piece.length);
+			continue;
+		}
+
+		const std::string error = format_value(result, vm.get_arg(piece.arg_index + 1), piece.spec);
+		args.check(error.empty(), FMT("Bad argument #{}: {}.", piece.arg_index + 2, error));
+	}
+
+	return VYSE_OBJECT(&vm.make_string(result.c_str(), result.size()));
+}
+
 void load_string_proto(VM& vm) {
 	Table& str_proto = *vm.prototypes.string;
 	add_libfn(vm, str_proto, "substr", substr);
@@ -284,6 +321,7 @@ void load_string_proto(VM& vm) {
 	add_libfn(vm, str_proto, "isalpha", isalpha);
 	add_libfn(vm, str_proto, "isalnum", isalnum);
 	add_libfn(vm, str_proto, "slice", slice);
+	add_libfn(vm, str_proto, "fmt", fmt);
 }
 
 } // namespace vy::stdlib::primitives
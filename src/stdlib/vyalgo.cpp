@@ -0,0 +1,260 @@
+#include "../str_format.hpp"
+#include <list.hpp>
+#include <stdlib/native_modules.hpp>
+#include <util/auxlib.hpp>
+#include <util/lib_util.hpp>
+#include <vm.hpp>
+
+using namespace vy;
+using namespace vy::util;
+
+/// @file The 'heapq' and 'bisect' modules. Both operate on plain lists, comparing numbers and
+/// strings natively. An optional key function maps list elements to the values that are compared.
+
+namespace vy::stdlib::algo {
+
+/// @brief Orders list elements, optionally through a key function.
+class Ordering {
+  public:
+	Ordering(VM& vm, Args& args, Value key) : m_vm(vm), m_args(args), m_key(key) {
+		m_args.check(VYSE_IS_NIL(key) or VYSE_IS_CLOSURE(key) or VYSE_IS_CCLOSURE(key),
+					 kt::format_str("Expected key to be a function, got {}.", value_type_name(key)));
+	}
+
+	/// @brief Sets [out] to true if key(a) < key(b).
+	/// @return false if the key function raised an error.
+	bool less(Value a, Value b, bool& out) {
+		if (VYSE_IS_NIL(m_key)) {
+			out = compare(a, b) < 0;
+			return true;
+		}
+
+		// keys are left on the stack while the next one is computed, so that
+		// the garbage collector can see them.
+		if (!push_key(a) or !push_key(b)) return false;
+		out = compare(m_vm.m_stack.peek(2), m_vm.m_stack.peek(1)) < 0;
+		m_vm.m_stack.popn(2);
+		return true;
+	}
+
+	/// @brief Three way comparison of key(element) with [value]. The key function is only
+	/// applied to [element].
+	/// @return false if the key function raised an error.
+	bool compare_key(Value element, Value value, int& out) {
+		if (VYSE_IS_NIL(m_key)) {
+			out = compare(element, value);
+			return true;
+		}
+
+		if (!push_key(element)) return false;
+		out = compare(m_vm.m_stack.pop(), value);
+		return true;
+	}
+
+	/// @brief Makes sure a key function hasn't changed the length of [list] from [len].
+	void check_length(const List& list, size_t len) {
+		m_args.check(list.length() == len, "List was modified by the key function.");
+	}
+
+  private:
+	VM& m_vm;
+	Args& m_args;
+	const Value m_key;
+
+	bool push_key(Value value) {
+		m_vm.ensure_slots(2);
+		m_vm.m_stack.push(m_key);
+		m_vm.m_stack.push(value);
+		return m_vm.call(1);
+	}
+
+	int compare(Value a, Value b) {
+		int order;
+		if (!compare_values(a, b, order)) {
+			m_args.check(false, kt::format_str("Cannot compare {} with {}.", value_type_name(a),
+											   value_type_name(b)));
+		}
+		return order;
+	}
+};
+
+/// @brief Moves the item at [pos] up the min-heap until it's parent is not larger than it.
+static bool sift_up(List& heap, size_t pos, Ordering& ordering) {
+	const size_t len = heap.length();
+	while (pos > 0) {
+		const size_t parent = (pos - 1) / 2;
+		bool is_less;
+		if (!ordering.less(heap[pos], heap[parent], is_less)) return false;
+		ordering.check_length(heap, len);
+		if (!is_less) break;
+		std::swap(heap[pos], heap[parent]);
+		pos = parent;
+	}
+	return true;
+}
+
+/// @brief Moves the item at [pos] down the min-heap until neither of it's children are smaller.
+static bool sift_down(List& heap, size_t pos, Ordering& ordering) {
+	const size_t len = heap.length();
+	while (true) {
+		const size_t left = 2 * pos + 1;
+		if (left >= len) break;
+
+		size_t smallest = left;
+		const size_t right = left + 1;
+		bool is_less;
+		if (right < len) {
+			if (!ordering.less(heap[right], heap[left], is_less)) return false;
+			ordering.check_length(heap, len);
+			if (is_less) smallest = right;
+		}
+
+		if (!ordering.less(heap[smallest], heap[pos], is_less)) return false;
+		ordering.check_length(heap, len);
+		if (!is_less) break;
+		std::swap(heap[pos], heap[smallest]);
+		pos = smallest;
+	}
+	return true;
+}
+
+/// @brief The optional last argument of a function that accepts a key.
+static Value next_key(Args& args) {
+	return args.has_next() ? args.next_arg() : VYSE_NIL;
+}
+
+/// @brief heapq.push(heap, value, [key]) pushes [value] onto the min-heap [heap].
+Value push(VM& vm, int argc) {
+	Args args(vm, "heapq.push", 2, argc);
+	List& heap = args.next_mutable<List>();
+	const Value value = args.next_arg();
+	Ordering ordering(vm, args, next_key(args));
+
+	heap.append(value);
+	sift_up(heap, heap.length() - 1, ordering);
+	return VYSE_NIL;
+}
+
+/// @brief heapq.pop(heap, [key]) removes and returns the smallest item of the min-heap [heap].
+Value pop(VM& vm, int argc) {
+	Args args(vm, "heapq.pop", 1, argc);
+	List& heap = args.next_mutable<List>();
+	Ordering ordering(vm, args, next_key(args));
+	args.check(heap.length() > 0, "Attempt to pop from an empty heap.");
+
+	const size_t last = heap.length() - 1;
+	std::swap(heap[0], heap[last]);
+	const Value smallest = heap.pop();
+
+	// The popped value is no longer in the list, so it must stay visible to the
+	// GC while the key function runs.
+	vm.ensure_slots(1);
+	vm.m_stack.push(smallest);
+	const bool ok = sift_down(heap, 0, ordering);
+	vm.m_stack.pop();
+
+	return ok ? smallest : VYSE_NIL;
+}
+
+/// @brief heapq.peek(heap) returns the smallest item of the heap without removing it, or nil if
+/// the heap is empty.
+Value peek(VM& vm, int argc) {
+	Args args(vm, "heapq.peek", 1, argc);
+	const List& heap = args.next<List>();
+	return heap.length() > 0 ? heap[0] : VYSE_NIL;
+}
+
+/// @brief heapq.heapify(list, [key]) rearranges [list] into a min-heap in linear time.
+Value heapify(VM& vm, int argc) {
+	Args args(vm, "heapq.heapify", 1, argc);
+	List& heap = args.next_mutable<List>();
+	Ordering ordering(vm, args, next_key(args));
+
+	for (size_t i = heap.length() / 2; i-- > 0;) {
+		if (!sift_down(heap, i, ordering)) break;
+	}
+
+	return VYSE_OBJECT(&heap);
+}
+
+/// @brief Binary search over the sorted list [list] for the first index whose element is not
+/// less than [value] (when [upper] is false), or greater than [value] (when [upper] is true).
+/// @return false if the key function raised an error.
+static bool bisect(const List& list, Value value, bool upper, Ordering& ordering, size_t& out) {
+	const size_t len = list.length();
+	size_t lo = 0, hi = len;
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		int order;
+		if (!ordering.compare_key(list[mid], value, order)) return false;
+		ordering.check_length(list, len);
+		if (order < 0 or (upper and order == 0)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	out = lo;
+	return true;
+}
+
+/// @brief bisect.lower(list, value, [key]) returns the first index in the sorted list [list] at
+/// which [value] can be inserted while keeping the list sorted, i.e before any equal elements.
+Value lower(VM& vm, int argc) {
+	Args args(vm, "bisect.lower", 2, argc);
+	const List& list = args.next<List>();
+	const Value value = args.next_arg();
+	Ordering ordering(vm, args, next_key(args));
+
+	size_t index;
+	if (!bisect(list, value, false, ordering, index)) return VYSE_NIL;
+	return VYSE_NUM(index);
+}
+
+/// @brief bisect.upper(list, value, [key]) returns the last index in the sorted list [list] at
+/// which [value] can be inserted while keeping the list sorted, i.e after any equal elements.
+Value upper(VM& vm, int argc) {
+	Args args(vm, "bisect.upper", 2, argc);
+	const List& list = args.next<List>();
+	const Value value = args.next_arg();
+	Ordering ordering(vm, args, next_key(args));
+
+	size_t index;
+	if (!bisect(list, value, true, ordering, index)) return VYSE_NIL;
+	return VYSE_NUM(index);
+}
+
+/// @brief bisect.insort(list, value, [key]) inserts [value] into the sorted list [list] after any
+/// equal elements, and returns the index at which it was inserted.
+Value insort(VM& vm, int argc) {
+	Args args(vm, "bisect.insort", 2, argc);
+	List& list = args.next_mutable<List>();
+	const Value value = args.next_arg();
+	Ordering ordering(vm, args, next_key(args));
+
+	size_t index;
+	if (!bisect(list, value, true, ordering, index)) return VYSE_NIL;
+	list.insert(index, value);
+	return VYSE_NUM(index);
+}
+
+static constexpr std::pair<const char*, NativeFn> heapq_funcs[] = {
+	{"push", push}, {"pop", pop}, {"peek", peek}, {"heapify", heapify}};
+
+static constexpr std::pair<const char*, NativeFn> bisect_funcs[] = {
+	{"lower", lower}, {"upper", upper}, {"insort", insort}};
+
+VYSE_API void load_heapq(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule heapq(vm, module);
+	heapq.add_cclosures(heapq_funcs, array_size(heapq_funcs));
+}
+
+VYSE_API void load_bisect(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule bisect(vm, module);
+	bisect.add_cclosures(bisect_funcs, array_size(bisect_funcs));
+}
+
+} // namespace vy::stdlib::algo
@@ -0,0 +1,150 @@
+#include "../str_format.hpp"
+#include <channel.hpp>
+#include <function.hpp>
+#include <list.hpp>
+#include <stdlib/vychannel.hpp>
+#include <userdata.hpp>
+#include <util/auxlib.hpp>
+#include <vm.hpp>
+
+using namespace vy;
+using namespace vy::util;
+
+/// @file The 'channel' module. Channels carry values between VMs that run on different threads.
+/// A channel is opened by name, so that VMs that know nothing of each other can find the same one:
+///
+///   const jobs = import("channel").open("jobs", 64)
+///   jobs:send({ path: "a.txt" })   -- in one VM
+///   const job = jobs:recv()         -- in another
+///
+/// Unlike the other native modules, this one is linked into the vyse library instead of being
+/// loaded from a shared library, since the named channels have to be shared by every VM in the
+/// process.
+
+namespace vy::stdlib::channel {
+
+/// @brief The data of a channel UserData. Each VM that uses a channel has it's own UserData, and
+/// they all share the channel.
+struct ChannelRef {
+	std::shared_ptr<Channel> channel;
+};
+
+static constexpr size_t DefaultCapacity = 64;
+
+static Channel& next_channel(Args& args) {
+	ChannelRef* const ref = args.next_udata_arg<ChannelRef>();
+	return *ref->channel;
+}
+
+static Channel::Message next_message(Args& args) {
+	const Value value = args.next_arg();
+	args.check(!VYSE_IS_NIL(value), "Cannot send nil over a channel.");
+
+	Channel::Message message;
+	Value bad_value;
+	const bool packed = Channel::pack(value, message, bad_value);
+	args.check(packed, packed ? "" : kt::format_str("Cannot send a {} value over a channel.",
+													value_type_name(bad_value)));
+	return message;
+}
+
+/// @brief channel.open(name, [capacity]) returns the channel called [name], creating it if needed.
+Value open(VM& vm, int argc) {
+	Args args(vm, "channel.open", 1, argc);
+	const String& name = args.next<String>();
+	size_t capacity = DefaultCapacity;
+	if (args.has_next()) {
+		const number n = args.next_number();
+		args.check(n >= 1, "Channel capacity must be at least 1.");
+		const bool fits = n <= number(Channel::MaxCapacity);
+		args.check(fits, fits ? "" : kt::format_str("Channel capacity must be at most {}.",
+													Channel::MaxCapacity));
+		capacity = size_t(n);
+	}
+
+	const CClosure* self = VYSE_AS_CCLOSURE(vm.current_fn());
+	Table* const proto = VYSE_AS_TABLE(self->m_values->at(0));
+
+	auto* const ref = new ChannelRef{Channel::open(name.c_str(), capacity)};
+	UserData& udata = vm.make_udata<ChannelRef>(ref, proto);
+	udata.m_deleter = [](void* data) { delete static_cast<ChannelRef*>(data); };
+	return VYSE_OBJECT(&udata);
+}
+
+/// @brief Channel:send(value) sends a copy of [value], waiting for room if the channel is full.
+/// Returns false if the channel is closed.
+Value send(VM& vm, int argc) {
+	Args args(vm, "Channel:send", 2, argc);
+	Channel& channel = next_channel(args);
+	Channel::Message message = next_message(args);
+	return VYSE_BOOL(channel.send(message));
+}
+
+/// @brief Channel:try_send(value) sends a copy of [value] if there is room in the channel, and
+/// returns whether it did.
+Value try_send(VM& vm, int argc) {
+	Args args(vm, "Channel:try_send", 2, argc);
+	Channel& channel = next_channel(args);
+	Channel::Message message = next_message(args);
+	return VYSE_BOOL(!channel.is_closed() and channel.try_send(message));
+}
+
+/// @brief Channel:recv() returns the oldest value in the channel, waiting for one if it's empty.
+/// Returns nil once the channel is closed and empty.
+Value recv(VM& vm, int argc) {
+	Args args(vm, "Channel:recv", 1, argc);
+	Channel& channel = next_channel(args);
+	Channel::Message message;
+	if (!channel.recv(message)) return VYSE_NIL;
+	return Channel::unpack(vm, message);
+}
+
+/// @brief Channel:try_recv() returns the oldest value in the channel, or nil if it's empty.
+Value try_recv(VM& vm, int argc) {
+	Args args(vm, "Channel:try_recv", 1, argc);
+	Channel& channel = next_channel(args);
+	Channel::Message message;
+	if (!channel.try_recv(message)) return VYSE_NIL;
+	return Channel::unpack(vm, message);
+}
+
+/// @brief Channel:close() stops the channel from taking new values.
+Value close(VM& vm, int argc) {
+	Args args(vm, "Channel:close", 1, argc);
+	next_channel(args).close();
+	return VYSE_NIL;
+}
+
+Value is_closed(VM& vm, int argc) {
+	Args args(vm, "Channel:is_closed", 1, argc);
+	return VYSE_BOOL(next_channel(args).is_closed());
+}
+
+Value len(VM& vm, int argc) {
+	Args args(vm, "Channel:len", 1, argc);
+	return VYSE_NUM(next_channel(args).length());
+}
+
+static constexpr std::pair<const char*, NativeFn> channel_methods[] = {
+	{"send", send},		{"try_send", try_send}, {"recv", recv},	 {"try_recv", try_recv},
+	{"close", close},	{"is_closed", is_closed}, {"len", len}};
+
+void load_channel(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule channel(vm, module);
+
+	// The methods shared by all channels are kept alive in the values of `open`.
+	Table& proto = vm->make<Table>();
+	NativeModule(vm, &proto).add_cclosures(channel_methods, array_size(channel_methods));
+	GCLock proto_lock = vm->gc_lock(&proto);
+
+	List& values = vm->make<List>();
+	values.append(VYSE_OBJECT(&proto));
+	GCLock values_lock = vm->gc_lock(&values);
+
+	CClosure& ccl = vm->make<CClosure>(open, &values);
+	GCLock ccl_lock = vm->gc_lock(&ccl);
+	channel.add_field("open", VYSE_OBJECT(&ccl));
+}
+
+} // namespace vy::stdlib::channel
@@ -0,0 +1,616 @@
+#include "../str_format.hpp"
+#include <function.hpp>
+#include <list.hpp>
+#include <stdlib/native_modules.hpp>
+#include <table.hpp>
+#include <userdata.hpp>
+#include <util/auxlib.hpp>
+#include <util/lib_util.hpp>
+#include <vm.hpp>
+
+using namespace vy;
+using namespace vy::util;
+
+/// @file The 'collections' module. Provides two native containers, `Set` and `Deque`, that
+/// are exposed to vyse code as UserData objects with a shared prototype of methods.
+/// Since vyse has no generic iteration protocol yet, both containers can be walked with
+/// `foreach`, converted with `to_list`, or indexed (Deque only) with `at` and `len`.
+
+namespace vy::stdlib::collections {
+
+/// @brief An open addressing hash set of vyse values. Uses the same hash function and
+/// notion of equality as `Table`, so `s:has(k)` is true exactly when a table would treat `k`
+/// as the same key.
+class ValueSet {
+  public:
+	static constexpr size_t DefaultCapacity = 8;
+	static constexpr float LoadFactor = 0.75;
+
+	/// @brief A free slot holds nil, and a removed slot (tombstone) holds undefined.
+	struct Slot {
+		Value value;
+		size_t hash = 0;
+	};
+
+	ValueSet() = default;
+	VYSE_NO_COPY(ValueSet);
+	VYSE_NO_MOVE(ValueSet);
+
+	~ValueSet() {
+		delete[] m_slots;
+	}
+
+	/// @return true if [value] wasn't already in the set.
+	bool add(Value value) {
+		VYSE_ASSERT(!VYSE_IS_NIL(value), "nil added to Set.");
+		ensure_capacity();
+
+		const size_t hash = Table::hash_value(value);
+		Slot& slot = find_slot(value, hash);
+		if (is_live(slot)) return false;
+
+		if (VYSE_IS_NIL(slot.value)) ++m_num_used;
+		slot.value = value;
+		slot.hash = hash;
+		++m_length;
+		++m_version;
+		return true;
+	}
+
+	[[nodiscard]] bool has(Value value) const {
+		if (m_length == 0 or VYSE_IS_NIL(value)) return false;
+		return is_live(find_slot(value, Table::hash_value(value)));
+	}
+
+	/// @return true if [value] was in the set before it was removed.
+	bool remove(Value value) {
+		if (m_length == 0 or VYSE_IS_NIL(value)) return false;
+		Slot& slot = find_slot(value, Table::hash_value(value));
+		if (!is_live(slot)) return false;
+
+		VYSE_SET_TT(slot.value, ValueType::Undefined);
+		--m_length;
+		++m_version;
+		return true;
+	}
+
+	void clear() noexcept {
+		delete[] m_slots;
+		m_slots = nullptr;
+		m_cap = m_length = m_num_used = 0;
+		++m_version;
+	}
+
+	[[nodiscard]] size_t length() const noexcept {
+		return m_length;
+	}
+
+	/// @brief Incremented on every change to the set, so that iterators can tell when the
+	/// set was modified under them.
+	[[nodiscard]] size_t version() const noexcept {
+		return m_version;
+	}
+
+	/// @brief Number of slots that can be walked with `slot_at`. Slots that don't hold an
+	/// element are skipped with `is_live`.
+	[[nodiscard]] size_t capacity() const noexcept {
+		return m_cap;
+	}
+
+	[[nodiscard]] const Slot& slot_at(size_t index) const noexcept {
+		return m_slots[index];
+	}
+
+	[[nodiscard]] static bool is_live(const Slot& slot) noexcept {
+		return !VYSE_IS_NIL(slot.value) and !VYSE_IS_UNDEFINED(slot.value);
+	}
+
+	void trace(GC& gc) {
+		for (size_t i = 0; i < m_cap; ++i) {
+			if (is_live(m_slots[i])) gc.mark_value(m_slots[i].value);
+		}
+	}
+
+  private:
+	Slot* m_slots = nullptr;
+	size_t m_cap = 0;
+	/// @brief The number of live elements.
+	size_t m_length = 0;
+	/// @brief The number of live elements plus tombstones.
+	size_t m_num_used = 0;
+	size_t m_version = 0;
+
+	/// @brief Returns the slot holding [value] if there is one, otherwise the slot that
+	/// [value] should be inserted into. The set must have at least one free slot.
+	Slot& find_slot(Value value, size_t hash) const {
+		const size_t mask = m_cap - 1;
+		size_t index = hash & mask;
+		Slot* first_tombstone = nullptr;
+
+		while (true) {
+			Slot& slot = m_slots[index];
+			if (VYSE_IS_NIL(slot.value)) return first_tombstone ? *first_tombstone : slot;
+			if (VYSE_IS_UNDEFINED(slot.value)) {
+				if (first_tombstone == nullptr) first_tombstone = &slot;
+			} else if (slot.hash == hash and slot.value == value) {
+				return slot;
+			}
+			index = (index + 1) & mask;
+		}
+	}
+
+	/// @brief Makes sure there is room for one more element, growing the slots or clearing out
+	/// tombstones if needed.
+	void ensure_capacity() {
+		if (m_num_used + 1 <= m_cap * LoadFactor) return;
+
+		const size_t old_cap = m_cap;
+		Slot* const old_slots = m_slots;
+
+		// If most of the used slots are tombstones, rehashing at the same capacity is enough.
+		if (old_cap == 0) {
+			m_cap = DefaultCapacity;
+		} else if (m_length + 1 > old_cap / 2) {
+			m_cap = old_cap * 2;
+		}
+
+		m_slots = new Slot[m_cap];
+		m_num_used = m_length;
+
+		for (size_t i = 0; i < old_cap; ++i) {
+			if (!is_live(old_slots[i])) continue;
+			find_slot(old_slots[i].value, old_slots[i].hash) = old_slots[i];
+		}
+
+		delete[] old_slots;
+	}
+};
+
+/// @brief A double ended queue stored in a ring buffer whose capacity is always a power of two.
+class ValueDeque {
+  public:
+	static constexpr size_t DefaultCapacity = 8;
+
+	ValueDeque() = default;
+	VYSE_NO_COPY(ValueDeque);
+	VYSE_NO_MOVE(ValueDeque);
+
+	~ValueDeque() {
+		delete[] m_values;
+	}
+
+	void push_back(Value value) {
+		ensure_capacity();
+		m_values[(m_head + m_length) & (m_cap - 1)] = value;
+		++m_length;
+		++m_version;
+	}
+
+	void push_front(Value value) {
+		ensure_capacity();
+		m_head = (m_head - 1) & (m_cap - 1);
+		m_values[m_head] = value;
+		++m_length;
+		++m_version;
+	}
+
+	Value pop_back() noexcept {
+		VYSE_ASSERT(m_length > 0, "pop from empty Deque.");
+		--m_length;
+		++m_version;
+		return m_values[(m_head + m_length) & (m_cap - 1)];
+	}
+
+	Value pop_front() noexcept {
+		VYSE_ASSERT(m_length > 0, "pop from empty Deque.");
+		const Value value = m_values[m_head];
+		m_head = (m_head + 1) & (m_cap - 1);
+		--m_length;
+		++m_version;
+		return value;
+	}
+
+	/// @brief Returns the [index]th value counting from the front.
+	[[nodiscard]] Value at(size_t index) const noexcept {
+		VYSE_ASSERT(index < m_length, "Deque index out of range.");
+		return m_values[(m_head + index) & (m_cap - 1)];
+	}
+
+	void clear() noexcept {
+		m_head = m_length = 0;
+		++m_version;
+	}
+
+	[[nodiscard]] size_t length() const noexcept {
+		return m_length;
+	}
+
+	[[nodiscard]] size_t version() const noexcept {
+		return m_version;
+	}
+
+	void trace(GC& gc) {
+		for (size_t i = 0; i < m_length; ++i) {
+			gc.mark_value(m_values[(m_head + i) & (m_cap - 1)]);
+		}
+	}
+
+  private:
+	Value* m_values = nullptr;
+	size_t m_cap = 0;
+	size_t m_head = 0;
+	size_t m_length = 0;
+	size_t m_version = 0;
+
+	/// @brief Makes sure there is room for one more value. Growing unwraps the ring so that
+	/// the front of the deque is at index 0 again.
+	void ensure_capacity() {
+		if (m_length < m_cap) return;
+
+		const size_t new_cap = m_cap == 0 ? DefaultCapacity : m_cap * 2;
+		Value* const values = new Value[new_cap];
+		for (size_t i = 0; i < m_length; ++i) {
+			values[i] = m_values[(m_head + i) & (m_cap - 1)];
+		}
+
+		delete[] m_values;
+		m_values = values;
+		m_cap = new_cap;
+		m_head = 0;
+	}
+};
+
+/// @brief Returns the container wrapped by the next argument, which must be a UserData holding
+/// a [T].
+template <typename T>
+static T& next_container(Args& args, const char* type_name) {
+	const Value arg = args.next_arg();
+	T* const container = VYSE_IS_UDATA(arg) ? VYSE_AS_UDATA(arg)->get<T>() : nullptr;
+	args.check(container != nullptr,
+			   kt::format_str("Expected a {}, got {}.", type_name, value_type_name(arg)));
+	return *container;
+}
+
+/// @brief Returns the method table stored in the values of the constructor that is currently
+/// executing.
+static Table* ctor_proto(VM& vm) {
+	const CClosure* ctor = VYSE_AS_CCLOSURE(vm.current_fn());
+	VYSE_ASSERT(ctor->m_values != nullptr, "constructor has no prototype.");
+	return VYSE_AS_TABLE(ctor->m_values->at(0));
+}
+
+/// @brief Wraps a new [T] in a UserData with the prototype [proto].
+template <typename T>
+static UserData& make_container(VM& vm, Table* proto) {
+	UserData& udata = vm.make_udata<T>(new T(), proto);
+	udata.m_deleter = [](void* data) { delete static_cast<T*>(data); };
+	udata.m_tracer = [](GC& gc, void* data) { static_cast<T*>(data)->trace(gc); };
+	return udata;
+}
+
+/// @brief Throws an error if [container] was modified while it was being iterated.
+template <typename T>
+static void check_version(Args& args, const T& container, size_t version, const char* type_name) {
+	args.check(container.version() == version,
+			   kt::format_str("{} was modified during iteration.", type_name));
+}
+
+// ---- Set ----
+
+#define SET_SELF() ValueSet& set = next_container<ValueSet>(args, "Set")
+
+static void set_add_checked(Args& args, ValueSet& set, Value value) {
+	args.check(!VYSE_IS_NIL(value), "Cannot add nil to a Set.");
+	set.add(value);
+}
+
+/// @brief collections.Set([list]) creates a new set, optionally containing the items of [list].
+Value Set(VM& vm, int argc) {
+	Args args(vm, "collections.Set", 0, argc);
+	const List* items = args.has_next() ? &args.next<List>() : nullptr;
+
+	UserData& udata = make_container<ValueSet>(vm, ctor_proto(vm));
+	ValueSet& set = *udata.unsafe_get<ValueSet>();
+	if (items != nullptr) {
+		for (size_t i = 0; i < items->length(); ++i) {
+			set_add_checked(args, set, (*items)[i]);
+		}
+	}
+
+	return VYSE_OBJECT(&udata);
+}
+
+/// @brief Set:add(value) adds [value] to the set and returns true if it wasn't already present.
+Value set_add(VM& vm, int argc) {
+	Args args(vm, "Set:add", 2, argc);
+	SET_SELF();
+	const Value value = args.next_arg();
+	args.check(!VYSE_IS_NIL(value), "Cannot add nil to a Set.");
+	return VYSE_BOOL(set.add(value));
+}
+
+/// @brief Set:has(value) returns true if [value] is in the set.
+Value set_has(VM& vm, int argc) {
+	Args args(vm, "Set:has", 2, argc);
+	SET_SELF();
+	return VYSE_BOOL(set.has(args.next_arg()));
+}
+
+/// @brief Set:remove(value) removes [value] from the set and returns true if it was present.
+Value set_remove(VM& vm, int argc) {
+	Args args(vm, "Set:remove", 2, argc);
+	SET_SELF();
+	return VYSE_BOOL(set.remove(args.next_arg()));
+}
+
+Value set_len(VM& vm, int argc) {
+	Args args(vm, "Set:len", 1, argc);
+	SET_SELF();
+	return VYSE_NUM(set.length());
+}
+
+Value set_clear(VM& vm, int argc) {
+	Args args(vm, "Set:clear", 1, argc);
+	SET_SELF();
+	set.clear();
+	return VYSE_NIL;
+}
+
+/// @brief Creates a set with every element of [a] for which `b.has(element) == keep`. When
+/// [include_b] is true, the elements of [b] are added too.
+static Value set_combine(VM& vm, const ValueSet& a, const ValueSet& b, bool keep, bool include_b) {
+	// The receiver has already been checked to be a Set, so the result can share it's prototype.
+	UserData& udata = make_container<ValueSet>(vm, VYSE_AS_UDATA(vm.get_arg(0))->m_proto);
+	ValueSet& result = *udata.unsafe_get<ValueSet>();
+
+	for (size_t i = 0; i < a.capacity(); ++i) {
+		const ValueSet::Slot& slot = a.slot_at(i);
+		if (ValueSet::is_live(slot) and b.has(slot.value) == keep) result.add(slot.value);
+	}
+
+	if (include_b) {
+		for (size_t i = 0; i < b.capacity(); ++i) {
+			const ValueSet::Slot& slot = b.slot_at(i);
+			if (ValueSet::is_live(slot)) result.add(slot.value);
+		}
+	}
+
+	return VYSE_OBJECT(&udata);
+}
+
+/// @brief Set:union(other) returns a new set with the elements that are in either set.
+Value set_union(VM& vm, int argc) {
+	Args args(vm, "Set:union", 2, argc);
+	SET_SELF();
+	const ValueSet& other = next_container<ValueSet>(args, "Set");
+	// The elements of [set] that aren't in [other], followed by all of [other].
+	return set_combine(vm, set, other, false, true);
+}
+
+/// @brief Set:intersection(other) returns a new set with the elements that are in both sets.
+Value set_intersection(VM& vm, int argc) {
+	Args args(vm, "Set:intersection", 2, argc);
+	SET_SELF();
+	const ValueSet& other = next_container<ValueSet>(args, "Set");
+	// Walking the smaller set keeps the number of probes down.
+	if (other.length() < set.length()) return set_combine(vm, other, set, true, false);
+	return set_combine(vm, set, other, true, false);
+}
+
+/// @brief Set:difference(other) returns a new set with the elements that are in this set
+/// but not in [other].
+Value set_difference(VM& vm, int argc) {
+	Args args(vm, "Set:difference", 2, argc);
+	SET_SELF();
+	const ValueSet& other = next_container<ValueSet>(args, "Set");
+	return set_combine(vm, set, other, false, false);
+}
+
+/// @brief Set:to_list() returns a list of the elements in the set, in no particular order.
+Value set_to_list(VM& vm, int argc) {
+	Args args(vm, "Set:to_list", 1, argc);
+	SET_SELF();
+
+	List& list = vm.make<List>(set.length());
+	for (size_t i = 0, j = 0; i < set.capacity(); ++i) {
+		const ValueSet::Slot& slot = set.slot_at(i);
+		if (ValueSet::is_live(slot)) list[j++] = slot.value;
+	}
+
+	return VYSE_OBJECT(&list);
+}
+
+/// @brief Set:foreach(fn) calls [fn] with every element of the set, in no particular order.
+Value set_foreach(VM& vm, int argc) {
+	Args args(vm, "Set:foreach", 2, argc);
+	SET_SELF();
+	const Value func = args.next_arg();
+
+	const size_t version = set.version();
+	vm.ensure_slots(2);
+	for (size_t i = 0; i < set.capacity(); ++i) {
+		const ValueSet::Slot& slot = set.slot_at(i);
+		if (!ValueSet::is_live(slot)) continue;
+
+		vm.m_stack.push(func);
+		vm.m_stack.push(slot.value);
+		if (!vm.call(1)) return VYSE_NIL;
+		vm.m_stack.pop();
+		check_version(args, set, version, "Set");
+	}
+
+	return VYSE_NIL;
+}
+
+#undef SET_SELF
+
+// ---- Deque ----
+
+#define DEQUE_SELF() ValueDeque& deque = next_container<ValueDeque>(args, "Deque")
+
+/// @brief collections.Deque([list]) creates a new deque, optionally containing the items of
+/// [list] from front to back.
+Value Deque(VM& vm, int argc) {
+	Args args(vm, "collections.Deque", 0, argc);
+	const List* items = args.has_next() ? &args.next<List>() : nullptr;
+
+	UserData& udata = make_container<ValueDeque>(vm, ctor_proto(vm));
+	ValueDeque& deque = *udata.unsafe_get<ValueDeque>();
+	if (items != nullptr) {
+		for (size_t i = 0; i < items->length(); ++i) deque.push_back((*items)[i]);
+	}
+
+	return VYSE_OBJECT(&udata);
+}
+
+/// @brief Deque:push_back(value) adds [value] to the back and returns the new length.
+Value deque_push_back(VM& vm, int argc) {
+	Args args(vm, "Deque:push_back", 2, argc);
+	DEQUE_SELF();
+	deque.push_back(args.next_arg());
+	return VYSE_NUM(deque.length());
+}
+
+/// @brief Deque:push_front(value) adds [value] to the front and returns the new length.
+Value deque_push_front(VM& vm, int argc) {
+	Args args(vm, "Deque:push_front", 2, argc);
+	DEQUE_SELF();
+	deque.push_front(args.next_arg());
+	return VYSE_NUM(deque.length());
+}
+
+Value deque_pop_back(VM& vm, int argc) {
+	Args args(vm, "Deque:pop_back", 1, argc);
+	DEQUE_SELF();
+	args.check(deque.length() > 0, "Attempt to pop from an empty Deque.");
+	return deque.pop_back();
+}
+
+Value deque_pop_front(VM& vm, int argc) {
+	Args args(vm, "Deque:pop_front", 1, argc);
+	DEQUE_SELF();
+	args.check(deque.length() > 0, "Attempt to pop from an empty Deque.");
+	return deque.pop_front();
+}
+
+/// @brief Deque:front() returns the value at the front without removing it, or nil if the
+/// deque is empty.
+Value deque_front(VM& vm, int argc) {
+	Args args(vm, "Deque:front", 1, argc);
+	DEQUE_SELF();
+	return deque.length() > 0 ? deque.at(0) : VYSE_NIL;
+}
+
+/// @brief Deque:back() returns the value at the back without removing it, or nil if the
+/// deque is empty.
+Value deque_back(VM& vm, int argc) {
+	Args args(vm, "Deque:back", 1, argc);
+	DEQUE_SELF();
+	return deque.length() > 0 ? deque.at(deque.length() - 1) : VYSE_NIL;
+}
+
+/// @brief Deque:at(index) returns the [index]th value from the front, or nil if [index] is out
+/// of range.
+Value deque_at(VM& vm, int argc) {
+	Args args(vm, "Deque:at", 2, argc);
+	DEQUE_SELF();
+	const number index = args.next_number();
+	if (index < 0 or index >= deque.length() or !is_integer(index)) return VYSE_NIL;
+	return deque.at(size_t(index));
+}
+
+Value deque_len(VM& vm, int argc) {
+	Args args(vm, "Deque:len", 1, argc);
+	DEQUE_SELF();
+	return VYSE_NUM(deque.length());
+}
+
+Value deque_clear(VM& vm, int argc) {
+	Args args(vm, "Deque:clear", 1, argc);
+	DEQUE_SELF();
+	deque.clear();
+	return VYSE_NIL;
+}
+
+/// @brief Deque:to_list() returns a list of the values in the deque from front to back.
+Value deque_to_list(VM& vm, int argc) {
+	Args args(vm, "Deque:to_list", 1, argc);
+	DEQUE_SELF();
+
+	List& list = vm.make<List>(deque.length());
+	for (size_t i = 0; i < deque.length(); ++i) list[i] = deque.at(i);
+	return VYSE_OBJECT(&list);
+}
+
+/// @brief Deque:foreach(fn) calls `fn(value, index)` for every value from front to back.
+Value deque_foreach(VM& vm, int argc) {
+	Args args(vm, "Deque:foreach", 2, argc);
+	DEQUE_SELF();
+	const Value func = args.next_arg();
+
+	const size_t version = deque.version();
+	vm.ensure_slots(3);
+	for (size_t i = 0; i < deque.length(); ++i) {
+		vm.m_stack.push(func);
+		vm.m_stack.push(deque.at(i));
+		vm.m_stack.push(VYSE_NUM(i));
+		if (!vm.call(2)) return VYSE_NIL;
+		vm.m_stack.pop();
+		check_version(args, deque, version, "Deque");
+	}
+
+	return VYSE_NIL;
+}
+
+#undef DEQUE_SELF
+
+static constexpr std::pair<const char*, NativeFn> set_methods[] = {
+	{"add", set_add},
+	{"has", set_has},
+	{"remove", set_remove},
+	{"len", set_len},
+	{"clear", set_clear},
+	{"union", set_union},
+	{"intersection", set_intersection},
+	{"difference", set_difference},
+	{"to_list", set_to_list},
+	{"foreach", set_foreach}};
+
+static constexpr std::pair<const char*, NativeFn> deque_methods[] = {
+	{"push_back", deque_push_back},
+	{"push_front", deque_push_front},
+	{"pop_back", deque_pop_back},
+	{"pop_front", deque_pop_front},
+	{"front", deque_front},
+	{"back", deque_back},
+	{"at", deque_at},
+	{"len", deque_len},
+	{"clear", deque_clear},
+	{"to_list", deque_to_list},
+	{"foreach", deque_foreach}};
+
+/// @brief Adds a constructor named [name] to [module]. The table of [methods] shared by all
+/// instances is kept alive in the values of the constructor.
+static void add_container(VM& vm, NativeModule& module, const char* name, NativeFn ctor,
+						  const std::pair<const char*, NativeFn>* methods, size_t num_methods) {
+	Table& proto = vm.make<Table>();
+	NativeModule(&vm, &proto).add_cclosures(methods, num_methods);
+	GCLock proto_lock = vm.gc_lock(&proto);
+
+	List& values = vm.make<List>();
+	values.append(VYSE_OBJECT(&proto));
+	GCLock values_lock = vm.gc_lock(&values);
+
+	CClosure& ccl = vm.make<CClosure>(ctor, &values);
+	GCLock ccl_lock = vm.gc_lock(&ccl);
+	module.add_field(name, VYSE_OBJECT(&ccl));
+}
+
+VYSE_API void load_collections(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule collections(vm, module);
+	add_container(*vm, collections, "Set", Set, set_methods, array_size(set_methods));
+	add_container(*vm, collections, "Deque", Deque, deque_methods, array_size(deque_methods));
+}
+
+} // namespace vy::stdlib::collections
@@ -1,6 +1,7 @@
 #include <cmath>
 #include <limits>
 #include <random>
+#include <stdlib/native_modules.hpp>
 #include <type_traits>
 #include <util/auxlib.hpp>
 #include <util/lib_util.hpp>
@@ -236,6 +237,11 @@ Value ceil(VM& vm, int argc) {
 	return VYSE_NUM(std::ceil(args.next_number()));
 }
 
+Value abs(VM& vm, int argc) {
+	Args args(vm, "math.abs", 1, argc);
+	return VYSE_NUM(std::abs(args.next_number()));
+}
+
 Value gcd(VM& vm, int argc) {
 	Args args(vm, "math.gcd", 2, argc);
 	const number l = args.next_number();
@@ -249,7 +255,12 @@ static constexpr std::pair<const char*, NativeFn> funcs[] = {
 	{"atan", atan}, {"max", max},		{"min", min},		  {"isnan", isnan}, {"isinf", isinf},
 	{"log", log},	{"log10", log10},	{"exp", exp},		  {"todeg", todeg}, {"torad", torad},
 	{"tan2", tan2}, {"atan2", atan2},	{"pow", pow},		  {"comb", comb},	{"floor", floor},
-	{"ceil", ceil}, {"gcd", gcd},
+	{"ceil", ceil}, {"gcd", gcd},		{"abs", abs},
+};
+
+static constexpr std::pair<const char*, Intrinsic> intrinsics[] = {
+	{"sqrt", Intrinsic::sqrt}, {"floor", Intrinsic::floor}, {"ceil", Intrinsic::ceil},
+	{"abs", Intrinsic::abs},   {"sin", Intrinsic::sin},		{"cos", Intrinsic::cos},
 };
 
 VYSE_API void load_math(VM* vm, Table* module) {
@@ -257,6 +268,7 @@ VYSE_API void load_math(VM* vm, Table* module) {
 	NativeModule math(vm, module);
 
 	math.add_cclosures(funcs, array_size(funcs));
+	for (const auto& [name, id] : intrinsics) math.set_intrinsic(name, id);
 
 	math.add_field("pi", VYSE_NUM(pi));
 	math.add_field("nan", VYSE_NUM(vy_nan));
@@ -0,0 +1,275 @@
+#include "../str_format.hpp"
+#include <algorithm>
+#include <atomic>
+#include <frozen.hpp>
+#include <function.hpp>
+#include <list.hpp>
+#include <mutex>
+#include <stdlib/vyparallel.hpp>
+#include <system_error>
+#include <thread>
+#include <userdata.hpp>
+#include <util/auxlib.hpp>
+#include <vm.hpp>
+
+using namespace vy;
+using namespace vy::util;
+
+/// @file The 'parallel' module. `parallel.map(list, fn, [options])` calls `fn(item, index)` for
+/// every item of a list on a pool of worker threads, each of which runs it's own VM, and returns
+/// the results in order:
+///
+///   const scores = import("parallel").map(rows, /(row) -> score(row))
+///
+/// The function is frozen along with the code of every function it can reach and the values of
+/// the variables it captured, so that all workers run the same bytecode without copying it. The
+/// items are frozen too, and the results are copied back into the calling VM. Like the 'channel'
+/// module, this one is linked into the vyse library, since frozen regions can't be shared with a
+/// copy of the library that was loaded separately.
+
+namespace vy::stdlib::parallel {
+
+/// The number of chunks each worker is handed by default. Having a few per worker gives the
+/// workers that finish early something to steal.
+static constexpr size_t ChunksPerWorker = 4;
+
+/// @brief The chunks [begin, end) of a list that a worker owns. The owner takes chunks from the
+/// front, and workers that have run out of their own steal from the back.
+struct ChunkQueue {
+	std::mutex mutex;
+	size_t begin = 0;
+	size_t end = 0;
+
+	bool pop_front(size_t& chunk) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (begin == end) return false;
+		chunk = begin++;
+		return true;
+	}
+
+	bool pop_back(size_t& chunk) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (begin == end) return false;
+		chunk = --end;
+		return true;
+	}
+};
+
+/// @brief The state of a call to `parallel.map` that is shared by it's workers.
+struct Job {
+	std::shared_ptr<const FrozenRegion> func;
+	std::shared_ptr<const FrozenRegion> items;
+	size_t num_items = 0;
+	size_t chunk_size = 0;
+
+	size_t num_workers = 0;
+	std::unique_ptr<ChunkQueue[]> queues;
+
+	/// The results of each chunk, frozen into a list by the worker that ran it.
+	std::vector<std::shared_ptr<const FrozenRegion>> results;
+
+	// The workers print, read input and import modules the same way the calling VM does.
+	PrintFn print;
+	ReadLineFn read_line;
+	ModuleLoader find_module;
+	std::string path;
+
+	std::atomic<bool> failed{false};
+	std::mutex error_mutex;
+	/// The first error raised by a worker.
+	std::string error;
+
+	/// @brief Sets [chunk] to the next chunk that [worker] should run.
+	/// @return false if there are no chunks left.
+	bool next_chunk(size_t worker, size_t& chunk) {
+		if (queues[worker].pop_front(chunk)) return true;
+		for (size_t i = 1; i < num_workers; ++i) {
+			if (queues[(worker + i) % num_workers].pop_back(chunk)) return true;
+		}
+		return false;
+	}
+
+	/// @brief Stops all workers, and reports [message] unless an error has already been reported.
+	void fail(std::string message) {
+		std::lock_guard<std::mutex> lock(error_mutex);
+		if (!failed.exchange(true)) error = std::move(message);
+	}
+};
+
+/// @brief The data of the native function that a worker's script calls.
+struct Worker {
+	Job* const job;
+	const size_t id;
+};
+
+/// @brief Runs chunks of a job until there are none left. This is what the script of a worker
+/// calls, so that the mapped function is always called from a native frame.
+static Value run_chunks(VM& vm, int) {
+	const CClosure* self = VYSE_AS_CCLOSURE(vm.current_fn());
+	const Worker& worker = *VYSE_AS_UDATA(self->m_values->at(0))->unsafe_get<Worker>();
+	Job& job = *worker.job;
+
+	const Value func = vm.adopt(job.func);
+	const List& items = *VYSE_AS_LIST(vm.adopt(job.items));
+
+	vm.ensure_slots(3);
+	size_t chunk = 0;
+	while (!job.failed.load(std::memory_order_relaxed) and job.next_chunk(worker.id, chunk)) {
+		const size_t begin = chunk * job.chunk_size;
+		const size_t end = std::min(begin + job.chunk_size, job.num_items);
+
+		List& results = vm.make<List>();
+		GCLock lock = vm.gc_lock(&results);
+		results.reserve(end - begin);
+		for (size_t i = begin; i < end; ++i) {
+			vm.m_stack.push(func);
+			vm.m_stack.push(items[i]);
+			vm.m_stack.push(VYSE_NUM(i));
+			// The error has already been reported to the job by the VM.
+			if (!vm.call(2)) return VYSE_NIL;
+			results.append(vm.m_stack.pop());
+		}
+
+		Value bad_value;
+		job.results[chunk] = FrozenRegion::freeze(VYSE_OBJECT(&results), bad_value);
+		if (job.results[chunk] == nullptr) {
+			job.fail(kt::format_str("Cannot send a {} value back from a worker.",
+									value_type_name(bad_value)));
+			return VYSE_NIL;
+		}
+	}
+
+	return VYSE_NIL;
+}
+
+static void run_worker(Job& job, size_t id) {
+	VM vm;
+	vm.print = job.print;
+	vm.read_line = job.read_line;
+	vm.find_module = job.find_module;
+	vm.on_error = [&job](VM&, RuntimeError error) {
+		// The rest of the message is a stack trace that ends in the worker's script.
+		const std::string& message = error.full_message;
+		job.fail(message.substr(0, message.find('\n')));
+	};
+	vm.load_stdlib();
+
+	Worker worker{&job, id};
+	List& values = vm.make<List>();
+	GCLock values_lock = vm.gc_lock(&values);
+	values.append(VYSE_OBJECT(&vm.make_udata<Worker>(&worker)));
+	vm.set_global("__run_chunks", VYSE_OBJECT(&vm.make<CClosure>(run_chunks, &values)));
+
+	// The worker's script is named after the caller's, so that errors point to the right file and
+	// modules are imported relative to it.
+	vm.runcode("__run_chunks()", job.path);
+}
+
+/// @return The value of the option [name] in [options], or [default_value] if it isn't set.
+static size_t size_option(VM& vm, Args& args, const Table& options, const char* name,
+						  size_t default_value) {
+	const Value value = options.get(VYSE_OBJECT(&vm.make_string(name)));
+	if (VYSE_IS_NIL(value)) return default_value;
+	args.check(VYSE_IS_NUM(value) and is_integer(VYSE_AS_NUM(value)) and VYSE_AS_NUM(value) >= 1,
+			   kt::format_str("Option '{}' must be a positive integer.", name));
+	return size_t(VYSE_AS_NUM(value));
+}
+
+/// @brief parallel.map(list, fn, [options]) returns a list of `fn(item, index)` for every item of
+/// [list], calling fn on several threads at once. [options] may set the number of `workers`
+/// (one per core by default), and the number of items in each chunk of work (`chunk_size`).
+Value map(VM& vm, int argc) {
+	Args args(vm, "parallel.map", 2, argc);
+	List& list = args.next<List>();
+	const Value func = args.next_arg();
+	args.check(VYSE_IS_CLOSURE(func) or VYSE_IS_CCLOSURE(func),
+			   kt::format_str("Bad arg #2. Expected function, got {}.", value_type_name(func)));
+
+	size_t num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+	size_t chunk_size = 0;
+	if (args.has_next()) {
+		const Table& options = args.next<Table>();
+		num_workers = size_option(vm, args, options, "workers", num_workers);
+		chunk_size = size_option(vm, args, options, "chunk_size", 0);
+	}
+
+	const size_t num_items = list.length();
+	if (num_items == 0) return VYSE_OBJECT(&vm.make<List>());
+
+	if (chunk_size == 0) {
+		const size_t num_chunks = num_workers * ChunksPerWorker;
+		chunk_size = std::max<size_t>((num_items + num_chunks - 1) / num_chunks, 1);
+	}
+	const size_t num_chunks = (num_items + chunk_size - 1) / chunk_size;
+	num_workers = std::min(num_workers, num_chunks);
+
+	Job job;
+	Value bad_value;
+	job.func = FrozenRegion::freeze_code(vm, func, bad_value);
+	if (job.func == nullptr) {
+		if (VYSE_IS_CLOSURE(bad_value)) {
+			args.check(false, kt::format_str("Function '{}' assigns to a variable it captured, "
+											 "and can't run on a worker.",
+											 VYSE_AS_CLOSURE(bad_value)->name_cstr()));
+		}
+		args.check(false, kt::format_str("Cannot send a {} value to a worker.",
+										 value_type_name(bad_value)));
+	}
+
+	job.items = list.is_frozen() ? FrozenRegion::of(list)
+								 : FrozenRegion::freeze(VYSE_OBJECT(&list), bad_value);
+	args.check(job.items != nullptr, job.items != nullptr
+										 ? ""
+										 : kt::format_str("Cannot send a {} value to a worker.",
+														  value_type_name(bad_value)));
+
+	job.num_items = num_items;
+	job.chunk_size = chunk_size;
+	job.num_workers = num_workers;
+	job.queues = std::make_unique<ChunkQueue[]>(num_workers);
+	for (size_t i = 0; i < num_workers; ++i) {
+		job.queues[i].begin = i * num_chunks / num_workers;
+		job.queues[i].end = (i + 1) * num_chunks / num_workers;
+	}
+	job.results.resize(num_chunks);
+
+	job.print = vm.print;
+	job.read_line = vm.read_line;
+	job.find_module = vm.find_module;
+	job.path = vm.get_current_file();
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_workers);
+	for (size_t i = 0; i < num_workers; ++i) {
+		try {
+			threads.emplace_back(run_worker, std::ref(job), i);
+		} catch (const std::system_error&) {
+			// The chunks of a worker that couldn't be started are stolen by the others.
+			break;
+		}
+	}
+	for (std::thread& thread : threads) thread.join();
+
+	args.check(!threads.empty(), "Could not start a worker thread.");
+	args.check(!job.failed, job.error);
+
+	List& result = vm.make<List>();
+	GCLock lock = vm.gc_lock(&result);
+	result.reserve(num_items);
+	for (const std::shared_ptr<const FrozenRegion>& chunk : job.results) {
+		const List& values = *VYSE_AS_LIST(chunk->thaw(vm));
+		for (size_t i = 0; i < values.length(); ++i) result.append(values[i]);
+	}
+
+	return VYSE_OBJECT(&result);
+}
+
+static constexpr std::pair<const char*, NativeFn> funcs[] = {{"map", map}};
+
+void load_parallel(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule parallel(vm, module);
+	parallel.add_cclosures(funcs, array_size(funcs));
+}
+
+} // namespace vy::stdlib::parallel
@@ -0,0 +1,234 @@
+#include "../str_format.hpp"
+#include <algorithm>
+#include <cmath>
+#include <list.hpp>
+#include <stdlib/native_modules.hpp>
+#include <util/auxlib.hpp>
+#include <util/lib_util.hpp>
+#include <vector>
+#include <vm.hpp>
+
+using namespace vy;
+using namespace vy::util;
+
+namespace vy::stdlib::stats {
+
+/// @brief Returns a pointer to the values of `list` after making sure that every one
+/// of them is a number. The reduction kernels below can then read `as.num` blindly.
+static const Value* number_values(Args& args, const List& list) {
+	const Value* values = list.data();
+	const size_t len = list.length();
+	for (size_t i = 0; i < len; ++i) {
+		if (!VYSE_IS_NUM(values[i])) {
+			args.check(false, kt::format_str("Expected a list of numbers, found {} at index {}.",
+											 value_type_name(values[i]), i));
+		}
+	}
+	return values;
+}
+
+/// @brief Sum of `len` numbers. The loop is unrolled over four independent
+/// accumulators so that the additions don't serialize on a single register.
+static number sum_of(const Value* values, size_t len) noexcept {
+	number s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	size_t i = 0;
+	for (; i + 4 <= len; i += 4) {
+		s0 += values[i].as.num;
+		s1 += values[i + 1].as.num;
+		s2 += values[i + 2].as.num;
+		s3 += values[i + 3].as.num;
+	}
+	for (; i < len; ++i) s0 += values[i].as.num;
+	return (s0 + s1) + (s2 + s3);
+}
+
+/// @brief Sum of squared distances from `mean`, unrolled the same way as `sum_of`.
+static number sq_dev_of(const Value* values, size_t len, number mean) noexcept {
+	number s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	size_t i = 0;
+	for (; i + 4 <= len; i += 4) {
+		const number d0 = values[i].as.num - mean;
+		const number d1 = values[i + 1].as.num - mean;
+		const number d2 = values[i + 2].as.num - mean;
+		const number d3 = values[i + 3].as.num - mean;
+		s0 += d0 * d0;
+		s1 += d1 * d1;
+		s2 += d2 * d2;
+		s3 += d3 * d3;
+	}
+	for (; i < len; ++i) {
+		const number d = values[i].as.num - mean;
+		s0 += d * d;
+	}
+	return (s0 + s1) + (s2 + s3);
+}
+
+/// @brief Index of the smallest (when `Less` is true) or the largest number in a non-empty list.
+/// Ties resolve to the first occurrence.
+template <bool Less>
+static size_t extremum_index(const Value* values, size_t len) noexcept {
+	size_t best = 0;
+	number best_value = values[0].as.num;
+	for (size_t i = 1; i < len; ++i) {
+		const number x = values[i].as.num;
+		if (Less ? x < best_value : x > best_value) {
+			best_value = x;
+			best = i;
+		}
+	}
+	return best;
+}
+
+Value sum(VM& vm, int argc) {
+	Args args(vm, "stats.sum", 1, argc);
+	const List& list = args.next<List>();
+	return VYSE_NUM(sum_of(number_values(args, list), list.length()));
+}
+
+Value mean(VM& vm, int argc) {
+	Args args(vm, "stats.mean", 1, argc);
+	const List& list = args.next<List>();
+	args.check(list.length() > 0, "Cannot compute the mean of an empty list.");
+	return VYSE_NUM(sum_of(number_values(args, list), list.length()) / list.length());
+}
+
+/// @brief Population variance, or the sample variance when the optional
+/// second argument (delta degrees of freedom) is 1.
+static number variance_of(Args& args, const List& list) {
+	const size_t len = list.length();
+	number ddof = 0;
+	if (args.has_next()) ddof = args.next_number();
+	args.check(ddof >= 0 && ddof < len, "Not enough values to compute the variance.");
+
+	const Value* values = number_values(args, list);
+	const number mean = sum_of(values, len) / len;
+	return sq_dev_of(values, len, mean) / (len - ddof);
+}
+
+Value variance(VM& vm, int argc) {
+	Args args(vm, "stats.variance", 1, argc);
+	const List& list = args.next<List>();
+	return VYSE_NUM(variance_of(args, list));
+}
+
+Value stdev(VM& vm, int argc) {
+	Args args(vm, "stats.stdev", 1, argc);
+	const List& list = args.next<List>();
+	return VYSE_NUM(std::sqrt(variance_of(args, list)));
+}
+
+Value min(VM& vm, int argc) {
+	Args args(vm, "stats.min", 1, argc);
+	const List& list = args.next<List>();
+	args.check(list.length() > 0, "Cannot find the minimum of an empty list.");
+	const Value* values = number_values(args, list);
+	return values[extremum_index<true>(values, list.length())];
+}
+
+Value max(VM& vm, int argc) {
+	Args args(vm, "stats.max", 1, argc);
+	const List& list = args.next<List>();
+	args.check(list.length() > 0, "Cannot find the maximum of an empty list.");
+	const Value* values = number_values(args, list);
+	return values[extremum_index<false>(values, list.length())];
+}
+
+Value argmin(VM& vm, int argc) {
+	Args args(vm, "stats.argmin", 1, argc);
+	const List& list = args.next<List>();
+	args.check(list.length() > 0, "Cannot find the minimum of an empty list.");
+	return VYSE_NUM(extremum_index<true>(number_values(args, list), list.length()));
+}
+
+Value argmax(VM& vm, int argc) {
+	Args args(vm, "stats.argmax", 1, argc);
+	const List& list = args.next<List>();
+	args.check(list.length() > 0, "Cannot find the maximum of an empty list.");
+	return VYSE_NUM(extremum_index<false>(number_values(args, list), list.length()));
+}
+
+/// @brief stats.histogram(xs, nbins, [lo, hi]) returns a list of `nbins` counts.
+/// The bins split [lo, hi] evenly, with `hi` itself falling into the last bin.
+/// Values outside the range are not counted. `lo` and `hi` default to the minimum
+/// and maximum of the list.
+Value histogram(VM& vm, int argc) {
+	Args args(vm, "stats.histogram", 2, argc);
+	const List& list = args.next<List>();
+	const number nbins = args.next_number();
+	args.check(nbins >= 1 && is_integer(nbins), "Number of bins must be a positive integer.");
+
+	const Value* values = number_values(args, list);
+	const size_t len = list.length();
+
+	number lo = 0, hi = 0;
+	if (args.has_next()) {
+		lo = args.next_number();
+		hi = args.next_number();
+	} else if (len > 0) {
+		lo = values[extremum_index<true>(values, len)].as.num;
+		hi = values[extremum_index<false>(values, len)].as.num;
+	}
+	args.check(lo <= hi, "Lower bound of the histogram must not exceed the upper bound.");
+
+	const size_t bins = nbins;
+	std::vector<size_t> counts(bins, 0);
+	const number width = hi - lo;
+
+	for (size_t i = 0; i < len; ++i) {
+		const number x = values[i].as.num;
+		if (!(x >= lo && x <= hi)) continue;
+		size_t bin = width == 0 ? 0 : size_t((x - lo) / width * bins);
+		if (bin >= bins) bin = bins - 1;
+		++counts[bin];
+	}
+
+	List& result = vm.make<List>(bins);
+	for (size_t i = 0; i < bins; ++i) {
+		result[i] = VYSE_NUM(counts[i]);
+	}
+
+	return VYSE_OBJECT(&result);
+}
+
+/// @brief stats.percentile(xs, p) returns the `p`th percentile (0 <= p <= 100) of the list,
+/// linearly interpolating between the two closest ranks. The list itself is left untouched.
+Value percentile(VM& vm, int argc) {
+	Args args(vm, "stats.percentile", 2, argc);
+	const List& list = args.next<List>();
+	const number p = args.next_number();
+	args.check(p >= 0 && p <= 100, "Percentile must be between 0 and 100.");
+	args.check(list.length() > 0, "Cannot compute a percentile of an empty list.");
+
+	const Value* values = number_values(args, list);
+	const size_t len = list.length();
+
+	std::vector<number> nums(len);
+	for (size_t i = 0; i < len; ++i) nums[i] = values[i].as.num;
+
+	const number rank = p / 100 * (len - 1);
+	const size_t lower = rank;
+	const number frac = rank - lower;
+
+	std::nth_element(nums.begin(), nums.begin() + lower, nums.end());
+	const number lo = nums[lower];
+	if (frac == 0) return VYSE_NUM(lo);
+
+	// The next rank is the smallest value in the partition above `lower`.
+	const number hi = *std::min_element(nums.begin() + lower + 1, nums.end());
+	return VYSE_NUM(lo + (hi - lo) * frac);
+}
+
+static constexpr std::pair<const char*, NativeFn> funcs[] = {
+	{"sum", sum},		{"mean", mean},			  {"variance", variance},
+	{"stdev", stdev},	{"min", min},			  {"max", max},
+	{"argmin", argmin}, {"argmax", argmax},		  {"histogram", histogram},
+	{"percentile", percentile},
+};
+
+VYSE_API void load_stats(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule stats(vm, module);
+	stats.add_cclosures(funcs, array_size(funcs));
+}
+
+} // namespace vy::stdlib::stats
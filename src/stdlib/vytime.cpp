@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <stdlib/native_modules.hpp>
+#include <table.hpp>
+#include <thread>
+#include <util/auxlib.hpp>
+#include <util/lib_util.hpp>
+#include <vector>
+#include <vm.hpp>
+
+using namespace vy;
+using namespace vy::util;
+
+namespace vy::stdlib::time {
+
+using MonotonicClock = std::chrono::steady_clock;
+using WallClock = std::chrono::system_clock;
+
+/// @brief Nanoseconds elapsed on the monotonic clock. On POSIX systems this
+/// is backed by `clock_gettime(CLOCK_MONOTONIC)`.
+static s64 monotonic_ns() noexcept {
+	const auto since_epoch = MonotonicClock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+}
+
+/// @brief time.clock() returns a monotonic timestamp in nanoseconds. Only the
+/// difference between two timestamps is meaningful.
+Value clock(VM& vm, int argc) {
+	Args args(vm, "time.clock", 0, argc);
+	return VYSE_NUM(monotonic_ns());
+}
+
+/// @brief time.now() returns the wall clock time in seconds since the Unix epoch.
+Value now(VM& vm, int argc) {
+	Args args(vm, "time.now", 0, argc);
+	const auto since_epoch = WallClock::now().time_since_epoch();
+	return VYSE_NUM(std::chrono::duration<number>(since_epoch).count());
+}
+
+/// @brief time.sleep(seconds) blocks the current thread for at least `seconds` seconds.
+Value sleep(VM& vm, int argc) {
+	Args args(vm, "time.sleep", 1, argc);
+	const number seconds = args.next_number();
+	args.check(seconds >= 0, "Cannot sleep for a negative duration.");
+	std::this_thread::sleep_for(std::chrono::duration<number>(seconds));
+	return VYSE_NIL;
+}
+
+/// @brief time.bench(fn, n) calls `fn` with no arguments `n` times and returns a table
+/// with the `min`, `median`, `p99`, `mean` and `total` running time of a call in nanoseconds.
+Value bench(VM& vm, int argc) {
+	Args args(vm, "time.bench", 2, argc);
+	const Value func = args.next_arg();
+	const number n = args.next_number();
+	args.check(VYSE_IS_CLOSURE(func) or VYSE_IS_CCLOSURE(func),
+			   "Bad arg #1. Expected a function to benchmark.");
+	args.check(n >= 1 && is_integer(n), "Number of runs must be a positive integer.");
+
+	const size_t runs = n;
+	std::vector<s64> samples(runs);
+	s64 total = 0;
+
+	vm.ensure_slots(1);
+	for (size_t i = 0; i < runs; ++i) {
+		vm.m_stack.push(func);
+		const s64 start = monotonic_ns();
+		const bool ok = vm.call(0);
+		const s64 elapsed = monotonic_ns() - start;
+		if (!ok) return VYSE_NIL;
+		vm.m_stack.pop();
+
+		samples[i] = elapsed;
+		total += elapsed;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	const auto rank = [&](number p) { return samples[size_t(p * (runs - 1))]; };
+
+	Table& result = vm.make<Table>();
+	GCLock lock = vm.gc_lock(&result);
+
+	const auto set = [&](const char* key, number value) {
+		String& skey = vm.make_string(key);
+		result.set(VYSE_OBJECT(&skey), VYSE_NUM(value));
+	};
+
+	set("min", samples[0]);
+	set("median", rank(0.5));
+	set("p99", rank(0.99));
+	set("mean", number(total) / runs);
+	set("total", total);
+	set("runs", runs);
+
+	return VYSE_OBJECT(&result);
+}
+
+static constexpr std::pair<const char*, NativeFn> funcs[] = {
+	{"clock", clock}, {"now", now}, {"sleep", sleep}, {"bench", bench}};
+
+VYSE_API void load_time(VM* vm, Table* module) {
+	assert(vm != nullptr and module != nullptr);
+	NativeModule time(vm, module);
+	time.add_cclosures(funcs, array_size(funcs));
+}
+
+} // namespace vy::stdlib::time
@@ -0,0 +1,65 @@
+#include <string_set.hpp>
+
+namespace vy {
+
+StringSet::~StringSet() {
+	delete[] m_slots;
+}
+
+String* StringSet::find(const char* chars, size_t length, size_t hash) const {
+	VYSE_ASSERT(chars != nullptr, "key string is null.");
+	VYSE_ASSERT(hash == hash_cstring(chars, length), "Incorrect cstring hash.");
+	if (m_length == 0) return nullptr;
+
+	const size_t mask = m_cap - 1;
+	for (size_t index = hash & mask;; index = (index + 1) & mask) {
+		const Slot& slot = m_slots[index];
+		// we have hit an empty slot, meaning there is no such string in the set.
+		if (slot.string == nullptr) return nullptr;
+		if (slot.hash != hash or slot.string->len() != length) continue;
+		if (std::memcmp(slot.string->c_str(), chars, length) == 0) return slot.string;
+	}
+}
+
+void StringSet::insert(String* string) {
+	VYSE_ASSERT(find(string->c_str(), string->len(), string->hash()) == nullptr,
+				"String is already interned.");
+
+	if (m_length + 1 > m_cap * LoadFactor) {
+		resize(m_cap == 0 ? MinCapacity : m_cap * 2);
+	}
+
+	const size_t mask = m_cap - 1;
+	size_t index = string->hash() & mask;
+	while (m_slots[index].string != nullptr) index = (index + 1) & mask;
+	m_slots[index] = {string, string->hash()};
+	++m_length;
+}
+
+size_t StringSet::capacity_for(size_t length) {
+	if (length == 0) return 0;
+	size_t cap = MinCapacity;
+	while (length * 2 > cap * LoadFactor) cap *= 2;
+	return cap;
+}
+
+void StringSet::resize(size_t new_cap) {
+	Slot* const old_slots = m_slots;
+	const size_t old_cap = m_cap;
+
+	m_cap = new_cap;
+	m_slots = new_cap == 0 ? nullptr : new Slot[new_cap];
+
+	const size_t mask = m_cap - 1;
+	for (size_t i = 0; i < old_cap; ++i) {
+		const Slot& slot = old_slots[i];
+		if (slot.string == nullptr) continue;
+		size_t index = slot.hash & mask;
+		while (m_slots[index].string != nullptr) index = (index + 1) & mask;
+		m_slots[index] = slot;
+	}
+
+	delete[] old_slots;
+}
+
+} // namespace vy
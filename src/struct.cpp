@@ -0,0 +1,26 @@
+#include <gc.hpp>
+#include <new>
+#include <struct.hpp>
+
+namespace vy {
+
+void StructType::trace(GC& gc) {
+	gc.mark(m_name);
+	for (String* field : m_fields) gc.mark(field);
+}
+
+Struct* Struct::make(StructType& type) {
+	void* const memory = ::operator new(sizeof(Struct) + type.num_fields() * sizeof(Value));
+	Struct* const instance = new (memory) Struct(type);
+	Value* const fields = instance->fields();
+	for (u32 i = 0; i < instance->m_num_fields; ++i) fields[i] = VYSE_NIL;
+	return instance;
+}
+
+void Struct::trace(GC& gc) {
+	gc.mark(m_type);
+	Value* const values = fields();
+	for (u32 i = 0; i < m_num_fields; ++i) gc.mark(values[i]);
+}
+
+} // namespace vy
@@ -1,19 +1,49 @@
 #include <block.hpp>
 #include <common.hpp>
+#include <algorithm>
 #include <value.hpp>
 
 namespace vy {
 
 size_t Block::add_instruction(Opcode i, u32 line) {
+	if (lines.empty() or lines.back().line != line) lines.push_back({u32(code.size()), line});
 	code.push_back(i);
-	lines.push_back(line);
 	return code.size() - 1;
 }
 
 size_t Block::add_num(u8 i, u32 line) {
-	code.emplace_back(static_cast<Opcode>(i));
-	lines.push_back(line);
-	return code.size() - 1;
+	return add_instruction(static_cast<Opcode>(i), line);
+}
+
+u32 Block::line_at(size_t index) const {
+	VYSE_ASSERT(index < code.size(), "Opcode index out of range.");
+	// Find the last run that starts at or before [index].
+	const auto run = std::upper_bound(lines.begin(), lines.end(), index,
+									  [](size_t i, const LineRun& r) { return i < r.start; });
+	VYSE_ASSERT(run != lines.begin(), "Block has no line information.");
+	return (run - 1)->line;
+}
+
+void Block::remove(size_t index, size_t count) {
+	code.erase(code.begin() + index, code.begin() + index + count);
+
+	// Runs that started inside the removed code now start at [index], and the ones after it move
+	// back by [count]. Of the runs that end up sharing a start, only the last one covers any code.
+	std::vector<LineRun> runs;
+	runs.reserve(lines.size());
+	for (LineRun run : lines) {
+		if (run.start >= index + count) {
+			run.start -= count;
+		} else if (run.start > index) {
+			run.start = index;
+		}
+
+		if (run.start >= code.size()) continue;
+		if (!runs.empty() and runs.back().start == run.start) runs.pop_back();
+		if (!runs.empty() and runs.back().line == run.line) continue;
+		runs.push_back(run);
+	}
+	lines = std::move(runs);
 }
 
 size_t Block::add_value(Value value) {
@@ -2,9 +2,14 @@
 #include "common.hpp"
 #include "debug.hpp"
 #include "source.hpp"
+#include <algorithm>
 #include <compiler.hpp>
 #include <cstring>
+#include <list.hpp>
 #include <string>
+#include <string_view>
+#include <struct.hpp>
+#include <unordered_set>
 #include <vm.hpp>
 
 #define TOK2NUM(t) VYSE_NUM(std::stod(t.raw(m_source->code)))
@@ -16,8 +21,11 @@
 		next_fn();                                                                                 \
 		while (cond) {                                                                             \
 			const Token op_token = token;                                                          \
+			std::vector<u32> lhs_deps;                                                             \
+			const bool lhs_is_number = number_expr(lhs_deps);                                      \
 			next_fn();                                                                             \
-			emit(toktype_to_op(op_token.type), op_token);                                          \
+			emit_binary_op(toktype_to_op(op_token.type), op_token,                                 \
+						   lhs_is_number ? &lhs_deps : nullptr);                                   \
 		}                                                                                          \
 	}
 
@@ -55,6 +63,22 @@ Compiler::Compiler(VM* vm, Compiler* parent, String* name) : m_vm{vm}, m_parent{
 	peek = parent->peek;
 }
 
+Compiler::Compiler(VM* vm, CodeBlock& code) : m_vm{vm}, m_codeblock{&code} {
+	VYSE_ASSERT(code.is_lazy(), "Code block has already been compiled.");
+	const LazyBody& lazy = *code.m_lazy;
+	m_source = &lazy.source;
+	m_scanner = new Scanner{m_source->code, lazy.line};
+	advance();
+
+	m_symtable.add(code.name_cstr(), code.name()->len(), false);
+	for (const LazyBody::Upvalue& upval : lazy.upvals) {
+		// The closure has already been created with these upvalues, so only the names matter now.
+		m_symtable.m_upvals[m_symtable.m_num_upvals++] = UpvalDesc{-1, upval.is_const, false};
+	}
+
+	vm->m_compiler = this;
+}
+
 Compiler::~Compiler() {
 	// If this is the top-level compiler then we can free the scanner assosciated with it.
 	if (m_parent == nullptr) {
@@ -68,6 +92,7 @@ CodeBlock* Compiler::compile() {
 	}
 
 	emit(Op::load_nil, Op::return_val);
+	settle_number_types();
 	m_codeblock->m_num_upvals = m_symtable.m_num_upvals;
 	return m_codeblock;
 }
@@ -91,11 +116,114 @@ CodeBlock* Compiler::compile_func(bool is_arrowfn) {
 		emit(Op::load_nil, Op::return_val);
 	}
 
+	settle_number_types();
 	m_codeblock->m_num_upvals = m_symtable.m_num_upvals;
 	m_vm->m_compiler = m_parent;
 	return m_codeblock;
 }
 
+bool Compiler::compile_lazy() {
+	// The parameters were counted when the function was scanned.
+	m_codeblock->m_num_params = 0;
+	if (param_list(m_codeblock->m_lazy->is_method, false)) compile_func();
+	if (has_error) {
+		// Compile again, and report the same error, if the function is called again.
+		m_codeblock->m_block = Block{};
+		m_codeblock->max_stack_size = 0;
+		return false;
+	}
+
+	m_codeblock->m_lazy.reset();
+	return true;
+}
+
+bool Compiler::param_list(bool is_method, bool is_arrow) {
+	// parentheses are optional for arrow functions
+	bool open_paren;
+	if (is_arrow) {
+		open_paren = match(TT::LParen);
+	} else {
+		expect(TT::LParen, "Expected '(' before function parameter list.");
+		open_paren = true;
+	}
+
+	uint param_count = 0;
+
+	// Methods have an implicit 'self' parameter, used to reference the object itself.
+	if (is_method) {
+		++param_count;
+		add_self_param();
+	}
+
+	m_codeblock->m_is_variadic = false;
+	if ((open_paren and !check(TT::RParen)) or
+		(is_arrow and !check(TT::Arrow) and !check(TT::RParen))) {
+		do {
+			expect(TT::Id, "Expected parameter name.");
+			const int slot = add_param(token);
+			++param_count;
+
+			if (match(TT::DotDotDot)) {
+				m_codeblock->m_is_variadic = true;
+				m_rest_slot = slot;
+				break; // variadic parameter is the last one.
+			}
+		} while (match(TT::Comma));
+	}
+
+	if (param_count > MaxFuncParams) {
+		error("Function cannot have more than 200 parameters", token);
+		return false;
+	}
+
+	if (open_paren) {
+		expect(TT::RParen, "Expected ')' after function parameters.");
+	}
+
+	if (is_arrow) {
+		expect(TT::Arrow, "Expected '->' before lambda body.");
+	}
+
+	return true;
+}
+
+void Compiler::scan_func_body(LazyBody& lazy) {
+	expect(TT::LCurlBrace, "Expected '{' before function body.");
+
+	// Names that have already been looked up.
+	std::unordered_set<std::string_view> seen;
+	int depth = 1;
+	while (depth > 0 and !eof()) {
+		advance();
+		switch (token.type) {
+		case TT::LCurlBrace: ++depth; break;
+		case TT::RCurlBrace: --depth; break;
+		case TT::Id: {
+			// Without compiling the body it's not known which names are it's own locals, so any
+			// name that isn't a parameter or a field is captured. Capturing a variable that the
+			// body shadows is harmless.
+			if (prev.type == TT::Dot) break;
+			const std::string_view name{token.raw_cstr(m_source->code), token.length()};
+			if (!seen.insert(name).second or find_local_var(token) != -1) break;
+
+			const int num_upvals = m_symtable.m_num_upvals;
+			const int index = find_upvalue(token);
+			if (index == num_upvals) {
+				if (num_upvals == MaxUpValues) {
+					ERROR("Too many variables captured by function.");
+					return;
+				}
+				lazy.upvals.push_back({std::string(name), m_symtable.m_upvals[index].is_const});
+			}
+			break;
+		}
+		default: break;
+		}
+	}
+
+	if (depth > 0) ERROR("Expected '}' after function body.");
+}
+
 // top level statements are one of:
 // - var declaration
 // - function declaration
@@ -121,6 +249,8 @@ void Compiler::toplevel() {
 	case TT::Return:     ret_stmt();      break;
 	case TT::Break:      break_stmt();    break;
 	case TT::Continue:   continue_stmt(); break;
+	case TT::Match:      match_stmt();    break;
+	case TT::Struct:     struct_decl();   break;
 	default:             expr_stmt();     break;
 	}
 	// clang-format on
@@ -142,7 +272,12 @@ void Compiler::declarator(bool is_const) {
 
 	// default value for variables is 'nil'.
 	match(TT::Eq) ? expr() : emit(Op::load_nil, token);
-	new_variable(name, is_const);
+	const bool is_instance =
+		m_struct_value_end != 0 and m_struct_value_end == THIS_BLOCK.op_count();
+	const int slot = new_variable(name, is_const);
+	set_inline_code(slot);
+	assign_number_var(slot, true);
+	if (slot != -1 and is_instance) m_symtable.m_symbols[slot].instance_of = m_struct_value;
 }
 
 void Compiler::block_stmt() {
@@ -311,7 +446,12 @@ void Compiler::for_stmt() {
 	}
 
 	// Add the actual loop variable that is exposed to the user. (i)
-	new_variable(name);
+	// `for_prep` and `for_loop` only ever set it to a number.
+	const int slot = new_variable(name);
+	if (slot != -1) {
+		m_symtable.m_symbols[slot].number_var = m_number_vars.size();
+		m_number_vars.emplace_back();
+	}
 	const size_t prep_jump = emit_jump(Op::for_prep);
 
 	// Loop body
@@ -324,6 +464,230 @@ void Compiler::for_stmt() {
 	exit_block();
 }
 
+// A match statement compares the subject against the patterns of each arm in order, and runs the
+// statement of the first arm that has an equal pattern:
+//
+// match op {
+//   "+", "add" -> push(a + b)
+//   "-" -> push(a - b)
+//   else -> error()
+// }
+//
+// The subject is stored in a hidden local variable. Arms whose patterns are all literal numbers,
+// strings or booleans are grouped into segments, and each segment is dispatched in O(1) by a single
+// instruction placed after it's arms:
+//
+//    jmp DISPATCH
+//    <arm 1>; jmp END
+//    <arm 2>; jmp END
+//  DISPATCH:
+//    get_var <subject>
+//    jump_table|match_table <targets>
+//    ... (the next segment, or the else arm)
+//  END:
+//
+// An arm with any other pattern (like a variable or a call) ends the current segment, and tests
+// it's patterns one by one with `==` instead.
+void Compiler::match_stmt() {
+	advance(); // consume 'match'
+
+	enter_block();
+	expr();
+	const int subject = new_variable("<match>", 7);
+	expect(TT::LCurlBrace, "Expected '{' after match subject.");
+
+	// Constant patterns are kept here while an arm is being compiled, so that they don't get
+	// garbage collected.
+	List& pending = m_vm->make<List>();
+	GCLock lock = m_vm->gc_lock(&pending);
+
+	MatchSegment segment;
+	std::vector<size_t> end_jumps;
+	bool has_else = false;
+
+	while (!(eof() or check(TT::RCurlBrace) or has_error)) {
+		if (match(TT::Else)) {
+			expect(TT::Arrow, "Expected '->' after 'else'.");
+			close_segment(segment, subject);
+			match_arm_body();
+			has_else = true;
+			break;
+		}
+		match_arm(segment, subject, pending, end_jumps);
+	}
+
+	close_segment(segment, subject);
+	expect(TT::RCurlBrace, has_else ? "The 'else' arm must be the last arm of a match."
+									: "Expected '}' to close match statement.");
+
+	for (const size_t jump : end_jumps) patch_jump(jump);
+	exit_block();
+}
+
+void Compiler::match_arm(MatchSegment& segment, int subject, List& pending,
+						 std::vector<size_t>& end_jumps) {
+	// Jumps taken when the subject is equal to one of the arm's patterns.
+	std::vector<size_t> hit_jumps;
+	bool is_constant_arm = true;
+
+	// Emits `subject == pattern` for a pattern that is already on top of the stack. Every test
+	// except the last one jumps to the arm's body if it succeeds.
+	const auto emit_test = [&](bool is_last) {
+		emit(Op::eq);
+		if (!is_last) hit_jumps.push_back(emit_jump(Op::jmp_if_true_or_pop));
+	};
+
+	do {
+		if (is_constant_arm and is_constant_pattern()) {
+			advance();
+			switch (token.type) {
+			case TT::String: pending.append(VYSE_OBJECT(&string_literal(token))); break;
+			case TT::True: pending.append(VYSE_BOOL(true)); break;
+			case TT::False: pending.append(VYSE_BOOL(false)); break;
+			default: pending.append(TOK2NUM(token)); break;
+			}
+			continue;
+		}
+
+		if (is_constant_arm) {
+			// This arm can't be dispatched by a table, so it is tested sequentially after
+			// any constant arms that come before it.
+			is_constant_arm = false;
+			close_segment(segment, subject);
+			for (size_t i = 0; i < pending.length(); ++i) {
+				emit_with_arg(Op::get_var, subject);
+				emit_with_arg(Op::load_const, emit_value(pending[i]));
+				emit_test(false);
+			}
+		}
+
+		emit_with_arg(Op::get_var, subject);
+		expr();
+		emit_test(!check(TT::Comma));
+	} while (match(TT::Comma));
+
+	expect(TT::Arrow, "Expected '->' after match pattern.");
+
+	if (is_constant_arm) {
+		if (segment.targets == nullptr) {
+			Table& targets = m_vm->make<Table>();
+			segment.targets = &targets;
+			segment.const_index = emit_value(VYSE_OBJECT(&targets));
+			segment.skip_jump = emit_jump(Op::jmp);
+		}
+
+		const u32 target = THIS_BLOCK.op_count();
+		for (size_t i = 0; i < pending.length(); ++i) {
+			add_segment_pattern(segment, pending[i], target);
+		}
+
+		match_arm_body();
+		end_jumps.push_back(emit_jump(Op::jmp));
+	} else {
+		for (const size_t jump : hit_jumps) patch_jump(jump);
+		// All but the last test leave their result on the stack only when jumping here.
+		m_stack_size -= hit_jumps.size();
+		const size_t miss_jump = emit_jump(Op::pop_jmp_if_false);
+		match_arm_body();
+		end_jumps.push_back(emit_jump(Op::jmp));
+		patch_jump(miss_jump);
+	}
+
+	while (pending.length() > 0) pending.pop();
+}
+
+void Compiler::match_arm_body() {
+	enter_block();
+	toplevel();
+	exit_block();
+}
+
+bool Compiler::is_constant_pattern() {
+	switch (peek.type) {
+	case TT::Integer:
+	case TT::Float:
+	case TT::String:
+	case TT::True:
+	case TT::False: break;
+	default: return false;
+	}
+
+	// A literal can still be the start of a longer expression, like `1 + x`.
+	const TT next = m_scanner->lookahead().type;
+	return next == TT::Comma or next == TT::Arrow;
+}
+
+void Compiler::add_segment_pattern(MatchSegment& segment, Value pattern, u32 target) {
+	if (!VYSE_IS_NIL(segment.targets->get(pattern))) return;
+	segment.targets->set(pattern, VYSE_NUM(target));
+
+	if (!VYSE_IS_NUM(pattern) or !is_integer(VYSE_AS_NUM(pattern))) {
+		segment.all_integers = false;
+		return;
+	}
+
+	const number n = VYSE_AS_NUM(pattern);
+	if (segment.num_patterns == 0 or n < segment.min) segment.min = n;
+	if (segment.num_patterns == 0 or n > segment.max) segment.max = n;
+	++segment.num_patterns;
+}
+
+void Compiler::close_segment(MatchSegment& segment, int subject) {
+	if (segment.targets == nullptr) return;
+
+	patch_jump(segment.skip_jump);
+	emit_with_arg(Op::get_var, subject);
+
+	// Integer patterns that fill at least half of the range they span are dispatched by indexing
+	// a list of targets instead of hashing the subject.
+	const number span = segment.max - segment.min + 1;
+	if (segment.all_integers and span <= 2 * number(segment.num_patterns)) {
+		List& targets = m_vm->make<List>(size_t(span) + 1);
+		targets[0] = VYSE_NUM(segment.min);
+		for (size_t i = 0; i < size_t(span); ++i) {
+			targets[i + 1] = segment.targets->get(VYSE_NUM(segment.min + i));
+		}
+		THIS_BLOCK.constant_pool[segment.const_index] = VYSE_OBJECT(&targets);
+		emit_with_arg(Op::jump_table, segment.const_index);
+	} else {
+		emit_with_arg(Op::match_table, segment.const_index);
+	}
+
+	segment = MatchSegment{};
+}
+
+void Compiler::struct_decl() {
+	advance(); // consume 'struct' token.
+	expect(TT::Id, "Expected struct name.");
+
+	const Token name_token = token;
+	String* name = &m_vm->make_string(name_token.raw_cstr(m_source->code), name_token.length());
+	GCLock lock = m_vm->gc_lock(name);
+
+	// The struct is added to the constant pool before the field names are made, which keeps it
+	// and the fields that have been added to it alive.
+	StructType& type = m_vm->make<StructType>(name);
+	emit_with_arg(Op::load_const, emit_value(VYSE_OBJECT(&type)));
+
+	expect(TT::LCurlBrace, "Expected '{' after struct name.");
+	while (!has_error and !check(TT::RCurlBrace)) {
+		expect(TT::Id, "Expected field name.");
+		String* field = &m_vm->make_string(token.raw_cstr(m_source->code), token.length());
+		if (type.field_index(VYSE_OBJECT(field)) != -1) {
+			ERROR("Duplicate field '{}' in struct '{}'.", field->c_str(), name->c_str());
+		} else if (type.num_fields() >= MaxFuncParams) {
+			ERROR("Too many fields in struct '{}'.", name->c_str());
+		}
+		type.m_fields.push_back(field);
+		if (!match(TT::Comma)) break;
+	}
+	expect(TT::RCurlBrace, "Expected '}' to close struct declaration.");
+
+	const int slot = new_variable(name_token, true);
+	if (slot != -1) m_symtable.m_symbols[slot].struct_type = &type;
+	m_struct_types.push_back(&type);
+}
+
 void Compiler::fn_decl() {
 	advance(); // consume 'fn' token.
 	expect(TT::Id, "expected function name");
@@ -332,7 +696,7 @@ void Compiler::fn_decl() {
 	String* fname = &m_vm->make_string(name_token.raw_cstr(m_source->code), name_token.length());
 
 	func_expr(fname);
-	new_variable(name_token);
+	set_inline_code(new_variable(name_token));
 }
 
 // Compile the body of a function or method assuming everything excluding the
@@ -345,53 +709,33 @@ void Compiler::func_expr(String* fname, bool is_method, bool is_arrow) {
 	GCLock lock = m_vm->gc_lock(fname);
 	Compiler compiler{m_vm, this, fname};
 
-	// parentheses are optional for arrow functions
-	bool open_paren;
-	if (is_arrow) {
-		open_paren = compiler.match(TT::LParen);
-	} else {
-		compiler.expect(TT::LParen, "Expected '(' before function parameter list.");
-		open_paren = true;
-	}
-
-	uint param_count = 0;
-
-	// Methods have an implicit 'self' parameter, used to reference the object itself.
-	if (is_method) {
-		++param_count;
-		compiler.add_self_param();
-	}
-
-	bool is_vararg = false;
-	if ((open_paren and !compiler.check(TT::RParen)) or
-		(is_arrow and !compiler.check(TT::Arrow) and !compiler.check(TT::RParen))) {
-		do {
-			compiler.expect(TT::Id, "Expected parameter name.");
-			compiler.add_param(compiler.token);
-			++param_count;
-
-			if (compiler.match(TT::DotDotDot)) {
-				is_vararg = true;
-				break; // variadic parameter is the last one.
-			}
-		} while (compiler.match(TT::Comma));
-	}
-
-	if (param_count > MaxFuncParams) {
-		compiler.error("Function cannot have more than 200 parameters", compiler.token);
+	const Token params_start = peek;
+	if (!compiler.param_list(is_method, is_arrow)) {
+		has_error = true;
 		return;
 	}
 
-	if (open_paren) {
-		compiler.expect(TT::RParen, "Expected ')' after function parameters.");
-	}
-
-	if (is_arrow) {
-		compiler.expect(TT::Arrow, "Expected '->' before lambda body.");
+	// Arrow functions are usually small, so only functions with a block body are compiled lazily.
+	const bool is_lazy = m_vm->lazy_compile and !is_arrow;
+	CodeBlock* code;
+	if (is_lazy) {
+		auto lazy = std::make_unique<LazyBody>();
+		compiler.scan_func_body(*lazy);
+
+		const u32 start = params_start.location.source_pos.start;
+		const u32 end = compiler.token.location.source_pos.start + compiler.token.length();
+		lazy->source = {m_source->path, m_source->code.substr(start, end - start)};
+		lazy->line = params_start.location.line;
+		lazy->is_method = is_method;
+
+		code = compiler.m_codeblock;
+		code->m_num_upvals = compiler.m_symtable.m_num_upvals;
+		code->m_lazy = std::move(lazy);
+		m_vm->m_compiler = this;
+	} else {
+		code = compiler.compile_func(is_arrow);
 	}
 
-	CodeBlock* const code = compiler.compile_func(is_arrow);
-	code->m_is_variadic = is_vararg;
 	if (compiler.has_error) has_error = true;
 	const u8 idx = emit_value(VYSE_OBJECT(code));
 
@@ -410,6 +754,9 @@ void Compiler::func_expr(String* fname, bool is_method, bool is_arrow) {
 		emit_arg(upval.index);
 	}
 
+	m_last_func = code;
+	m_last_func_end = THIS_BLOCK.op_count();
+
 #ifdef VYSE_DEBUG_DISASSEMBLY
 	disassemble_block(code->name_cstr(), code->block());
 #endif
@@ -503,6 +850,8 @@ void Compiler::complete_expr_stmt(ExpKind prefix_type) {
 	while (true) {
 		switch (peek.type) {
 		case TT::LSqBrace: {
+			const bool is_rest = is_rest_load();
+			const size_t pack_index = THIS_BLOCK.op_count() - 2;
 			advance();
 			expr();
 			expect(TT::RSqBrace, "Expected ']' to close index expression.");
@@ -511,7 +860,11 @@ void Compiler::complete_expr_stmt(ExpKind prefix_type) {
 				emit(Op::subscript_set);
 				return;
 			} else {
-				emit(Op::subscript_get);
+				if (is_rest) {
+					rest_subscript(pack_index);
+				} else {
+					emit(Op::subscript_get);
+				}
 				exp_kind = ExpKind::prefix;
 			}
 			break;
@@ -530,8 +883,28 @@ void Compiler::complete_expr_stmt(ExpKind prefix_type) {
 		case TT::Dot: {
 			advance();
 			expect(TT::Id, "Expected field name.");
-			const u8 index = emit_id_string(token);
 
+			StructType* type = nullptr;
+			const int slot = struct_field(token, type);
+			if (slot != -1) {
+				if (is_assign_tok(peek.type)) {
+					advance();
+					const TT ttype = token.type;
+					if (ttype != TT::Eq) {
+						emit_with_arg(Op::peek, 1);
+						emit_struct_op(Op::struct_get, *type, slot);
+					}
+					expr();
+					if (ttype != TT::Eq) emit(toktype_to_op(ttype));
+					emit_struct_op(Op::struct_set, *type, slot);
+					return;
+				}
+				emit_struct_op(Op::struct_get, *type, slot);
+				exp_kind = ExpKind::prefix;
+				break;
+			}
+
+			const u8 index = emit_id_string(token);
 			if (is_assign_tok(peek.type)) {
 				table_assign(Op::table_get_no_pop, index);
 				emit_with_arg(Op::table_set, index);
@@ -539,6 +912,8 @@ void Compiler::complete_expr_stmt(ExpKind prefix_type) {
 			} else {
 				exp_kind = ExpKind::prefix;
 				emit_with_arg(Op::table_get, index);
+				m_field_get_name = index;
+				m_field_get_end = THIS_BLOCK.op_count();
 			}
 			break;
 		}
@@ -547,8 +922,7 @@ void Compiler::complete_expr_stmt(ExpKind prefix_type) {
 			advance();
 			expect(TT::Id, "Expected method name.");
 			const u8 index = emit_id_string(token);
-			emit_with_arg(Op::prep_method_call, index);
-			compile_args(true);
+			compile_args(true, index);
 			exp_kind = ExpKind::call;
 			break;
 		}
@@ -657,10 +1031,18 @@ void Compiler::unary() {
 		advance();
 		const Token op_token = token;
 		unary();
+		std::vector<u32> deps;
+		const bool is_number = number_expr(deps);
 		switch (op_token.type) {
 		case TT::Bang: emit(Op::lnot, op_token); break;
-		case TT::Minus: emit(Op::negate, op_token); break;
-		case TT::Len: emit(Op::len, op_token); break;
+		case TT::Minus:
+			emit(Op::negate, op_token);
+			if (is_number) mark_number(std::move(deps));
+			break;
+		case TT::Len:
+			if (!replace_rest_load(Op::vararg_len)) emit(Op::len, op_token);
+			mark_number({});
+			break;
 		case TT::BitNot: emit(Op::bnot, op_token); break;
 		default: VYSE_ERROR("Impossible unary token."); break;
 		}
@@ -678,26 +1060,40 @@ void Compiler::suffix_expr() {
 	while (true) {
 		switch (peek.type) {
 		case TT::LSqBrace: {
+			const bool is_rest = is_rest_load();
+			const size_t pack_index = THIS_BLOCK.op_count() - 2;
 			advance();
 			expr();
 			expect(TT::RSqBrace, "Expected ']' to close index expression.");
-			emit(Op::subscript_get);
+			if (is_rest) {
+				rest_subscript(pack_index);
+			} else {
+				emit(Op::subscript_get);
+			}
 			break;
 		}
 		case TT::LParen: compile_args(); break;
 		case TT::Dot: {
 			advance();
 			expect(TT::Id, "Expected field name.");
+			StructType* type = nullptr;
+			const int slot = struct_field(token, type);
+			if (slot != -1) {
+				emit_struct_op(Op::struct_get, *type, slot);
+				break;
+			}
+
 			const u8 index = emit_id_string(token);
 			emit_with_arg(Op::table_get, index);
+			m_field_get_name = index;
+			m_field_get_end = THIS_BLOCK.op_count();
 			break;
 		}
 		case TT::Colon: {
 			advance();
 			expect(TT::Id, "Expected method name.");
-			u8 index = emit_id_string(token);
-			emit_with_arg(Op::prep_method_call, index);
-			compile_args(true);
+			const u8 index = emit_id_string(token);
+			compile_args(true, index);
 			break;
 		}
 		default: return;
@@ -724,27 +1120,74 @@ void Compiler::table_assign(Op get_op, int idx) {
 	/// 'set' opcode to store it back into the table/array. The 'set' opcode is emitted by the
 	/// caller.
 	emit(get_op);
-	if (idx > 0) emit_arg(idx);
+	if (idx >= 0) emit_arg(idx);
 	expr();
 	emit(toktype_to_op(ttype));
 }
 
-void Compiler::compile_args(bool is_method) {
+void Compiler::compile_args(bool is_method, u8 method_name) {
+	// A call to an inlinable function that was loaded right before the '(' is inlined.
+	const bool can_inline = !is_method and m_inline_callee_end != 0 and
+							m_inline_callee_end == THIS_BLOCK.op_count();
+	CodeBlock* const inline_callee = can_inline ? m_inline_callee : nullptr;
+	// A call to a struct returns an instance of it.
+	StructType* const struct_callee =
+		(!is_method and m_struct_callee_end != 0 and m_struct_callee_end == THIS_BLOCK.op_count())
+			? m_struct_callee
+			: nullptr;
+	// So is a call to a field that may hold an intrinsic, like `math.sqrt(x)`.
+	const Intrinsic field_intrinsic =
+		(!is_method and m_field_get_end != 0 and m_field_get_end == THIS_BLOCK.op_count())
+			? find_intrinsic(m_field_get_name, false)
+			: Intrinsic::none;
+
 	advance(); // eat opening '('
 
 	// If it's a method call, then start with 1 argument count for the implicit 'self' argument.
 	u32 argc = is_method ? 1 : 0;
+	bool is_spread = false;
 
 	if (!check(TT::RParen)) {
 		do {
 			++argc;
 			if (argc > MaxFuncParams) ERROR("Too many arguments to function call.");
 			expr(); // push the arguments on the stack,
+
+			// `f(a, rest...)` passes the varargs of the current function along, the number of
+			// which is only known at runtime.
+			if (match(TT::DotDotDot)) {
+				if (!replace_rest_load(Op::vararg_spread)) {
+					ERROR("Only a variadic parameter can be spread into a call.");
+				}
+				if (!check(TT::RParen)) ERROR("Spread argument must be the last argument.");
+				is_spread = true;
+				--argc;
+				break;
+			}
 		} while (match(TT::Comma));
 	}
 
 	expect(TT::RParen, "Expected ')' after call.");
-	emit_with_arg(Op::call_func, argc);
+	const Intrinsic method_intrinsic =
+		(is_method and !is_spread and argc == 1) ? find_intrinsic(method_name, true)
+												 : Intrinsic::none;
+	if (method_intrinsic != Intrinsic::none) {
+		emit_with_arg(Op::invoke_intrinsic, method_name);
+		emit_arg(static_cast<u8>(method_intrinsic));
+	} else if (is_method) {
+		emit_with_arg(is_spread ? Op::invoke_spread : Op::invoke, method_name);
+		emit_arg(argc);
+	} else if (inline_callee and !is_spread and argc == inline_callee->param_count()) {
+		emit_inline_call(*inline_callee, argc);
+	} else if (field_intrinsic != Intrinsic::none and !is_spread and argc == 1) {
+		emit_with_arg(Op::call_intrinsic, static_cast<u8>(field_intrinsic));
+	} else {
+		emit_with_arg(is_spread ? Op::call_spread : Op::call_func, argc);
+		if (struct_callee) {
+			m_struct_value = struct_callee;
+			m_struct_value_end = THIS_BLOCK.op_count();
+		}
+	}
 }
 
 void Compiler::grouping() {
@@ -783,24 +1226,68 @@ void Compiler::primary() {
 }
 
 void Compiler::table() {
-	emit(Opcode::new_table);
+	// Fields with identifier keys are not inserted one by one. Instead, their values are left on
+	// the stack, and the keys are added to a shape: a constant table that maps each key to the
+	// position of it's value. `table_from_shape` then creates the table from the shape in one go.
+	// A computed key, a repeated key or a large number of fields ends the shape, after which the
+	// remaining fields are added to the table with `table_add_field`.
+	Table* shape = nullptr;
+	u32 shape_idx = 0;
+	u32 num_shape_fields = 0;
+	bool table_created = false;
+
+	// Index of the size hint of the `new_table` instruction, if one was emitted.
+	size_t size_hint_index = 0;
+	u32 num_fields = 0;
+
+	const auto create_table = [&] {
+		if (table_created) return;
+		table_created = true;
+		if (shape != nullptr) {
+			emit_with_arg(Op::table_from_shape, shape_idx);
+			m_stack_size -= num_shape_fields;
+		} else {
+			emit_with_arg(Op::new_table, 0);
+			size_hint_index = THIS_BLOCK.op_count() - 1;
+		}
+	};
 
 	// empty table.
-	if (match(TT::RCurlBrace)) return;
+	if (match(TT::RCurlBrace)) {
+		create_table();
+		return;
+	}
 
 	do {
+		++num_fields;
 		if (match(TT::LSqBrace)) {
 			/// a computed table key like in { [1 + 2]: 3 }
+			create_table();
 			expr();
 			expect(TT::RSqBrace, "Expected ']' near table key.");
 		} else {
 			expect(TT::Id, "Expected identifier as table key.");
+			if (!table_created and shape == nullptr) {
+				shape = &m_vm->make<Table>();
+				shape_idx = emit_value(VYSE_OBJECT(shape));
+			}
+
 			String* key_string = &m_vm->make_string(token.raw_cstr(m_source->code), token.length());
-			const int key_idx = emit_value(VYSE_OBJECT(key_string));
-			emit_with_arg(Op::load_const, key_idx);
+			const Value key = VYSE_OBJECT(key_string);
+			if (!table_created and
+				(num_shape_fields == LiteralChunkSize or !VYSE_IS_NIL(shape->get(key)))) {
+				create_table();
+			}
+
+			if (table_created) {
+				emit_with_arg(Op::load_const, emit_value(key));
+			} else {
+				shape->set(key, VYSE_NUM(num_shape_fields++));
+			}
+
 			if (check(TT::LParen)) {
 				func_expr(key_string, true); // is_method = true, is_arrow = false
-				emit(Op::table_add_field);
+				if (table_created) emit(Op::table_add_field);
 				if (check(TT::RCurlBrace)) break;
 				continue;
 			}
@@ -808,11 +1295,16 @@ void Compiler::table() {
 
 		expect(TT::Colon, "Expected ':' after table key.");
 		expr();
-		emit(Op::table_add_field);
+		if (table_created) emit(Op::table_add_field);
 
 		if (check(TT::RCurlBrace)) break;
 	} while (!eof() and match(TT::Comma));
 
+	create_table();
+	if (size_hint_index != 0) {
+		THIS_BLOCK.code[size_hint_index] = Op(std::min(num_fields, u32(UINT8_MAX)));
+	}
+
 	if (eof()) {
 		error("Reached end of file while compiling.", token);
 		return;
@@ -822,14 +1314,28 @@ void Compiler::table() {
 }
 
 void Compiler::array() {
-	emit(Op::new_list);
+	emit_with_arg(Op::new_list, 0);
+	const size_t size_hint_index = THIS_BLOCK.op_count() - 1;
 	if (match(TT::RSqBrace)) return; // empty array.
+
+	u32 num_items = 0;
+	u8 num_pending = 0;
+	const auto flush = [&] {
+		emit_with_arg(Op::list_append_n, num_pending);
+		m_stack_size -= num_pending;
+		num_pending = 0;
+	};
+
 	do {
 		expr();
-		emit(Op::list_append);
+		++num_items;
+		if (++num_pending == LiteralChunkSize) flush();
 		if (check(TT::RSqBrace)) break;
 		expect(TT::Comma, "Expected a ',' to separate array entry");
 	} while (!eof());
+
+	if (num_pending > 0) flush();
+	THIS_BLOCK.code[size_hint_index] = Op(std::min(num_items, u32(UINT8_MAX)));
 	expect(TT::RSqBrace, "Expected a ']' to close array or ',' to separate entry.");
 }
 
@@ -856,6 +1362,8 @@ void Compiler::variable(bool can_assign) {
 		}
 	}
 
+	const bool is_rest = get_op == Op::get_var and index == m_rest_slot;
+
 	if (can_assign) {
 		VYSE_ASSERT(is_assign_tok(peek.type), "Not in an assignment context.");
 		if (is_const) {
@@ -864,13 +1372,53 @@ void Compiler::variable(bool can_assign) {
 			error(message.c_str(), token);
 		}
 
+		// Once the variadic parameter is reassigned, it's slot can no longer tell whether the
+		// varargs are still on the stack.
+		if (is_rest) m_codeblock->m_collects_varargs = true;
+
 		/// Compile the RHS of the assignment, and any necessary arithmetic ops if its a compound
 		/// assignment operator. So by the time we are setting the value, the RHS is sitting ready
 		/// on top of the stack.
 		var_assign(get_op, index);
+		if (get_op == Op::get_var) assign_number_var(index, false);
+		if (set_op == Op::set_upval) m_codeblock->m_assigns_upvals = true;
 		emit_with_arg(set_op, index);
+	} else if (is_rest) {
+		emit_with_arg(Op::vararg_pack, index);
+		m_rest_load_end = THIS_BLOCK.op_count();
 	} else {
 		emit_with_arg(get_op, index);
+		if (get_op == Op::get_var) read_number_var(index);
+
+		CodeBlock* inline_code = nullptr;
+		StructType* struct_type = nullptr;
+		StructType* instance_of = nullptr;
+		if (get_op == Op::get_var) {
+			const LocalVar& local = m_symtable.m_symbols[index];
+			inline_code = local.inline_code;
+			struct_type = local.struct_type;
+			instance_of = local.instance_of;
+		} else if (get_op == Op::get_upval) {
+			const UpvalDesc& upval = m_symtable.m_upvals[index];
+			inline_code = upval.inline_code;
+			struct_type = upval.struct_type;
+			instance_of = upval.instance_of;
+		}
+
+		if (inline_code) {
+			m_inline_callee = inline_code;
+			m_inline_callee_end = THIS_BLOCK.op_count();
+		}
+
+		if (struct_type) {
+			m_struct_callee = struct_type;
+			m_struct_callee_end = THIS_BLOCK.op_count();
+		}
+
+		if (instance_of) {
+			m_struct_value = instance_of;
+			m_struct_value_end = THIS_BLOCK.op_count();
+		}
 	}
 }
 
@@ -884,8 +1432,18 @@ void Compiler::var_assign(Op get_op, u32 idx_or_name_str) {
 	}
 
 	emit_with_arg(get_op, idx_or_name_str);
+	std::vector<u32> lhs_deps;
+	bool lhs_is_number = false;
+	if (get_op == Op::get_var) {
+		read_number_var(idx_or_name_str);
+		lhs_is_number = number_expr(lhs_deps);
+	}
+
 	expr();
-	emit(toktype_to_op(ttype));
+	const Op op = toktype_to_op(ttype);
+	emit_binary_op(op, token, lhs_is_number ? &lhs_deps : nullptr);
+	// emit_binary_op doesn't count the stack effect of [op].
+	m_stack_size += op_stack_effect(op);
 }
 
 void Compiler::literal() {
@@ -913,6 +1471,7 @@ void Compiler::literal() {
 	/// TODO: handle indices larger than UINT8_MAX, by adding a load_const_long instruction that
 	/// takes 2 operands.
 	emit_with_arg(Op::load_const, static_cast<u8>(index));
+	if (token.type == TT::Integer or token.type == TT::Float) mark_number({});
 }
 
 void Compiler::goto_eof() {
@@ -963,6 +1522,14 @@ void Compiler::patch_jump(size_t index) {
 	// and joins them together using some bit operators.
 	THIS_BLOCK.code[index] = static_cast<Op>((jump_dist >> 8) & 0xff);
 	THIS_BLOCK.code[index + 1] = static_cast<Op>(jump_dist & 0xff);
+
+	// Code jumping to here may skip over the last instruction emitted, which therefore
+	// no longer makes up the entire expression before this point.
+	m_rest_load_end = 0;
+	m_inline_callee_end = 0;
+	m_last_func_end = 0;
+	m_field_get_end = 0;
+	m_number_end = 0;
 }
 
 void Compiler::patch_backwards_jump(size_t index, u32 dst_index) {
@@ -975,9 +1542,348 @@ void Compiler::patch_backwards_jump(size_t index, u32 dst_index) {
 	THIS_BLOCK.code[index + 1] = static_cast<Op>(distance & 0xff);
 }
 
-void Compiler::add_param(const Token& token) {
-	new_variable(token);
+int Compiler::add_param(const Token& token) {
+	const int slot = new_variable(token);
 	m_codeblock->add_param();
+	return slot;
+}
+
+bool Compiler::is_rest_load() const noexcept {
+	return m_rest_load_end != 0 and m_rest_load_end == THIS_BLOCK.op_count();
+}
+
+bool Compiler::replace_rest_load(Op op) {
+	if (!is_rest_load()) return false;
+	THIS_BLOCK.code[m_rest_load_end - 2] = op;
+	m_rest_load_end = 0;
+	return true;
+}
+
+size_t Compiler::inline_body_size(const CodeBlock& code) {
+	if (code.is_lazy() or code.is_vararg() or code.m_num_upvals != 0) return 0;
+
+	const std::vector<Op>& ops = code.block().code;
+	size_t max_jump_target = 0;
+	for (size_t i = 0; i < ops.size() and i <= MaxInlineSize;) {
+		switch (ops[i]) {
+		case Op::return_val: {
+			// The returned expression may only be followed by the implicit 'return nil'.
+			const size_t num_remaining = ops.size() - i - 1;
+			const bool has_implicit_return = num_remaining == 2 and ops[i + 1] == Op::load_nil and
+											 ops[i + 2] == Op::return_val;
+			if (max_jump_target > i) return 0;
+			return (num_remaining == 0 or has_implicit_return) ? i : 0;
+		}
+
+		case Op::get_var: {
+			// Only the parameters can be read, which are in slots 1 to `param_count()`.
+			const u8 slot = u8(ops[i + 1]);
+			if (slot == 0 or slot > code.param_count()) return 0;
+			i += 2;
+			break;
+		}
+
+		case Op::load_const:
+		case Op::get_global:
+		case Op::table_get: i += 2; break;
+
+		case Op::jmp_if_false_or_pop:
+		case Op::jmp_if_true_or_pop: {
+			const size_t distance = (size_t(ops[i + 1]) << 8) | size_t(ops[i + 2]);
+			i += 3;
+			max_jump_target = std::max(max_jump_target, i + distance);
+			break;
+		}
+
+		case Op::load_nil:
+		case Op::add:
+		case Op::concat:
+		case Op::sub:
+		case Op::mult:
+		case Op::mod:
+		case Op::div:
+		case Op::exp:
+		case Op::eq:
+		case Op::neq:
+		case Op::lshift:
+		case Op::rshift:
+		case Op::band:
+		case Op::bxor:
+		case Op::bor:
+		case Op::gt:
+		case Op::lt:
+		case Op::gte:
+		case Op::lte:
+		case Op::negate:
+		case Op::len:
+		case Op::bnot:
+		case Op::lnot:
+		case Op::subscript_get: i += 1; break;
+
+		default: return 0;
+		}
+	}
+
+	return 0;
+}
+
+void Compiler::set_inline_code(int slot) {
+	if (slot < 0 or m_last_func_end == 0 or m_last_func_end != THIS_BLOCK.op_count()) return;
+	if (inline_body_size(*m_last_func) != 0) {
+		m_symtable.m_symbols[slot].inline_code = m_last_func;
+	}
+}
+
+Intrinsic Compiler::find_intrinsic(u8 name_index, bool is_method) const {
+	struct IntrinsicName {
+		const char* name;
+		Intrinsic id;
+	};
+
+	static constexpr IntrinsicName field_intrinsics[] = {
+		{"sqrt", Intrinsic::sqrt}, {"floor", Intrinsic::floor}, {"ceil", Intrinsic::ceil},
+		{"abs", Intrinsic::abs},   {"sin", Intrinsic::sin},		{"cos", Intrinsic::cos},
+	};
+
+	static constexpr IntrinsicName method_intrinsics[] = {{"pop", Intrinsic::list_pop}};
+
+	const Value name = THIS_BLOCK.constant_pool[name_index];
+	VYSE_ASSERT(VYSE_IS_STRING(name), "field name not a string.");
+	const char* const name_str = VYSE_AS_CSTRING(name);
+
+	if (is_method) {
+		for (const auto& [iname, id] : method_intrinsics) {
+			if (std::strcmp(name_str, iname) == 0) return id;
+		}
+	} else {
+		for (const auto& [iname, id] : field_intrinsics) {
+			if (std::strcmp(name_str, iname) == 0) return id;
+		}
+	}
+
+	return Intrinsic::none;
+}
+
+void Compiler::emit_inline_call(CodeBlock& callee, u32 argc) {
+	const size_t body_size = inline_body_size(callee);
+	VYSE_ASSERT(body_size != 0, "Bad call to Compiler::emit_inline_call");
+
+	// [callee, args...] are on the stack. If the callee turns out to be some other function at
+	// runtime, then the guard calls it and returns to the jump over the inlined body.
+	emit_with_arg(Op::inline_guard, emit_value(VYSE_OBJECT(&callee)));
+	emit_arg(argc);
+	const size_t skip_jump = emit_jump(Op::jmp);
+
+	// The copied instructions are the same size as the originals, so the jumps inside the body
+	// don't need to be adjusted.
+	const Block& body = callee.block();
+	int depth = 0; // number of values pushed by the inlined body so far.
+	for (size_t i = 0; i < body_size;) {
+		const Op op = body.code[i];
+		switch (op) {
+		case Op::get_var: {
+			// A parameter is read from the arguments, which are below the values pushed so far.
+			const u32 param = u8(body.code[i + 1]);
+			emit_with_arg(Op::peek, argc - param + 1 + depth);
+			i += 2;
+			break;
+		}
+
+		case Op::load_const:
+		case Op::get_global:
+		case Op::table_get: {
+			const Value constant = body.constant_pool[u8(body.code[i + 1])];
+			emit_with_arg(op, emit_value(constant));
+			i += 2;
+			break;
+		}
+
+		case Op::jmp_if_false_or_pop:
+		case Op::jmp_if_true_or_pop: {
+			emit(op);
+			emit_arg(u8(body.code[i + 1]));
+			emit_arg(u8(body.code[i + 2]));
+			// Execution continues past the jump only after popping the condition.
+			--depth;
+			i += 3;
+			break;
+		}
+
+		default: emit(op); i += 1;
+		}
+
+		depth += op_stack_effect(op);
+	}
+
+	emit_with_arg(Op::inline_return, argc + 1);
+	m_stack_size -= argc + 1;
+	patch_jump(skip_jump);
+}
+
+void Compiler::rest_subscript(size_t pack_index) {
+	VYSE_ASSERT(THIS_BLOCK.code[pack_index] == Op::vararg_pack, "Bad call to rest_subscript");
+	const u8 slot = u8(THIS_BLOCK.code[pack_index + 1]);
+	THIS_BLOCK.remove(pack_index, 2);
+	--m_stack_size; // for the removed vararg_pack.
+	for (UncheckedOp& op : m_unchecked_ops) {
+		if (op.index > pack_index) op.index -= 2;
+	}
+
+	// The markers set while compiling the index expression no longer line up with the code.
+	m_rest_load_end = 0;
+	m_inline_callee_end = 0;
+	m_field_get_end = 0;
+	m_number_end = 0;
+	emit_with_arg(Op::vararg_get, slot);
+}
+
+int Compiler::struct_field(const Token& name, StructType*& type) {
+	String& field = m_vm->make_string(name.raw_cstr(m_source->code), name.length());
+	const Value key = VYSE_OBJECT(&field);
+
+	if (m_struct_value_end != 0 and m_struct_value_end == THIS_BLOCK.op_count()) {
+		const int slot = m_struct_value->field_index(key);
+		if (slot != -1) type = m_struct_value;
+		return slot;
+	}
+
+	// The type of the value isn't known, so it is guessed from the field name. A wrong guess only
+	// costs the guard, after which the field is looked up by name as usual.
+	for (const Compiler* compiler = this; compiler != nullptr; compiler = compiler->m_parent) {
+		const std::vector<StructType*>& types = compiler->m_struct_types;
+		for (auto it = types.rbegin(); it != types.rend(); ++it) {
+			const int slot = (*it)->field_index(key);
+			if (slot != -1) {
+				type = *it;
+				return slot;
+			}
+		}
+	}
+
+	return -1;
+}
+
+void Compiler::emit_struct_op(Op op, StructType& type, int slot) {
+	emit_with_arg(op, emit_value(VYSE_OBJECT(&type)));
+	emit_arg(slot);
+}
+
+void Compiler::mark_number(std::vector<u32> deps) {
+	m_number_end = THIS_BLOCK.op_count();
+	m_number_deps = std::move(deps);
+}
+
+bool Compiler::number_expr(std::vector<u32>& deps) const {
+	if (m_number_end == 0 or m_number_end != THIS_BLOCK.op_count()) return false;
+	for (const u32 var : m_number_deps) {
+		if (!m_number_vars[var].is_number) return false;
+	}
+	deps.insert(deps.end(), m_number_deps.begin(), m_number_deps.end());
+	return true;
+}
+
+void Compiler::read_number_var(int slot) {
+	const int var = m_symtable.m_symbols[slot].number_var;
+	if (var != -1 and m_number_vars[var].is_number) mark_number({u32(var)});
+}
+
+void Compiler::assign_number_var(int slot, bool is_init) {
+	if (slot == -1) return;
+	LocalVar& local = m_symtable.m_symbols[slot];
+
+	std::vector<u32> deps;
+	const bool is_number = number_expr(deps);
+	if (is_init) {
+		if (!is_number) return;
+		local.number_var = m_number_vars.size();
+		m_number_vars.push_back(NumberVar{true, std::move(deps)});
+		return;
+	}
+
+	if (local.number_var == -1) return;
+	NumberVar& var = m_number_vars[local.number_var];
+	if (is_number) {
+		var.deps.insert(var.deps.end(), deps.begin(), deps.end());
+	} else {
+		var.is_number = false;
+	}
+}
+
+/// @brief Returns the version of [op] that doesn't check the types of it's operands, or [op]
+/// itself if there is none.
+static Op unchecked_op(Op op) {
+	switch (op) {
+	case Op::add: return Op::add_nn;
+	case Op::sub: return Op::sub_nn;
+	case Op::mult: return Op::mult_nn;
+	case Op::gt: return Op::gt_nn;
+	case Op::lt: return Op::lt_nn;
+	case Op::gte: return Op::gte_nn;
+	case Op::lte: return Op::lte_nn;
+	default: return op;
+	}
+}
+
+/// @brief Returns true if [op] always results in a number when both it's operands are numbers.
+static bool has_number_result(Op op) {
+	switch (op) {
+	case Op::add:
+	case Op::sub:
+	case Op::mult:
+	case Op::div:
+	case Op::mod:
+	case Op::exp:
+	case Op::band:
+	case Op::bor:
+	case Op::bxor:
+	case Op::lshift:
+	case Op::rshift: return true;
+	default: return false;
+	}
+}
+
+void Compiler::emit_binary_op(Op op, const Token& op_token, const std::vector<u32>* lhs_deps) {
+	std::vector<u32> deps;
+	if (lhs_deps == nullptr or !number_expr(deps)) {
+		emit(op, op_token);
+		return;
+	}
+
+	deps.insert(deps.end(), lhs_deps->begin(), lhs_deps->end());
+	const Op unchecked = unchecked_op(op);
+	if (unchecked != op) {
+		m_unchecked_ops.push_back(UncheckedOp{THIS_BLOCK.op_count(), op, deps});
+	}
+
+	emit(unchecked, op_token);
+	if (has_number_result(op)) mark_number(std::move(deps));
+}
+
+void Compiler::settle_number_types() {
+	// A variable that relies on one that isn't a number isn't one either.
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (NumberVar& var : m_number_vars) {
+			if (!var.is_number) continue;
+			for (const u32 dep : var.deps) {
+				if (!m_number_vars[dep].is_number) {
+					var.is_number = false;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	for (const UncheckedOp& op : m_unchecked_ops) {
+		for (const u32 dep : op.deps) {
+			if (!m_number_vars[dep].is_number) {
+				THIS_BLOCK.code[op.index] = op.checked_op;
+				break;
+			}
+		}
+	}
 }
 
 void Compiler::add_self_param() {
@@ -1023,7 +1929,7 @@ void Compiler::error_at(const char* message, u32 const line) {
 	if (has_error) return;
 	std::string const full_msg = kt::format_str("[line {}]: {}", line, message);
 	RuntimeError::DebugInfo location{line, ""};
-	RuntimeError err(m_vm->m_sources.end()->path, location, message, full_msg);
+	RuntimeError err(m_source->path, location, message, full_msg);
 	m_vm->on_error(*m_vm, err);
 
 	has_error = true;
@@ -1038,7 +1944,7 @@ void Compiler::error(std::string message, const Token& token) {
 		kt::format_str(fmt, token.location.line, token.raw(m_source->code), message);
 
 	RuntimeError::DebugInfo location{token.location.line, ""};
-	RuntimeError err(m_vm->m_sources.end()->path, location, message, full_msg);
+	RuntimeError err(m_source->path, location, message, full_msg);
 	m_vm->on_error(*m_vm, err);
 	has_error = true;
 }
@@ -1049,6 +1955,10 @@ bool Compiler::ok() const noexcept {
 }
 
 u32 Compiler::emit_string(const Token& token) {
+	return emit_value(VYSE_OBJECT(&string_literal(token)));
+}
+
+String& Compiler::string_literal(const Token& token) {
 	const u32 length = token.length() - 2; // minus the quotes
 
 	// The actual length of the string may be different from what we see in the source code because
@@ -1084,8 +1994,7 @@ u32 Compiler::emit_string(const Token& token) {
 	strbuf = (char*)realloc(strbuf, sizeof(char) * (str_len + 1));
 	strbuf[str_len] = '\0';
 
-	String& string = m_vm->take_string(strbuf, str_len);
-	return emit_value(VYSE_OBJECT(&string));
+	return m_vm->take_string(strbuf, str_len);
 }
 
 u32 Compiler::emit_id_string(const Token& token) {
@@ -1101,7 +2010,7 @@ int Compiler::find_local_var(const Token& name_token) const noexcept {
 }
 
 int Compiler::find_upvalue(const Token& token) {
-	if (m_parent == nullptr) return -1;
+	if (m_parent == nullptr) return m_codeblock->is_lazy() ? find_lazy_upvalue(token) : -1;
 
 	// First search among the local variables of the enclosing
 	// compiler.
@@ -1111,7 +2020,18 @@ int Compiler::find_upvalue(const Token& token) {
 	if (index != -1) {
 		LocalVar& local = m_parent->m_symtable.m_symbols[index];
 		local.is_captured = true;
-		return m_symtable.add_upvalue(index, true, local.is_const);
+		// The closure may assign anything to the variable.
+		if (!local.is_const and local.number_var != -1) {
+			m_parent->m_number_vars[local.number_var].is_number = false;
+		}
+		// A captured variadic parameter must hold the list of varargs.
+		if (index == m_parent->m_rest_slot) m_parent->m_codeblock->m_collects_varargs = true;
+		const int upval_index = m_symtable.add_upvalue(index, true, local.is_const);
+		UpvalDesc& upval = m_symtable.m_upvals[upval_index];
+		upval.inline_code = local.inline_code;
+		upval.struct_type = local.struct_type;
+		upval.instance_of = local.instance_of;
+		return upval_index;
 	}
 
 	// If not found within the parent compiler's local vars then look into the parent compiler's
@@ -1122,18 +2042,59 @@ int Compiler::find_upvalue(const Token& token) {
 	if (index != -1) {
 		// is not local since we found it in an enclosing compiler.
 		const UpvalDesc& upval = m_parent->m_symtable.m_upvals[index];
-		return m_symtable.add_upvalue(index, false, upval.is_const);
+		const int upval_index = m_symtable.add_upvalue(index, false, upval.is_const);
+		UpvalDesc& captured = m_symtable.m_upvals[upval_index];
+		captured.inline_code = upval.inline_code;
+		captured.struct_type = upval.struct_type;
+		captured.instance_of = upval.instance_of;
+		return upval_index;
 	}
 
 	// No local variable in any of the enclosing scopes was found with the same name.
 	return -1;
 }
 
+int Compiler::find_lazy_upvalue(const Token& token) const {
+	const char* const name = token.raw_cstr(m_source->code);
+	const std::vector<LazyBody::Upvalue>& upvals = m_codeblock->m_lazy->upvals;
+	for (size_t i = 0; i < upvals.size(); ++i) {
+		if (upvals[i].name.length() == token.length() and
+			std::memcmp(upvals[i].name.data(), name, token.length()) == 0) {
+			return int(i);
+		}
+	}
+	return -1;
+}
+
 size_t Compiler::emit_value(Value v) {
+	// Other objects (functions, match targets, table shapes) are never shared, and may be
+	// replaced in the pool after they're added. Structs are shared, since every field access
+	// through a struct refers to it.
+	ConstantKey key{VYSE_GET_TT(v), 0};
+	bool is_shared = true;
+	if (VYSE_IS_NUM(v)) {
+		// Comparing the bits keeps 0 and -0 apart.
+		const number num = VYSE_AS_NUM(v);
+		std::memcpy(&key.bits, &num, sizeof(num));
+	} else if (VYSE_IS_BOOL(v)) {
+		key.bits = VYSE_AS_BOOL(v);
+	} else if (VYSE_IS_STRING(v) or VYSE_IS_STRUCT_TYPE(v)) {
+		key.bits = u64(uintptr_t(VYSE_AS_OBJECT(v)));
+	} else {
+		is_shared = false;
+	}
+
+	if (is_shared) {
+		const auto it = m_constant_slots.find(key);
+		if (it != m_constant_slots.end()) return it->second;
+	}
+
 	const size_t index = THIS_BLOCK.add_value(v);
 	if (index >= Compiler::MaxLocalVars) {
 		error("Too many constants in a single block.", token);
 	}
+
+	if (is_shared) m_constant_slots.emplace(key, index);
 	return index;
 }
 
@@ -1206,6 +2167,10 @@ int Compiler::op_arity(u32 op_index) const noexcept {
 		return 1 + n_upvals * 2;
 	}
 
+	if (op == Op::invoke or op == Op::invoke_spread or op == Op::invoke_intrinsic or
+		op == Op::inline_guard or op == Op::struct_get or op == Op::struct_set) {
+		return 2;
+	}
 	if (CHECK_ARITY(op, 0)) return 0;
 	if (CHECK_ARITY(op, 1)) return 1;
 
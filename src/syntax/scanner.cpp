@@ -86,6 +86,19 @@ Token Scanner::next_token() noexcept {
 	return make_token(TT::Error);
 }
 
+Token Scanner::lookahead() noexcept {
+	const auto saved_pos = line_pos;
+	const u32 saved_start = start;
+	const u32 saved_current = current;
+
+	const Token token = next_token();
+
+	line_pos = saved_pos;
+	start = saved_start;
+	current = saved_current;
+	return token;
+}
+
 TT Scanner::check_kw_chars(const char* rest, u32 kwlen, u32 cmplen, TT ttype) const {
 	u32 offset = kwlen - cmplen;
 	if (kwlen != (current - start)) return TT::Id;
@@ -103,12 +116,13 @@ typedef struct {
 static constexpr KeywordData keywords[] = {
 	{"false", 5, TT::False}, {"true", 4, TT::True},
 	{"nil", 3, TT::Nil},	 {"or", 2, TT::Or},
-	{"and", 3, TT::Or},		 {"let", 3, TT::Let},
+	{"and", 3, TT::And},		 {"let", 3, TT::Let},
 	{"const", 5, TT::Const}, {"if", 2, TT::If},
 	{"else", 4, TT::Else},	 {"while", 5, TT::While},
 	{"fn", 2, TT::Fn},		 {"return", 6, TT::Return},
 	{"break", 5, TT::Break}, {"continue", 8, TT::Continue},
-	{"for", 3, TT::For},
+	{"for", 3, TT::For},	 {"match", 5, TT::Match},
+	{"struct", 6, TT::Struct},
 };
 
 TT Scanner::kw_or_id_type() const {
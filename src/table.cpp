@@ -1,5 +1,6 @@
 #include "common.hpp"
 #include "value.hpp"
+#include <algorithm>
 #include <gc.hpp>
 #include <table.hpp>
 #include <upvalue.hpp>
@@ -25,8 +26,19 @@ Table::~Table() {
 
 void Table::ensure_capacity() {
 	if (m_num_entries < m_cap * LoadFactor) return;
+	resize(m_cap == 0 ? MinCapacity : m_cap * GrowthFactor);
+}
+
+void Table::reserve(size_t num_entries) {
+	if (num_entries == 0) return;
+	size_t new_cap = std::max(m_cap, MinCapacity);
+	while (num_entries >= new_cap * LoadFactor) new_cap *= GrowthFactor;
+	if (new_cap != m_cap) resize(new_cap);
+}
+
+void Table::resize(size_t new_cap) {
 	size_t old_cap = m_cap;
-	m_cap *= GrowthFactor;
+	m_cap = new_cap;
 	Entry* old_entries = m_entries;
 	m_entries = new Entry[m_cap];
 
@@ -48,8 +60,33 @@ void Table::ensure_capacity() {
 	delete[] old_entries;
 }
 
+void Table::copy_shape(const Table& shape, const Value* values) {
+	VYSE_ASSERT(m_num_entries == 0, "Shape copied into a non-empty table.");
+	if (m_cap != shape.m_cap) {
+		delete[] m_entries;
+		m_cap = shape.m_cap;
+		m_entries = new Entry[m_cap];
+	}
+
+	// The keys stay in the same slots they were hashed into in the shape, so no hashing or
+	// probing is needed. Only the values have to be filled in.
+	std::copy(shape.m_entries, shape.m_entries + m_cap, m_entries);
+	m_num_entries = shape.m_num_entries;
+	m_num_tombstones = shape.m_num_tombstones;
+
+	for (size_t i = 0; i < m_cap; ++i) {
+		Entry& entry = m_entries[i];
+		if (IS_ENTRY_FREE(entry) or IS_ENTRY_DEAD(entry)) continue;
+		entry.value = values[size_t(VYSE_AS_NUM(entry.value))];
+		// Fields that are set to nil don't exist.
+		if (VYSE_IS_NIL(entry.value)) TABLE_PLACE_TOMBSTONE(entry);
+	}
+}
+
 [[nodiscard]] Value Table::get(Value key) const {
 	if (VYSE_IS_NIL(key)) return VYSE_NIL;
+	// Empty tables may not have an entries buffer to search.
+	if (m_num_entries == 0) return m_proto_table == nullptr ? VYSE_NIL : m_proto_table->get(key);
 
 	size_t mask = m_cap - 1;
 	size_t hash = hash_value(key);
@@ -71,6 +108,7 @@ bool Table::set(String& key, Value value) {
 
 bool Table::set(Value key, Value value) {
 	VYSE_ASSERT(!VYSE_IS_NIL(key), "Table key is nil.");
+	VYSE_ASSERT(!is_frozen(), "Attempt to modify a frozen table.");
 
 	// If the value is nil, then the key is
 	// simply removed with a tombstone in the
@@ -147,6 +185,7 @@ bool Table::set(Value key, Value value) {
 }
 
 bool Table::remove(Value key) {
+	VYSE_ASSERT(!is_frozen(), "Attempt to modify a frozen table.");
 	if (m_num_entries == 0) return false;
 
 	// Find the slot where this key would go.
@@ -173,6 +212,7 @@ size_t Table::length() const {
 String* Table::find_string(const char* chars, size_t length, size_t hash) const {
 	VYSE_ASSERT(chars != nullptr, "key string is null.");
 	VYSE_ASSERT(hash == hash_cstring(chars, length), "Incorrect cstring hash.");
+	if (m_num_entries == 0) return nullptr;
 
 	size_t mask = m_cap - 1;
 	size_t index = hash & mask;
@@ -198,7 +238,7 @@ String* Table::find_string(const char* chars, size_t length, size_t hash) const
 	return nullptr;
 }
 
-size_t Table::hash_value(Value key) const {
+size_t Table::hash_value(Value key) {
 	VYSE_ASSERT(!VYSE_IS_NIL(key), "Attempt to hash a nil key.");
 	switch (VYSE_GET_TT(key)) {
 	case VT::Bool: return VYSE_AS_BOOL(key) ? 7 : 15;
@@ -208,7 +248,7 @@ size_t Table::hash_value(Value key) const {
 	}
 }
 
-size_t Table::hash_object(Obj* object) const {
+size_t Table::hash_object(Obj* object) {
 	switch (object->tag) {
 	case OT::string: return static_cast<String*>(object)->hash();
 	case OT::upvalue: return hash_value(*static_cast<Upvalue*>(object)->m_value);
@@ -225,18 +265,8 @@ void Table::trace(GC& gc) {
 	}
 }
 
-void Table::delete_white_string_keys() {
-	for (u32 i = 0; i < m_cap; ++i) {
-		Entry& entry = m_entries[i];
-		if (IS_ENTRY_DEAD(entry) or IS_ENTRY_FREE(entry)) continue;
-		if (VYSE_IS_STRING(entry.key) and !VYSE_AS_STRING(entry.key)->marked) {
-			TABLE_PLACE_TOMBSTONE(entry);
-		}
-	}
-}
-
 size_t Table::size() const {
-	return sizeof(Table) + m_cap * sizeof(Value);
+	return sizeof(Table) + m_cap * sizeof(Entry);
 }
 
 bool operator==(const Table::Entry& a, const Table::Entry& b) {
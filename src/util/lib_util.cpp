@@ -11,12 +11,13 @@ void bad_arg_error(vy::VM& vm, const char* fname, int argn, const char* expected
 									expected_type, received_type));
 }
 
-void add_libfn(VM& vm, Table& proto, const char* name, NativeFn cfn) {
+CClosure& add_libfn(VM& vm, Table& proto, const char* name, NativeFn cfn) {
 	vm.gc_off();
 	String* sname = &vm.make_string(name);
 	CClosure* fn = &vm.make<CClosure>(cfn);
 	proto.set(VYSE_OBJECT(sname), VYSE_OBJECT(fn));
 	vm.gc_on();
+	return *fn;
 }
 
 static bool check_arg_type(VM& vm, int argn, ValueType expected_type, const char* expected_type_str,
@@ -58,6 +59,30 @@ bool check_argc(VM& vm, const char* fname, int argc, int min_args, int max_args)
 	return true;
 }
 
+bool compare_values(Value a, Value b, int& result) noexcept {
+	if (VYSE_IS_NUM(a) and VYSE_IS_NUM(b)) {
+		const number x = VYSE_AS_NUM(a), y = VYSE_AS_NUM(b);
+		result = x < y ? -1 : (y < x ? 1 : 0);
+		return true;
+	}
+
+	if (VYSE_IS_STRING(a) and VYSE_IS_STRING(b)) {
+		const String* x = VYSE_AS_STRING(a);
+		const String* y = VYSE_AS_STRING(b);
+		if (x == y) {
+			result = 0;
+			return true;
+		}
+
+		const size_t len = std::min(x->len(), y->len());
+		result = std::memcmp(x->c_str(), y->c_str(), len);
+		if (result == 0) result = x->len() < y->len() ? -1 : (x->len() > y->len() ? 1 : 0);
+		return true;
+	}
+
+	return false;
+}
+
 void cfn_error(VM& vm, const char* fname, std::string&& message) {
 	vm.runtime_error(kt::format_str("In call to {}: {}", fname, message));
 }
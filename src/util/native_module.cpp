@@ -28,6 +28,12 @@ void NativeModule::add_cclosures(const std::pair<const char*, NativeFn>* funcs,
 	m_vm->gc_on();
 }
 
+void NativeModule::set_intrinsic(const char* fname, Intrinsic id) {
+	const Value fn = m_table->get(VYSE_OBJECT(&m_vm->make_string(fname)));
+	VYSE_ASSERT(VYSE_IS_CCLOSURE(fn), "intrinsic is not a native function.");
+	VYSE_AS_CCLOSURE(fn)->m_intrinsic = id;
+}
+
 void NativeModule::add_field(const char* name, Value value) {
 	String& vyname = m_vm->make_string(name);
 	GCLock lock = m_vm->gc_lock(&vyname);
@@ -2,6 +2,7 @@
 #include <cassert>
 #include <cstdio>
 #include <list.hpp>
+#include <struct.hpp>
 #include <vm.hpp>
 
 namespace vy {
@@ -10,7 +11,7 @@ using VT = ValueType;
 using OT = ObjType;
 
 const char* Obj::to_cstring() const {
-	return "[vyse object]";
+	return tag == OT::user_data ? "userdata" : "[vyse object]";
 }
 
 void print_value(Value v) {
@@ -75,6 +76,13 @@ std::string value_to_string(Value v) {
 			List* list = VYSE_AS_LIST(v);
 			return "[list " + std::to_string((size_t)list) + "]";
 		}
+		case OT::struct_type:
+			return std::string("[struct ") + static_cast<const StructType*>(obj)->name_cstr() + "]";
+		case OT::struct_: {
+			const Struct* instance = VYSE_AS_STRUCT(v);
+			return std::string("[") + instance->m_type->name_cstr() + " " +
+				   std::to_string((size_t)instance) + "]";
+		}
 
 		default: return std::string(obj->to_cstring());
 		}
@@ -103,6 +111,8 @@ const char* otype_to_string(ObjType tag) {
 	case OT::c_closure: return "native function";
 	case OT::list: return "list";
 	case OT::user_data: return "userdata";
+	case OT::struct_type:
+	case OT::struct_: return "struct";
 	default: return "unknown";
 	}
 }
@@ -126,8 +136,13 @@ bool operator==(const Value& a, const Value& b) {
 	case VT::Object: {
 		const Obj* oa = VYSE_AS_OBJECT(a);
 		const Obj* ob = VYSE_AS_OBJECT(b);
-		if (oa->tag != ob->tag) return false;
-		return oa == ob;
+		if (oa == ob) return true;
+		// Strings made by a VM are interned, so they are equal only if they are the same object.
+		// Frozen strings are shared between VMs and never interned, so they are compared by their
+		// characters instead.
+		if (oa->tag != OT::string or ob->tag != OT::string) return false;
+		if (!oa->is_frozen() and !ob->is_frozen()) return false;
+		return *static_cast<const String*>(oa) == *static_cast<const String*>(ob);
 	}
 	case VT::Nil: return true;
 	default: return false;
@@ -0,0 +1,123 @@
+#include "assert.hpp"
+#include <aot.hpp>
+#include <filesystem>
+#include <function.hpp>
+#include <table.hpp>
+#include <vm.hpp>
+
+using namespace vy;
+
+// Defined by the C++ file that `vy --emit-cpp` generates from the test module at build time.
+VYSE_API const aot::Module* aot_module_numeric();
+
+static const char* const ModulePath = "../tests/test_programs/aot/numeric.vy";
+// Scripts are run as if they were placed next to the module, so that they can import it.
+static const char* const ScriptPath = "../tests/test_programs/aot/script.vy";
+
+static std::string message;
+
+/// @brief Runs [code] with the module's C++ translation registered if [module] isn't null.
+static ExitCode run(VM& vm, const std::string& code, const aot::Module* module) {
+	message.clear();
+	vm.load_stdlib();
+	vm.on_error = [](VM&, RuntimeError error) { message = error.full_message; };
+	if (module != nullptr) {
+		vm.dynloader.add_compiled_module(std::filesystem::absolute(ModulePath).string(), *module);
+	}
+	return vm.runfile(ScriptPath, code);
+}
+
+/// @brief Returns the code block of the function [name] exported by the module that [vm] returned.
+static const CodeBlock& exported(VM& vm, const char* name) {
+	const Table& exports = *VYSE_AS_TABLE(vm.return_value);
+	const Value fn = exports.get(VYSE_OBJECT(&vm.make_string(name)));
+	ASSERT(VYSE_IS_CLOSURE(fn), std::string("Not a function: ") + name);
+	return *VYSE_AS_CLOSURE(fn)->m_codeblock;
+}
+
+static void attach_test() {
+	const aot::Module& module = *aot_module_numeric();
+	VM vm;
+	vm.load_stdlib();
+	Closure* script = vm.compile({ModulePath, module.source});
+	ASSERT(script != nullptr, "Test module failed to compile.");
+	ASSERT(aot::attach(*script->m_codeblock, module) == 10, "Wrong number of functions attached.");
+
+	// Translations aren't attached to functions whose code has changed.
+	Closure* changed = vm.compile({ModulePath, std::string(module.source) + "\nfn extra() {}"});
+	ASSERT(aot::attach(*changed->m_codeblock, module) == 10, "Attached to a new function.");
+	Closure* edited =
+		vm.compile({ModulePath, "fn fib(n) { if n < 3 { return n }\n return fib(n - 1) }"});
+	ASSERT(aot::attach(*edited->m_codeblock, module) == 0, "Attached to an edited function.");
+}
+
+static const char* const ResultsCode = R"(
+const m = import("./numeric.vy")
+assert(m.fib(20) == 6765)
+assert(m.sum_squares(10) == 285)
+assert(m.gcd(84, 36) == 12)
+assert(m.collatz(27) == 111)
+assert(m.bits(12, 10) == 14)
+assert(m.clamp(5, 0, 3) == 3 and m.clamp(-1, 0, 3) == 0 and m.clamp(2, 0, 3) == 2)
+assert(m.ratio(1, 4) == 0.25)
+assert(m.power(2, 2) == 4 and m.power(2, 3) == -8)
+assert(m.down(9) == 1 and m.down(-1) == nil)
+assert(m.depth(500) == 500)
+assert(m.describe(1).value == 1)
+
+-- Values of other types are passed through, or handled by the interpreter.
+const t = {}
+assert(m.gcd(t, 0) == t)
+const half = setproto({}, { __div(b) { return "divided" } })
+assert(m.ratio(half, 2) == "divided")
+return m
+)";
+
+static void results_test() {
+	for (const aot::Module* module : {aot_module_numeric(), (const aot::Module*)nullptr}) {
+		VM vm;
+		const ExitCode ec = run(vm, ResultsCode, module);
+		ASSERT(ec == ExitCode::Success, "Wrong results: " + message);
+
+		const bool compiled = module != nullptr;
+		ASSERT((exported(vm, "fib").m_compiled != nullptr) == compiled, "Wrong translation.");
+		ASSERT((exported(vm, "depth").m_compiled != nullptr) == compiled, "Wrong translation.");
+		ASSERT(exported(vm, "describe").m_compiled == nullptr, "describe was translated.");
+	}
+
+	// The translation of a module whose source has changed since isn't used.
+	const aot::Module stale{"return {}", aot_module_numeric()->functions,
+							aot_module_numeric()->num_functions};
+	VM vm;
+	const ExitCode ec = run(vm, ResultsCode, &stale);
+	ASSERT(ec == ExitCode::Success, "Wrong results: " + message);
+	ASSERT(exported(vm, "fib").m_compiled == nullptr, "A stale translation was attached.");
+}
+
+static void error_test() {
+	// Calls that fail are run again by the interpreter, so the errors are the same.
+	const char* const codes[] = {
+		"import(\"./numeric.vy\").fib(\"x\")",
+		"import(\"./numeric.vy\").ratio(0, 1)",
+		"import(\"./numeric.vy\").sum_squares(nil)",
+		"import(\"./numeric.vy\").depth(5000)",
+	};
+
+	for (const char* code : codes) {
+		VM interpreted;
+		run(interpreted, code, nullptr);
+		const std::string expected = message;
+		ASSERT(!expected.empty(), std::string("Expected an error from: ") + code);
+
+		VM compiled;
+		run(compiled, code, aot_module_numeric());
+		ASSERT(message == expected, "Expected error: '" + expected + "', Got: '" + message + "'");
+	}
+}
+
+int main() {
+	attach_test();
+	results_test();
+	error_test();
+	return 0;
+}
@@ -12,12 +12,14 @@ int main() {
 	std::string dir_path = "../tests/test_programs/auto";
 	assert(stdfs::exists(dir_path) && "test directory exists.");
 
-	auto run_code = [](std::string fpath, std::string code) {
+	auto run_code = [](std::string fpath, std::string code, bool lazy) {
 		vy::VM vm;
+		vm.lazy_compile = lazy;
 		vm.load_stdlib();
 		vy::ExitCode ec = vm.runfile(fpath, code);
 		if (ec != vy::ExitCode::Success) {
-			std::cerr << "Failure running auto test ("  << fpath << "). " << std::endl;
+			std::cerr << "Failure running auto test (" << fpath << (lazy ? ", lazy" : "")
+					  << "). " << std::endl;
 			abort();
 		}
 	};
@@ -28,7 +30,9 @@ int main() {
 			std::ifstream stream(entry.path());
 			std::ostringstream ostream;
 			ostream << stream.rdbuf();
-			run_code(entry.path().string(), ostream.str());
+			run_code(entry.path().string(), ostream.str(), false);
+			// Every test must also pass when functions are compiled on their first call.
+			run_code(entry.path().string(), ostream.str(), true);
 			std::cout << " [DONE]\n";
 		}
 	}
@@ -39,6 +39,34 @@ static void compiler_test() {
 		let T = {a : 1} 
 	)");
 
+	print_disassembly("let xs = [1, 2, 3]");
+
+	print_disassembly(R"(
+		let x = 3
+		match x {
+			1, 2 -> x = 10
+			3 -> x = 20
+			"s" -> x = 30
+			else -> x = 40
+		}
+	)");
+
+	print_disassembly(R"(
+		let sum = 0
+		for i = 0, 10 { sum = sum + i * 2 }
+	)");
+
+	print_disassembly(R"(
+		const add = /a, b -> a + b
+		let x = add(1, 2)
+	)");
+
+	print_disassembly(R"(
+		struct Point { x, y }
+		let p = Point(1, 2)
+		p.x += p.y
+	)");
+
 	// print_disassembly(R"(
 	// 	const tbl = {
 	// 		[123 + 4]: "abc" .. "def"
@@ -7,8 +7,8 @@ using namespace vy;
 #define ASSERT_MEM(got, expect, message)                                                           \
 	ASSERT(got == expect, message << " (expected: " << expect << " got: " << got << ")");
 
-static constexpr size_t table_size(int cap = Table::DefaultCapacity) {
-	return sizeof(Table) + sizeof(Value) * cap;
+static constexpr size_t table_size(int cap = 0) {
+	return sizeof(Table) + sizeof(Table::Entry) * cap;
 }
 
 static constexpr size_t string_size(int nchars) {
@@ -34,6 +34,11 @@ void test_gc() {
 	ASSERT_MEM(vm.memory(), base_size + closure_size + proto_size + string_size(7),
 			   "String allocation test");
 	vm.collect_garbage();
+
+	// The table grows well past the size it was allocated with, all of which is freed.
+	vm.runcode("const t = {}\nfor i = 1, 100 { t[i] = i }");
+	vm.collect_garbage();
+	ASSERT_MEM(vm.memory(), base_size, "Grown table freed.");
 }
 
 int main() {
@@ -30,9 +30,10 @@ static bool run_tests() {
 											 TT::BitLShift, TT::Gt, TT::Lt, TT::LtEq});
 
 	// test keyword and identifier scanning
-	code = "let true false xyz else break continue";
+	code = "let true false xyz else break continue match matches struct";
 	passed = passed && compare_ttypes(code, {TT::Let, TT::True, TT::False, TT::Id, TT::Else,
-											 TT::Break, TT::Continue, TT::Eof});
+											 TT::Break, TT::Continue, TT::Match, TT::Id, TT::Struct,
+											 TT::Eof});
 
 	code = "'this is a string' .. 'this is also string'";
 	passed = passed && compare_ttypes(code, {TT::String, TT::Concat, TT::String, TT::Eof});
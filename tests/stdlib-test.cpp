@@ -1,5 +1,10 @@
+#include "assert.hpp"
 #include "util/test_utils.hpp"
 #include <iostream>
+#include <libloader.hpp>
+#include <thread>
+#include <util/auxlib.hpp>
+#include <vm.hpp>
 
 using namespace vy;
 
@@ -9,10 +14,156 @@ void strlib_test() {
 				"byte (char to ascii)");
 	test_file("stdlib/map-str.vy", VYSE_NUM(597),
 			  "Mapping over characters of a string using closures.");
+	test_error("'{:q}':fmt(1)",
+			   "In call to 'String.fmt': Bad format string: unexpected 'q' in format spec.");
+	test_error("'{} {}':fmt(1)",
+			   "In call to 'String.fmt': Format string expects 2 argument(s), got 1.");
+	// Numbers in a replacement field that are too large are errors, instead of wrapping around.
+	test_error("'{4294967296}y':fmt(1)", "In call to 'String.fmt': Bad format string: argument "
+										 "index larger than 199 at index 0.");
+	test_error("'{4294967295}x':fmt()", "In call to 'String.fmt': Bad format string: argument "
+										"index larger than 199 at index 0.");
+	test_error("'{:4000000000}':fmt(1)",
+			   "In call to 'String.fmt': Bad format string: width is larger than 65536.");
+	test_error("'{:.70000}':fmt(1)",
+			   "In call to 'String.fmt': Bad format string: precision is larger than 65536.");
 	std::cout << "[string lib tests passed]" << std::endl;
 }
 
+void listlib_test() {
+	// The key function may not change the length of the list it is sorting.
+	test_error("const xs = [{ v: 2 }, { v: 1 }, { v: 3 }]\n"
+			   "xs:sort(fn(x) { xs:pop() return x.v })",
+			   "In call to 'List.sort': List was modified by the key function.");
+	test_error("const xs = [2, 1]\nxs:sort(fn(x) { xs <<< x return x })",
+			   "In call to 'List.sort': List was modified by the key function.");
+	std::cout << "[list lib tests passed]" << std::endl;
+}
+
+/// A pipeline of three VMs, each on it's own thread, that talk over channels.
+void channel_test() {
+	test_error("_ = import('channel').open('c'):send(print)",
+			   "In call to 'Channel:send': Cannot send a native function value over a channel.");
+	test_error("_ = import('channel').open('c'):send(nil)",
+			   "In call to 'Channel:send': Cannot send nil over a channel.");
+	test_error("_ = import('channel').open('c', 3000000000)",
+			   "In call to 'channel.open': Channel capacity must be at most 1048576.");
+	test_error("_ = import('channel').open('c', 0)",
+			   "In call to 'channel.open': Channel capacity must be at least 1.");
+
+	static constexpr const char* producer = R"(
+		const channel = import("channel")
+		const out = channel.open("test-numbers", 8)
+		const shared = freeze({ scale: 3 })
+		for i = 0, 1000 {
+			out:send({ n: i, shared: shared })
+		}
+		out:close()
+	)";
+
+	static constexpr const char* transformer = R"(
+		const channel = import("channel")
+		const input = channel.open("test-numbers", 8)
+		const out = channel.open("test-scaled", 8)
+		let item = input:recv()
+		while item {
+			out:send([item.n * item.shared.scale])
+			item = input:recv()
+		}
+		out:close()
+	)";
+
+	static constexpr const char* aggregator = R"(
+		const input = import("channel").open("test-scaled", 8)
+		let sum = 0
+		let item = input:recv()
+		while item {
+			sum = sum + item[0]
+			item = input:recv()
+		}
+		return sum
+	)";
+
+	const auto run = [](const char* code, Value* result) {
+		VM vm;
+		vm.load_stdlib();
+		const bool ok = vm.runcode(code) == ExitCode::Success;
+		*result = ok and VYSE_IS_NUM(vm.return_value) ? vm.return_value : VYSE_BOOL(ok);
+	};
+
+	Value results[3] = {VYSE_NIL, VYSE_NIL, VYSE_NIL};
+	std::thread threads[] = {std::thread(run, producer, &results[0]),
+							 std::thread(run, transformer, &results[1]),
+							 std::thread(run, aggregator, &results[2])};
+	for (std::thread& thread : threads) thread.join();
+
+	ASSERT(results[0] == VYSE_BOOL(true) and results[1] == VYSE_BOOL(true),
+		   "Channel pipeline stage failed.");
+	ASSERT(results[2] == VYSE_NUM(3 * 999 * 1000 / 2), "Wrong sum from channel pipeline.");
+	std::cout << "[channel tests passed]" << std::endl;
+}
+
+void parallel_test() {
+	test_error("let n = 0 _ = import('parallel').map([1], fn (x) { n = x })",
+			   "In call to 'parallel.map': Function '<anonymous>' assigns to a variable it "
+			   "captured, and can't run on a worker.");
+	test_error("let n = 0 _ = import('parallel').map([1], fn (x) { const set = fn () { n = x } "
+			   "set() })",
+			   "In call to 'parallel.map': <script>:1: Attempt to assign to a frozen variable.");
+	test_error("_ = import('parallel').map([1], fn (x) { return { f: print } })",
+			   "In call to 'parallel.map': Cannot send a native function value back from a "
+			   "worker.");
+	test_error("_ = import('parallel').map([1, 2], fn (x) { return x }, { workers: 0.5 })",
+			   "In call to 'parallel.map': Option 'workers' must be a positive integer.");
+	test_return("return import('parallel').map([1, 2, 3], fn (x) { return x + 1 })[2]",
+				VYSE_NUM(4), "parallel.map");
+	std::cout << "[parallel tests passed]" << std::endl;
+}
+
+static int times_loaded = 0;
+
+static Value twice(VM& vm, int argc) {
+	util::Args args(vm, "counter.twice", 1, argc);
+	return VYSE_NUM(args.next_number() * 2);
+}
+
+static void load_counter(VM* vm, Table* module) {
+	++times_loaded;
+	util::NativeModule counter(vm, module);
+	counter.add_cfunc("twice", twice);
+	counter.add_field("name", VYSE_OBJECT(&vm->make_string("counter")));
+}
+
+void native_module_test() {
+	register_native_module("test-counter", load_counter);
+
+	// Each VM gets it's own copy of the module's table, but the module is only loaded once.
+	static constexpr const char* code = R"(
+		const counter = import("test-counter")
+		assert(counter.name == "counter" and !is_frozen(counter))
+		assert(counter.extra == nil)
+		counter.extra = 1
+		return counter.twice(21)
+	)";
+	for (int i = 0; i < 3; ++i) {
+		VM vm;
+		vm.load_stdlib();
+		ASSERT(vm.runcode(code) == ExitCode::Success, "Native module import failed.");
+		ASSERT(vm.return_value == VYSE_NUM(42), "Wrong value from native module.");
+	}
+	ASSERT(times_loaded == 1, "Native module was loaded more than once.");
+
+	test_return("const s = import('collections').Set() s:add(7) "
+				"return import('math').floor(2.5) + s:len()",
+				VYSE_NUM(3), "standard library native modules");
+	std::cout << "[native module tests passed]" << std::endl;
+}
+
 int main() {
 	strlib_test();
+	listlib_test();
+	channel_test();
+	parallel_test();
+	native_module_test();
 	return 0;
 }
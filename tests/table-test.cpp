@@ -2,7 +2,9 @@
 #include "string.hpp"
 #include "util/test_utils.hpp"
 #include "value.hpp"
+#include <string_set.hpp>
 #include <table.hpp>
+#include <vector>
 
 #define NUM VYSE_NUM
 #define NIL VYSE_NIL
@@ -116,12 +118,45 @@ void intern_test() {
 	delete s;
 }
 
+void string_set_test() {
+	vy::StringSet set;
+	std::vector<unique_str_ptr> strings;
+	for (int i = 0; i < 100; ++i) {
+		const std::string chars = "string " + std::to_string(i);
+		strings.emplace_back(STR(chars.c_str(), chars.size()));
+		set.insert(strings.back().get());
+	}
+	EXPECT(set.length() == 100, "StringSet::length() after inserting 100 strings.");
+
+	const auto find = [&](const char* cs) {
+		return set.find(cs, strlen(cs), vy::hash_cstring(cs, strlen(cs)));
+	};
+
+	EXPECT(find("string 42") == strings[42].get(), "StringSet::find returns the interned string.");
+	EXPECT(find("string 100") == nullptr, "StringSet::find returns nullptr for missing strings.");
+
+	// Remove the strings with odd numbers, as the GC does with the ones it frees.
+	set.remove_if([](const vy::String* s) { return (s->c_str()[s->len() - 1] - '0') % 2 == 1; });
+	EXPECT(set.length() == 50,
+		   "StringSet::remove_if removes strings. (got: " << set.length() << ")");
+	EXPECT(find("string 42") == strings[42].get(), "Kept strings are still found after removal.");
+	EXPECT(find("string 43") == nullptr, "Removed strings aren't found.");
+
+	set.remove_if([](const vy::String*) { return true; });
+	EXPECT(set.length() == 0, "StringSet::remove_if can empty the set.");
+	EXPECT(find("string 42") == nullptr, "An emptied set has no strings.");
+
+	set.insert(strings[7].get());
+	EXPECT(find("string 7") == strings[7].get(), "Strings can be inserted into an emptied set.");
+}
+
 int main() {
 	run_test();
 	resize_test();
 	removal_test();
 	strkey_test();
 	intern_test();
+	string_set_test();
 
 	std::cout << "[All Table Tests Passed]\n";
 
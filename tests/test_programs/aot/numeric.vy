@@ -0,0 +1,78 @@
+-- A module of functions that `vy --emit-cpp` can translate to C++, used by aot-test.cpp.
+
+fn fib(n) {
+	if n < 2 { return n }
+	return fib(n - 1) + fib(n - 2)
+}
+
+fn sum_squares(n) {
+	let total = 0
+	for i = 0, n { total = total + i * i }
+	return total
+}
+
+fn gcd(a, b) {
+	while b != 0 {
+		const t = b
+		b = a % b
+		a = t
+	}
+	return a
+}
+
+fn collatz(n) {
+	let steps = 0
+	while n != 1 {
+		if n % 2 == 0 { n = n / 2 } else { n = 3 * n + 1 }
+		steps = steps + 1
+	}
+	return steps
+}
+
+fn bits(x, y) {
+	return ((x & y) | (x ^ y)) << 1 >> 1
+}
+
+fn clamp(x, lo, hi) {
+	if x < lo or x == nil { return lo }
+	if x > hi and !(hi == nil) { return hi }
+	return x
+}
+
+fn ratio(a, b) {
+	return a / b
+}
+
+fn power(x, n) {
+	return -x ** n
+}
+
+fn down(n) {
+	let last = nil
+	for i = n, 0, -2 { last = i }
+	return last
+}
+
+fn depth(n) {
+	if n == 0 { return 0 }
+	return depth(n - 1) + 1
+}
+
+-- Not translated: uses a table.
+fn describe(x) {
+	return { value: x }
+}
+
+return {
+	fib: fib,
+	sum_squares: sum_squares,
+	gcd: gcd,
+	collatz: collatz,
+	bits: bits,
+	clamp: clamp,
+	ratio: ratio,
+	power: power,
+	down: down,
+	depth: depth,
+	describe: describe
+}
@@ -17,3 +17,32 @@ const g = /(x, y, z) -> {
 assert(g(1, 2, 13) == 16)
 assert(g(1, 2) == 3)
 assert(g(56) == 56)
+
+-- method calls evaluate the receiver once and pass it as the first argument.
+{
+  let evals = 0
+  const obj = { n: 10, add: fn(self, a, b) { return self.n + a + b } }
+  const get = fn() { evals = evals + 1; return obj }
+  assert(get():add(1, 2) == 13 and evals == 1)
+  assert(obj:add(1, 2, 3) == 13)
+
+  -- methods found through a prototype, and on primitive values.
+  const child = { n: 1 }
+  setproto(child, obj)
+  assert(child:add(0, 0) == 1)
+  assert("12":to_num() == 12)
+  assert([1, 2]:map(/(x) -> x * 2)[1] == 4)
+}
+
+-- a closure that captures a local and a variable two levels up keeps the local once it's
+-- enclosing function returns.
+{
+  const k = 10
+  const outer = fn(x) {
+    let count = x
+    const inner = fn() { count = count + k; return count }
+    return inner
+  }
+  const f = outer(1)
+  assert(f() == 11 and f() == 21)
+}
@@ -0,0 +1,48 @@
+const channel = import("channel")
+
+-- channels are found by name, and hand out values in the order they were sent.
+const ch = channel.open("auto-test", 4)
+assert(channel.open("auto-test") != nil)
+assert(ch:len() == 0 and ch:try_recv() == nil)
+
+assert(ch:send(1))
+assert(channel.open("auto-test"):try_send("two"))
+assert(ch:len() == 2)
+assert(ch:try_recv() == 1 and ch:recv() == "two")
+
+-- a full channel refuses values that it can't wait for.
+for i = 0, 4 {
+	assert(ch:try_send(i))
+}
+assert(!ch:try_send(4))
+for i = 0, 4 {
+	assert(ch:recv() == i)
+}
+
+-- tables and lists arrive as copies that can be modified.
+const point = { x: 1, y: [2, 3] }
+point.self = point
+ch:send(point)
+const got = ch:recv()
+assert(got != point and got.x == 1 and got.y[1] == 3 and got.self == got)
+assert(!is_frozen(got))
+got.x = 10
+got.y <<< 4
+assert(point.x == 1 and #point.y == 2)
+
+-- frozen values are passed as they are.
+const config = freeze({ name: "config", parts: [1, 2] })
+ch:send({ config: config, n: 1 })
+const msg = ch:recv()
+assert(msg.config == config and is_frozen(msg.config) and !is_frozen(msg))
+
+-- once closed, a channel gives out the values left in it, and then nil.
+ch:send("last")
+ch:close()
+assert(ch:is_closed() and !ch:send(1) and !ch:try_send(1))
+assert(ch:recv() == "last" and ch:recv() == nil)
+
+-- opening the name again makes a new channel.
+const fresh = channel.open("auto-test")
+assert(!fresh:is_closed())
+fresh:close()
@@ -0,0 +1,105 @@
+const collections = import("collections")
+const Set = collections.Set
+const Deque = collections.Deque
+
+-- Set
+{
+	const s = Set([1, 2, 3, 2, 1])
+	assert(s:len() == 3)
+	assert(s:has(1) and s:has(2) and s:has(3))
+	assert(!s:has(4) and !s:has("1") and !s:has(nil))
+
+	assert(s:add("one"))
+	assert(!s:add("one"))
+	assert(s:has("o" .. "ne"))
+
+	assert(s:remove(2))
+	assert(!s:remove(2))
+	assert(!s:has(2) and s:len() == 3)
+
+	-- removing and re-adding many values reuses tombstones.
+	const big = Set()
+	for i = 0, 1000 {
+		big:add(i)
+		big:add("k{}":fmt(i))
+	}
+	assert(big:len() == 2000)
+	for i = 0, 1000 { big:remove(i) }
+	assert(big:len() == 1000 and big:has("k999") and !big:has(999))
+
+	const keys = [{}, {}]
+	const objs = Set(keys)
+	assert(objs:has(keys[0]) and objs:has(keys[1]) and !objs:has({}))
+
+	const a = Set([1, 2, 3, 4])
+	const b = Set([3, 4, 5])
+
+	const u = a:union(b)
+	assert(u:len() == 5)
+	for i = 1, 6 { assert(u:has(i)) }
+
+	const n = a:intersection(b)
+	assert(n:len() == 2 and n:has(3) and n:has(4))
+
+	const d = a:difference(b)
+	assert(d:len() == 2 and d:has(1) and d:has(2))
+
+	-- set operations don't modify their operands
+	assert(a:len() == 4 and b:len() == 3)
+
+	let total = 0
+	a:foreach(fn(x) { total = total + x })
+	assert(total == 10)
+
+	const xs = a:to_list()
+	xs:sort()
+	assert(#xs == 4 and xs[0] == 1 and xs[3] == 4)
+
+	a:clear()
+	assert(a:len() == 0 and !a:has(1))
+	a:add(7)
+	assert(a:has(7))
+}
+
+-- Deque
+{
+	const dq = Deque([2, 3])
+	assert(dq:push_front(1) == 3)
+	assert(dq:push_back(4) == 4)
+	assert(dq:front() == 1 and dq:back() == 4)
+	assert(dq:at(0) == 1 and dq:at(3) == 4 and dq:at(4) == nil and dq:at(-1) == nil)
+
+	assert(dq:pop_front() == 1)
+	assert(dq:pop_back() == 4)
+	assert(dq:len() == 2)
+
+	-- wrap around the ring buffer and grow while wrapped.
+	const ring = Deque()
+	for i = 0, 100 {
+		ring:push_back(i)
+		ring:push_front(-i)
+		if i % 3 == 0 { ring:pop_front() }
+	}
+	let prev = ring:pop_front()
+	while ring:len() > 0 {
+		const x = ring:pop_front()
+		assert(x >= prev)
+		prev = x
+	}
+
+	const items = Deque(["a", "b", "c"])
+	let joined = ""
+	items:foreach(fn(x, i) { joined = joined .. x .. "{}":fmt(i) })
+	assert(joined == "a0b1c2")
+
+	const list = items:to_list()
+	assert(#list == 3 and list[0] == "a" and list[2] == "c")
+
+	-- values held by a deque are kept alive by it.
+	const holder = Deque()
+	for i = 0, 50 { holder:push_back({ value: i }) }
+	for i = 0, 50 { assert(holder:pop_front().value == i) }
+
+	items:clear()
+	assert(items:len() == 0 and items:front() == nil and items:back() == nil)
+}
@@ -0,0 +1,33 @@
+assert("{} + {} = {}":fmt(1, 2, 3) == "1 + 2 = 3")
+assert("{1} {0} {1}":fmt("a", "b") == "b a b", "explicit argument indices")
+assert("{{}} {}":fmt(true) == "{} true", "escaped braces")
+assert("no fields":fmt() == "no fields")
+assert("{}":fmt(nil) == "nil")
+
+-- precision and number types
+assert("{:.2f}":fmt(3.14159) == "3.14")
+assert("{:.2}":fmt(2.5) == "2.50")
+assert("{:.3e}":fmt(1234.5) == "1.234e+03")
+assert("{:d}":fmt(42) == "42")
+assert("{:x} {:X} {:o} {:b}":fmt(255, 255, 8, 5) == "ff FF 10 101")
+assert("{:+d} {:+d}":fmt(5, -5) == "+5 -5")
+
+-- width, alignment and padding
+assert("[{:5}]":fmt(42) == "[   42]", "numbers are right aligned by default")
+assert("[{:5}]":fmt("ab") == "[ab   ]", "strings are left aligned by default")
+assert("[{:>5}]":fmt("ab") == "[   ab]")
+assert("[{:^6}]":fmt("ab") == "[  ab  ]")
+assert("[{:*<6}]":fmt("ab") == "[ab****]")
+assert("[{:-^7.1f}]":fmt(2.25) == "[--2.2--]" or "[{:-^7.1f}]":fmt(2.25) == "[--2.3--]")
+assert("[{:06.2f}]":fmt(-1.5) == "[-01.50]", "zero padding goes after the sign")
+assert("[{:.3}]":fmt("abcdef") == "[abc]", "precision truncates strings")
+
+-- the same format string is compiled once and reused.
+{
+	const row = "{:<6}|{:>8.2f}"
+	let out = ""
+	for i = 0, 3 {
+		out = out .. row:fmt("r{}":fmt(i), i * 1.5) .. ";"
+	}
+	assert(out == "r0    |    0.00;r1    |    1.50;r2    |    3.00;")
+}
@@ -0,0 +1,42 @@
+-- freeze makes a deep, read-only copy of a table or list.
+const config = {
+	name: "server",
+	ports: [80, 443],
+	limits: { conns: 100, rate: 2.5 }
+}
+
+const frozen = freeze(config)
+assert(is_frozen(frozen) and !is_frozen(config))
+assert(is_frozen(frozen.ports) and is_frozen(frozen.limits))
+assert(frozen.name == "server" and frozen.ports[1] == 443 and frozen.limits.rate == 2.5)
+assert(#frozen.ports == 2)
+
+-- the original can still be modified, and changes don't show up in the copy.
+config.name = "client"
+config.ports <<< 8080
+assert(frozen.name == "server" and #frozen.ports == 2)
+
+-- frozen strings compare equal to the strings of the VM, and work as keys.
+assert(frozen.name == "ser" .. "ver")
+const by_name = { server: 1 }
+assert(by_name[frozen.name] == 1)
+assert(frozen["na" .. "me"] == "server")
+assert(freeze({ [frozen.name]: true }).server)
+
+-- values that are shared stay shared, and cycles are kept.
+const shared = [1, 2]
+const node = { a: shared, b: shared }
+node.self = node
+const fnode = freeze(node)
+assert(fnode.a == fnode.b and fnode.self == fnode and fnode.self.self.a[1] == 2)
+
+-- prototypes are frozen along with their tables.
+const Proto = { greet: "hi" }
+const obj = setproto({}, Proto)
+const fobj = freeze(obj)
+assert(fobj.greet == "hi" and is_frozen(getproto(fobj)))
+
+-- freezing something that is already frozen, or can't change, gives back an equal value.
+assert(freeze(frozen) == frozen)
+assert(freeze(10) == 10 and freeze(nil) == nil)
+assert(freeze("str") == "str")
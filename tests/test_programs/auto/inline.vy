@@ -0,0 +1,53 @@
+-- Calls to small leaf functions are inlined at the call site.
+fn add(a, b) {
+	return a + b
+}
+
+const clamp = /x, lo, hi -> (x < lo and lo) or (x > hi and hi) or x
+const first = /xs -> xs[0]
+fn noop() {}
+
+assert(add(1, 2) == 3)
+assert(add(add(1, 2), add(3, 4)) == 10)
+
+-- inlined calls behave the same as real calls, which are made when calling through a table.
+const ref = { clamp: clamp }
+for x = -2, 14 {
+	assert(clamp(x, 1, 10) == ref.clamp(x, 1, 10))
+	assert(clamp(x, 0, 5) == ref.clamp(x, 0, 5))
+}
+assert(first([7, 8]) == 7)
+assert(noop() == nil)
+
+-- arguments are evaluated once, in order.
+const calls = []
+const arg = fn(x) { calls <<< x; return x }
+assert(add(arg(1), arg(2)) == 3)
+assert(#calls == 2 and calls[0] == 1 and calls[1] == 2)
+
+-- inlined code is used from nested functions too.
+const sum_to = fn(n) {
+	let total = 0
+	for i = 0, n { total = add(total, i) }
+	return total
+}
+assert(sum_to(10) == 45)
+
+-- overloaded operators still work inside inlined code.
+const Vec = {}
+Vec.__add = /a, b -> setproto({ x: a.x + b.x }, Vec)
+const v = { x: 1 }
+setproto(v, Vec)
+assert(add(v, v).x == 2)
+
+-- a call with a different number of arguments is not inlined.
+assert(add(1, 2, 3) == 3)
+
+-- if the variable holds another function when called, then that function is called instead.
+let op = fn(x) { return x * 2 }
+const apply = /x -> op(x)
+assert(op(4) == 8 and apply(4) == 8)
+op = /x -> x * 3
+assert(op(4) == 12 and apply(4) == 12)
+op = assert
+assert(op(true) and apply(true))
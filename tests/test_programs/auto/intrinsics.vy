@@ -0,0 +1,42 @@
+const math = import("math")
+
+-- calls to the math builtins are run in place.
+{
+	assert(math.sqrt(16) == 4)
+	assert(math.floor(-2.5) == -3 and math.ceil(-2.5) == -2)
+	assert(math.abs(-3) == 3 and math.abs(3) == 3)
+	assert(math.sin(0) == 0 and math.cos(0) == 1)
+
+	let total = 0
+	for i = 1, 100 { total = total + math.floor(i / 10) }
+	assert(total == 450)
+}
+
+-- a field that no longer holds the builtin is called normally.
+{
+	const m = { sqrt: fn(x) { return x + 1 }, abs: math.floor }
+	assert(m.sqrt(16) == 17)
+	assert(m.abs(-2.5) == -3)
+
+	const sqrt = math.sqrt
+	math.sqrt = fn(x) { return "patched" }
+	assert(math.sqrt(4) == "patched")
+	math.sqrt = sqrt
+	assert(math.sqrt(4) == 2)
+}
+
+-- list:pop() is run in place.
+{
+	const xs = [1, 2, 3]
+	assert(xs:pop() == 3 and xs:pop() == 2)
+	assert(#xs == 1 and xs[0] == 1)
+
+	let sum = 0
+	const ys = [1, 2, 3, 4]
+	while #ys > 0 { sum = sum + ys:pop() }
+	assert(sum == 10)
+
+	-- only lists get the intrinsic, other receivers call their own 'pop'.
+	const stack = { items: [5], pop() { return self.items:pop() * 2 } }
+	assert(stack:pop() == 10)
+}
@@ -0,0 +1,80 @@
+-- Table literals
+{
+	const x = 10
+	const t = { a: 1, b: x * 2, c: "three", d: [4] }
+	assert(#t == 4)
+	assert(t.a == 1 and t.b == 20 and t.c == "three" and t.d[0] == 4)
+
+	-- tables made from the same literal don't share their fields.
+	const make = fn(v) { return { v: v, w: v + 1 } }
+	const p = make(1)
+	const q = make(5)
+	p.v = 100
+	p.z = 3
+	assert(q.v == 5 and q.w == 6 and q.z == nil and #q == 2)
+	assert(p.v == 100 and p.w == 2 and #p == 3)
+
+	-- fields set to nil are left out.
+	const n = { a: nil, b: 2, c: nil }
+	assert(#n == 1 and n.a == nil and n.b == 2)
+	n.a = 1
+	assert(#n == 2 and n.a == 1)
+
+	-- the last of two fields with the same key wins.
+	const dup = { a: 1, b: 2, a: 3 }
+	assert(#dup == 2 and dup.a == 3 and dup.b == 2)
+
+	-- identifier keys mixed with computed keys.
+	const k = "key"
+	const mixed = { a: 1, [k]: 2, b: 3, [1 + 1]: 4 }
+	assert(#mixed == 4 and mixed.a == 1 and mixed.key == 2 and mixed.b == 3 and mixed[2] == 4)
+	const computed_first = { [k]: 1, a: 2 }
+	assert(#computed_first == 2 and computed_first.key == 1 and computed_first.a == 2)
+
+	-- methods
+	const obj = {
+		value: 5,
+		get() { return self.value }
+	}
+	assert(obj:get() == 5)
+
+	-- nested literals and values that allocate.
+	const nested = { inner: { list: [1, 2], name: "a" .. "b" }, other: {} }
+	assert(nested.inner.list[1] == 2 and nested.inner.name == "ab" and #nested.other == 0)
+
+	-- more fields than fit in a single shape.
+	const big = fn() { return {
+		f0: 0, f1: 1, f2: 2, f3: 3, f4: 4, f5: 5, f6: 6, f7: 7, f8: 8, f9: 9, f10: 10, f11: 11,
+		f12: 12, f13: 13, f14: 14, f15: 15, f16: 16, f17: 17, f18: 18, f19: 19, f20: 20, f21: 21,
+		f22: 22, f23: 23, f24: 24, f25: 25, f26: 26, f27: 27, f28: 28, f29: 29, f30: 30, f31: 31,
+		f32: 32, f33: 33, f34: 34, f35: 35, f36: 36, f37: 37, f38: 38, f39: 39, f40: 40, f41: 41,
+		f42: 42, f43: 43, f44: 44, f45: 45, f46: 46, f47: 47, f48: 48, f49: 49, f50: 50, f51: 51,
+		f52: 52, f53: 53, f54: 54, f55: 55, f56: 56, f57: 57, f58: 58, f59: 59, f60: 60, f61: 61,
+		f62: 62, f63: 63, f64: 64, f65: 65
+	} }()
+	assert(#big == 66)
+	for i = 0, 66 { assert(big["f{}":fmt(i)] == i) }
+}
+
+-- List literals
+{
+	const xs = [1, "two", nil, { four: 4 }]
+	assert(#xs == 4 and xs[0] == 1 and xs[1] == "two" and xs[2] == nil and xs[3].four == 4)
+	xs <<< 5
+	assert(#xs == 5 and xs[4] == 5)
+
+	-- more items than are appended at once.
+	const big = fn() { return [
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+		25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46,
+		47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68,
+		69
+	] }()
+	assert(#big == 70)
+	for i = 0, 70 { assert(big[i] == i) }
+
+	const empty = []
+	assert(#empty == 0)
+	empty <<< 1
+	assert(empty[0] == 1)
+}
@@ -0,0 +1,136 @@
+-- dense integer patterns are dispatched with a jump table.
+fn dense(n) {
+	match n {
+		0 -> return "zero"
+		1, 2 -> return "small"
+		4 -> return "four"
+		5 -> return "five"
+		else -> return "other"
+	}
+}
+
+assert(dense(0) == "zero")
+assert(dense(1) == "small" and dense(2) == "small")
+assert(dense(3) == "other")
+assert(dense(4) == "four" and dense(5) == "five")
+assert(dense(6) == "other" and dense(-1) == "other")
+assert(dense(1.5) == "other" and dense("1") == "other" and dense(nil) == "other")
+
+-- sparse patterns of different types are looked up in a table.
+fn sparse(v) {
+	match v {
+		"add", "+" -> return 1
+		"sub" -> return 2
+		-- the ';' stops `3` and `-7` from being parsed as `3 - 7`.
+		1000 -> return 3;
+		-7 -> return 4
+		0.5 -> return 5
+		true -> return 6
+	}
+	return 0
+}
+
+assert(sparse("add") == 1 and sparse("+") == 1)
+assert(sparse("s" .. "ub") == 2)
+assert(sparse(1000) == 3 and sparse(-7) == 4 and sparse(0.5) == 5)
+assert(sparse(true) == 6 and sparse(false) == 0)
+assert(sparse("mul") == 0 and sparse({}) == 0)
+
+-- non constant patterns are tested in order, between the constant ones.
+fn mixed(v, a) {
+	let result = "none"
+	match v {
+		1 -> result = "one"
+		a -> result = "a"
+		2, a + 1 -> result = "two or a + 1"
+		3 -> result = "three"
+		1 -> result = "unreachable"
+	}
+	return result
+}
+
+assert(mixed(1, 1) == "one")
+assert(mixed(5, 5) == "a")
+assert(mixed(2, 5) == "two or a + 1" and mixed(6, 5) == "two or a + 1")
+assert(mixed(3, 3) == "a" and mixed(3, 9) == "three")
+assert(mixed(4, 9) == "none")
+
+-- the first arm with a matching pattern wins.
+let first = 0
+match 2 {
+	2 -> first = 1
+	2 -> first = 2
+}
+assert(first == 1)
+
+-- arms can be blocks with locals, and matches can be nested and used in loops.
+let count = 0
+for i = 0, 10 {
+	match i % 3 {
+		0 -> {
+			const inner = i
+			match inner {
+				0 -> count += 100
+				else -> count += 1
+			}
+		}
+		1 -> continue
+		else -> {
+			if i == 8 break
+			count += 10
+		}
+	}
+}
+-- i = 0 -> 100, 3, 6 -> 1 each, 2, 5 -> 10 each, break at 8.
+assert(count == 122)
+
+-- a tiny stack machine, the kind of code match is meant for.
+fn run(program) {
+	const stack = []
+	let pc = 0
+	while pc < #program {
+		const op = program[pc]
+		match op {
+			"push" -> {
+				pc += 1
+				stack <<< program[pc]
+			}
+			"add" -> stack <<< stack:pop() + stack:pop()
+			"mul" -> stack <<< stack:pop() * stack:pop()
+			"dup" -> {
+				const top = stack:pop()
+				stack <<< top
+				stack <<< top
+			}
+			else -> assert(false, "bad op")
+		}
+		pc += 1
+	}
+	return stack:pop()
+}
+
+assert(run(["push", 3, "dup", "mul", "push", 4, "add"]) == 13)
+
+-- closures can capture variables declared inside an arm.
+let getter = nil
+match "x" {
+	"x" -> {
+		const captured = 42
+		getter = fn() { return captured }
+	}
+}
+assert(getter() == 42)
+
+-- a declaration as the body of an arm that isn't taken doesn't pop locals it never pushed.
+fn declaring_arms(n) {
+	const before = "before"
+	match n {
+		1 -> let y = 5
+		before -> let z = n
+		else -> {}
+	}
+	assert(before == "before")
+}
+declaring_arms(1)
+declaring_arms("before")
+declaring_arms(3)
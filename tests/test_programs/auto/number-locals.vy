@@ -0,0 +1,116 @@
+-- Locals that only ever hold numbers use arithmetic and comparisons that skip type checks.
+-- These tests make sure a local that may hold something else never does.
+
+-- A vector on the left of a number.
+const Vec = {
+	__add(n) { return setproto({ x: self.x + n }, getproto(self)) },
+	__mult(n) { return setproto({ x: self.x * n }, getproto(self)) },
+	__lt(n) { return self.x < n }
+}
+
+const vec = fn(x) { return setproto({ x: x }, Vec) }
+
+-- plain numbers
+{
+	let sum = 0
+	for i = 0, 10 {
+		sum = sum + i * 2
+		if i < 5 { sum += 1 }
+	}
+	assert(sum == 95)
+
+	let x = 1
+	while x < 100 { x = x * 3 }
+	assert(x == 243)
+
+	const n = -x + #[1, 2, 3]
+	assert(n == -240)
+}
+
+-- a local that is later assigned a non-number inside a loop. The arithmetic compiled before the
+-- assignment runs again after it.
+{
+	let a = 1
+	let b = 0
+	for i = 0, 3 {
+		b = a + 1
+		if i == 1 { a = vec(5) }
+	}
+	assert(b.x == 6)
+}
+
+-- a local that only gets a non-number through another local.
+{
+	let a = 1
+	let b = 2
+	let result = nil
+	for i = 0, 3 {
+		result = b * 2
+		b = a + 1
+		if i == 0 { a = vec(1) }
+	}
+	assert(result.x == 4)
+}
+
+-- the same, with the dependent local declared in a block that ends before the assignment.
+{
+	let a = 1
+	let result = nil
+	for i = 0, 3 {
+		{
+			let d = 0
+			for j = 0, 2 {
+				result = d * 2
+				d = a + 1
+			}
+		}
+		a = vec(1)
+	}
+	assert(result.x == 4)
+}
+
+-- compound assignment
+{
+	const one = fn() { return 1 }
+	let a = 1
+	let b = 1
+	let out = nil
+	for i = 0, 3 {
+		a += one()
+		out = b < 2
+		b *= 2
+		if i == 1 { b = vec(1) }
+	}
+	assert(a == 4 and out == true)
+}
+
+-- the loop counter may be reassigned in the body.
+{
+	let out = nil
+	for i = 0, 2 {
+		i = vec(i)
+		out = i * 2
+	}
+	assert(out.x == 2)
+}
+
+-- a local captured by a closure may be assigned anything.
+{
+	let a = 1
+	const set = fn() { a = vec(10) }
+	let out = nil
+	for i = 0, 2 {
+		out = a + 1
+		set()
+	}
+	assert(out.x == 11)
+}
+
+-- a captured constant stays a number.
+{
+	const k = 3
+	const get = fn() { return k * 2 }
+	let total = 0
+	for i = 0, 4 { total = total + k * i }
+	assert(total == 18 and get() == 6)
+}
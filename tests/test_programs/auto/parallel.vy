@@ -0,0 +1,55 @@
+const parallel = import("parallel")
+const math = import("math")
+
+-- results come back in the order of the items, whichever worker ran them.
+const xs = []
+for i = 0, 200 { xs <<< i }
+const squares = parallel.map(xs, fn (x, i) {
+	assert(x == i)
+	return x * x
+}, { workers: 4, chunk_size: 7 })
+assert(#squares == 200)
+for i = 0, 200 { assert(squares[i] == i * i) }
+assert(#parallel.map([], fn (x) { return x }) == 0)
+
+-- functions can call themselves and the functions and modules they captured.
+fn fib(n) {
+	if n < 2 { return n }
+	return fib(n - 1) + fib(n - 2)
+}
+
+let offset = 10
+const fibs = parallel.map([5, 10, 15], fn (n) {
+	return fib(n) + math.floor(math.sqrt(offset * offset))
+}, { workers: 3 })
+assert(fibs[0] == 15 and fibs[1] == 65 and fibs[2] == 620)
+
+-- closures made inside a worker can capture it's locals.
+const sums = parallel.map([1, 2, 3], fn (n) {
+	let total = 0
+	const add = fn (k) { total = total + k }
+	for i = 0, n + 1 { add(i) }
+	return total
+})
+assert(sums[0] == 1 and sums[1] == 3 and sums[2] == 6)
+
+-- struct types, tables and strings work on both sides.
+struct Point { x, y }
+const names = { a: "alpha", b: "beta" }
+const rows = parallel.map(["a", "b"], fn (key) {
+	const p = Point(#names[key], 1)
+	return { name: names[key], size: p.x + p.y, short: names[key]:substr(0, 2) }
+}, { workers: 2, chunk_size: 1 })
+assert(rows[0].name == "alpha" and rows[0].size == 6 and rows[1].short == "be")
+
+-- items are frozen in the workers, but the results belong to the caller.
+const records = [{ n: 1 }, { n: 2 }]
+const flags = parallel.map(records, fn (r) { return is_frozen(r) })
+assert(flags[0] and flags[1])
+assert(!is_frozen(rows[0]))
+rows[0].name = "changed"
+
+-- a frozen list is read by the workers as it is.
+const table = freeze([1, 2, 3])
+const doubled = parallel.map(table, fn (x) { return x * 2 })
+assert(doubled[2] == 6)
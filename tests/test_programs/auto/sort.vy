@@ -0,0 +1,70 @@
+const heapq = import("heapq")
+const bisect = import("bisect")
+
+-- List.sort
+{
+	const xs = [5, 3, 9, 1, 7]
+	xs:sort()
+	assert(xs[0] == 1 and xs[1] == 3 and xs[2] == 5 and xs[3] == 7 and xs[4] == 9)
+
+	const words = ["pear", "apple", "fig", "apricot"]
+	words:sort()
+	assert(words[0] == "apple" and words[1] == "apricot" and words[2] == "fig")
+
+	-- stable sort with a key function
+	const people = [
+		{ name: "a", age: 30 }, { name: "b", age: 25 },
+		{ name: "c", age: 30 }, { name: "d", age: 25 }
+	]
+	people:sort(fn(p) { return p.age })
+	assert(people[0].name == "b" and people[1].name == "d")
+	assert(people[2].name == "a" and people[3].name == "c")
+
+	const empty = []
+	empty:sort()
+	assert(#empty == 0)
+}
+
+-- heapq
+{
+	const heap = []
+	const input = [5, 1, 8, 3, 2, 9, 4]
+	input:foreach(fn(x) { heapq.push(heap, x) })
+	assert(heapq.peek(heap) == 1)
+
+	let out = []
+	while #heap > 0 {
+		out <<< heapq.pop(heap)
+	}
+	for i = 1, #out {
+		assert(out[i - 1] <= out[i], "heap pops in ascending order")
+	}
+	assert(#out == 7)
+	assert(heapq.peek(heap) == nil)
+
+	-- heapify + key function: a max-heap of tasks by priority.
+	const tasks = [{ p: 2 }, { p: 7 }, { p: 1 }, { p: 5 }]
+	const neg = fn(t) { return -t.p }
+	heapq.heapify(tasks, neg)
+	assert(heapq.pop(tasks, neg).p == 7)
+	heapq.push(tasks, { p: 6 }, neg)
+	assert(heapq.pop(tasks, neg).p == 6)
+	assert(heapq.pop(tasks, neg).p == 5)
+}
+
+-- bisect
+{
+	const xs = [1, 2, 2, 2, 5, 8]
+	assert(bisect.lower(xs, 2) == 1)
+	assert(bisect.upper(xs, 2) == 4)
+	assert(bisect.lower(xs, 0) == 0)
+	assert(bisect.upper(xs, 9) == 6)
+
+	assert(bisect.insort(xs, 3) == 4)
+	assert(#xs == 7 and xs[4] == 3 and xs[5] == 5)
+
+	const events = [{ t: 1 }, { t: 4 }, { t: 9 }]
+	const time = fn(e) { return e.t }
+	assert(bisect.lower(events, 4, time) == 1)
+	assert(bisect.upper(events, 4, time) == 2)
+}
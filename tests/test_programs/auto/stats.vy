@@ -0,0 +1,46 @@
+const stats = import("stats")
+
+const xs = [4, 1, 7, 3, 9, 2, 8]
+
+assert(stats.sum(xs) == 34)
+assert(stats.sum([]) == 0)
+assert(stats.mean([2, 4, 6, 8]) == 5)
+assert(stats.min(xs) == 1)
+assert(stats.max(xs) == 9)
+assert(stats.argmin(xs) == 1)
+assert(stats.argmax(xs) == 4)
+assert(stats.argmax([3, 5, 5]) == 1, "ties resolve to the first index")
+
+{
+	const ys = [2, 4, 4, 4, 5, 5, 7, 9]
+	assert(stats.variance(ys) == 4)
+	assert(stats.stdev(ys) == 2)
+	assert(stats.variance([1, 2, 3, 4], 1) == 5 / 3, "sample variance")
+}
+
+{
+	assert(stats.percentile(xs, 0) == 1)
+	assert(stats.percentile(xs, 50) == 4)
+	assert(stats.percentile(xs, 100) == 9)
+	assert(stats.percentile([1, 2, 3, 4], 50) == 2.5)
+	assert(stats.percentile([10, 20], 25) == 12.5)
+	assert(xs[0] == 4 and xs[6] == 8, "percentile does not reorder the list")
+}
+
+{
+	const h = stats.histogram([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10], 5)
+	assert(#h == 5)
+	assert(h[0] == 2 and h[1] == 2 and h[2] == 2 and h[3] == 2 and h[4] == 3)
+
+	const h2 = stats.histogram([-1, 0, 0.5, 1, 2], 2, 0, 1)
+	assert(h2[0] == 1 and h2[1] == 2, "values outside [lo, hi] are skipped")
+}
+
+-- a longer list exercises the unrolled loops and their tails.
+{
+	const big = List.make(1003)
+	for i = 0, #big { big[i] = i }
+	assert(stats.sum(big) == 1002 * 1003 / 2)
+	assert(stats.mean(big) == 501)
+	assert(stats.argmax(big) == 1002)
+}
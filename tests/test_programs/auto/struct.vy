@@ -0,0 +1,97 @@
+-- Structs have a fixed set of fields, given positionally to their constructor.
+struct Point { x, y }
+struct Particle {
+	pos,
+	vel,
+	mass,
+}
+struct Empty {}
+
+const p = Point(1, 2)
+assert(p.x == 1 and p.y == 2)
+
+-- fields that are left out are nil.
+const q = Point(5)
+assert(q.x == 5 and q.y == nil)
+assert(Empty() != Empty())
+
+-- fields can be assigned, but not added.
+let r = Point(3, 4)
+r.x = 10
+r.y += 5
+r.y *= 2
+assert(r.x == 10 and r.y == 18)
+
+-- instances are compared and hashed by identity.
+const t = { [p]: "p" }
+assert(t[p] == "p" and t[q] == nil)
+assert(p == p and p != Point(1, 2))
+
+-- fields can be read and written through values that aren't known to be structs.
+fn len2(v) {
+	return v.x * v.x + v.y * v.y
+}
+assert(len2(Point(3, 4)) == 25)
+assert(len2({ x: 1, y: 1 }) == 2)
+
+fn move(v, dx) {
+	v.x += dx
+	return v
+}
+assert(move(Point(1, 1), 2).x == 3)
+
+-- subscripts use the field names.
+assert(p["y"] == 2)
+r["x"] = 0
+assert(r.x == 0)
+
+-- a variable that was initialized with one struct may later hold something else.
+let s = Point(1, 2)
+s = { x: "table" }
+assert(s.x == "table")
+s = Particle(Point(0, 0), Point(1, 1), 4)
+assert(s.mass == 4 and s.pos.x == 0)
+
+-- fields holding functions can be called as methods.
+struct Counter { count, incr }
+const c = Counter(0, fn(self, by) { self.count += by })
+c:incr(2)
+c:incr(3)
+assert(c.count == 5)
+
+-- structs and their instances can be captured.
+fn make_particles(n) {
+	const ps = []
+	for i = 0, n {
+		ps <<< Particle(Point(i, i), Point(1, 2), 1)
+	}
+	return ps
+}
+
+fn step(ps) {
+	for i = 0, #ps {
+		const prt = ps[i]
+		prt.pos.x += prt.vel.x
+		prt.pos.y += prt.vel.y
+	}
+}
+
+const ps = make_particles(10)
+step(ps)
+step(ps)
+assert(ps[3].pos.x == 5 and ps[3].pos.y == 7)
+
+const origin = Point(0, 0)
+const shift = fn() {
+	origin.x += 1
+	return origin.x
+}
+shift()
+assert(shift() == 2 and origin.x == 2)
+
+-- a struct that is declared in a block is local to it.
+{
+	struct Point { a }
+	assert(Point(1).a == 1)
+}
+assert(Point(1, 2).y == 2)
@@ -0,0 +1,19 @@
+const time = import("time")
+
+{
+	const t0 = time.clock()
+	time.sleep(0.002)
+	const t1 = time.clock()
+	assert(t1 - t0 >= 2000000, "time.clock() is measured in nanoseconds")
+}
+
+assert(time.now() > 1600000000, "time.now() returns seconds since the epoch")
+
+{
+	let calls = 0
+	const report = time.bench(fn() { calls += 1 }, 100)
+	assert(calls == 100)
+	assert(report.runs == 100)
+	assert(report.min <= report.median and report.median <= report.p99)
+	assert(report.total >= report.min * 100)
+}
@@ -9,4 +9,68 @@ assert(mult(1, 2) == 2 && mult(1, 2, 3) == 6, "varargs in arrow functions broken
 
 const scale_and_reduce = /a, xs... -> a * xs:reduce(/x, y -> x + y)
 
-assert(scale_and_reduce(2, 1, 2, 3) == 12, "varargs preceding an argument broken")
\ No newline at end of file
+assert(scale_and_reduce(2, 1, 2, 3) == 12, "varargs preceding an argument broken")
+
+-- varargs that are only counted, indexed or passed along are read from the stack.
+const count = /xs... -> #xs
+assert(count() == 0 and count(1) == 1 and count(nil, nil, nil) == 3)
+
+const second = /a, xs... -> xs[1]
+assert(second(0, 1, 2, 3) == 2)
+
+-- assigning to, or capturing the rest parameter.
+fn reassign(xs...) {
+	const n = #xs
+	xs = [n]
+	return xs[0]
+}
+assert(reassign(1, 2, 3) == 3)
+
+fn capture(xs...) {
+	return fn() { return #xs + xs[0] }
+}
+assert(capture(10, 20)() == 12)
+
+fn sum(xs...) {
+	let total = 0
+	for i = 0, #xs { total = total + xs[i] }
+	return total
+}
+assert(sum() == 0 and sum(1, 2, 3, 4) == 10)
+
+fn forward(f, xs...) {
+	return f(xs...)
+}
+assert(forward(sum, 1, 2, 3) == 6)
+assert(forward(sum) == 0)
+assert(forward(count, nil, nil) == 2)
+
+const obj = {
+	n: 100,
+	add(xs...) { return self.n + sum(xs...) },
+	add_twice(xs...) { return self:add(xs...) + self:add(xs...) }
+}
+assert(obj:add_twice(1, 2) == 206)
+
+-- missing fixed arguments are nil, and the rest parameter is an empty list.
+const pair = /a, b, xs... -> [a, b, xs]
+const p = pair(1)
+assert(p[0] == 1 and p[1] == nil and #p[2] == 0)
+
+-- a rest parameter that escapes is a list, which later reads see.
+fn escape(xs...) {
+	const list = xs
+	list[0] = "changed"
+	list <<< "new"
+	return [xs[0], #xs, xs[2]]
+}
+const e = escape("a", "b")
+assert(e[0] == "changed" and e[1] == 3 and e[2] == "new")
+
+-- varargs stay intact across nested variadic calls.
+fn outer(a, xs...) {
+	const inner = forward(sum, xs...)
+	return [inner, #xs, xs[#xs - 1], a]
+}
+const o = outer("a", 1, 2, 3)
+assert(o[0] == 6 and o[1] == 3 and o[2] == 3 and o[3] == "a")
@@ -49,7 +49,8 @@ void print_ttype(vy::TokenType type) {
 		"Let",		 "Const",	   "If",
 		"While",	 "For",		   "Else",
 		"Nil",		 "Fn",		   "Return",
-		"Break",	 "Continue",
+		"Break",	 "Continue",	   "Match",
+		"Struct",
 	};
 	const std::string& str = type_strs[static_cast<size_t>(type)];
 	std::printf("%-10s", str.c_str());
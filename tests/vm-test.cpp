@@ -1,7 +1,10 @@
 #include "assert.hpp"
+#include "function.hpp"
 #include "util/test_utils.hpp"
 #include "value.hpp"
 #include "vm.hpp"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <memory>
 #include <stdlib.h>
@@ -185,6 +188,273 @@ static void negative_tests() {
 	test_error("1 + 2", "Unexpected expression.");
 	test_error("_ = nil[0]", "Attempt to index a nil value.");
 	test_error("=", "Unexpected '='.");
+	test_error("const l = [1]\n_ = print(l...)",
+			   "Only a variadic parameter can be spread into a call.");
+	test_error("_ = (fn(xs...) { return xs[2] })(1, 2)",
+			   "List index out of bounds. (index: 2, length: 2)");
+
+	// An intrinsic call reports the same error as the builtin it stands in for.
+	test_error("const xs = []\n_ = xs:pop()",
+			   "In call to 'List.pop': Attempt to pop from an empty list");
+}
+
+static void metadata_test() {
+	// Repeated constants share a slot, so this doesn't run out of constants.
+	std::string code = "const t = { field: 1 }\nlet sum = 0\n";
+	for (int i = 0; i < 300; ++i) code += "sum = sum + t.field * 1.5\n";
+	code += "assert(sum == 450)";
+	runcode(std::move(code));
+
+	// Line numbers are still right after the compiler removes code to read the varargs in place.
+	static std::string trace;
+	VM vm;
+	vm.load_stdlib();
+	vm.on_error = [](VM&, RuntimeError error) { trace = error.full_message; };
+	vm.runcode("const f = fn(xs...) {\n"
+			   "  const n = #xs\n"
+			   "\n"
+			   "  return xs[n]\n"
+			   "}\n"
+			   "_ = f(1, 2)");
+	ASSERT(trace.find(":4: List index out of bounds.") != std::string::npos,
+		   "Wrong line in error: " + trace);
+}
+
+static void struct_test() {
+	test_return(R"(
+		struct Point { x, y }
+		const p = Point(3, 4)
+		p.y += 1
+		return p.x * p.y
+	)",
+				NUM(15), "Struct fields");
+
+	test_error("struct P { a, a }", "Duplicate field 'a' in struct 'P'.");
+	test_error("struct P { a }\n_ = P(1, 2)",
+			   "Struct 'P' has 1 fields, but was constructed with 2 values.");
+	test_error("struct P { a }\nconst p = P(1)\n_ = p.b", "No field 'b' in struct 'P'.");
+	test_error("struct P { a }\nconst p = P(1)\np.b = 1", "No field 'b' in struct 'P'.");
+	test_error("struct P { a }\nconst f = fn(p) { p.b = 1 }\nf(P(1))",
+			   "No field 'b' in struct 'P'.");
+	test_error("struct P { a }\nconst p = P(1)\n_ = p[0]", "No field '0' in struct 'P'.");
+
+	// Fields of values known to be instances are read from their slots, so the field names aren't
+	// constants, and every access refers to the same struct constant.
+	std::string code = "struct P { a, b }\nconst p = P(1, 2)\nlet sum = 0\n";
+	for (int i = 0; i < 300; ++i) code += "sum = sum + p.b\n";
+	code += "return sum";
+
+	VM vm;
+	vm.load_stdlib();
+	Closure* script = vm.compile({"", code});
+	ASSERT(script != nullptr, "Struct code failed to compile.");
+	const auto& constants = script->m_codeblock->block().constant_pool;
+	const Value field_name = VYSE_OBJECT(&vm.make_string("b"));
+	ASSERT(std::find(constants.begin(), constants.end(), field_name) == constants.end(),
+		   "Field of a struct read by name.");
+	ASSERT(vm.runcode(code) == ExitCode::Success and vm.return_value == NUM(600),
+		   "Wrong sum of struct fields.");
+}
+
+static void freeze_test() {
+	test_error("const t = freeze({ a: 1 })\nt.a = 2", "Attempt to modify a frozen table.");
+	test_error("const t = freeze({ a: 1 })\nt[\"b\"] = 2", "Attempt to modify a frozen table.");
+	test_error("const t = freeze({ a: { b: 1 } })\nt.a.b += 1",
+			   "Attempt to modify a frozen table.");
+	test_error("const l = freeze([1])\nl[0] = 2", "Attempt to modify a frozen list.");
+	test_error("const l = freeze([1])\nl <<< 2", "Attempt to modify a frozen list.");
+	test_error("const l = freeze([1])\n_ = l:pop()",
+			   "In call to 'List.pop': Attempt to modify a frozen list.");
+	test_error("_ = setproto(freeze({}), {})",
+			   "In call to 'setproto': Attempt to modify a frozen table.");
+	test_error("_ = freeze({ f: fn() {} })",
+			   "In call to 'freeze': Cannot freeze a function value.");
+
+	// A region frozen by one VM can be read by another, which keeps it alive after the first one
+	// is gone. Strings of the second VM find keys in frozen tables.
+	std::shared_ptr<const FrozenRegion> region;
+	{
+		VM vm;
+		vm.load_stdlib();
+		ASSERT(vm.runcode("return freeze({ name: \"vyse\", nums: [1, 2, 3] })") ==
+				   ExitCode::Success,
+			   "Failed to freeze a table.");
+		region = vm.frozen_region(vm.return_value);
+		ASSERT(region != nullptr and region->size() > 0, "Frozen region not adopted.");
+	}
+
+	VM vm;
+	vm.load_stdlib();
+	vm.set_global("shared", vm.adopt(region));
+	ASSERT(vm.runcode("const n = shared.nums\n"
+					  "return shared[\"na\" .. \"me\"] == \"vyse\" and #n + n[2] == 6") ==
+				   ExitCode::Success and
+			   vm.return_value == BOOL(true),
+		   "Failed to read a frozen table.");
+
+	// Frozen objects survive collections in the VMs that refer to them, without being owned by any.
+	vm.collect_garbage();
+	ASSERT(vm.runcode("return shared.nums[0]") == ExitCode::Success and
+			   vm.return_value == NUM(1),
+		   "Frozen region freed by the GC.");
+
+	// Regions frozen by a script are given up by the GC once they can't be reached, unless
+	// something still refers to them.
+	ASSERT(vm.runcode("return freeze({ n: 1 })") == ExitCode::Success, "Failed to freeze.");
+	vm.set_global("kept", vm.return_value);
+	const std::weak_ptr<const FrozenRegion> kept = vm.frozen_region(vm.return_value);
+	ASSERT(vm.runcode("return freeze([1, 2])") == ExitCode::Success, "Failed to freeze.");
+	const std::weak_ptr<const FrozenRegion> dropped = vm.frozen_region(vm.return_value);
+	// The value returned by a script stays on the stack until the next one is run.
+	ASSERT(vm.runcode("return 0") == ExitCode::Success, "Failed to run a script.");
+	vm.collect_garbage();
+	ASSERT(dropped.expired() and !kept.expired(), "Unreachable frozen region kept alive.");
+	ASSERT(vm.runcode("return kept.n") == ExitCode::Success and vm.return_value == NUM(1),
+		   "Reachable frozen region freed by the GC.");
+}
+
+static void lazy_compile_test() {
+	static std::string message;
+	const auto run_lazy = [](const char* code) {
+		message.clear();
+		VM vm;
+		vm.lazy_compile = true;
+		vm.load_stdlib();
+		vm.on_error = [](VM&, RuntimeError error) { message = error.full_message; };
+		return vm.runcode(code);
+	};
+
+	// A function that is never called is never compiled.
+	ExitCode ec = run_lazy("fn unused() { return ) }\n"
+						   "assert(unused != nil)");
+	ASSERT(ec == ExitCode::Success, "Uncalled function was compiled: " + message);
+
+	ec = run_lazy("fn broken() {\n"
+				  "  return )\n"
+				  "}\n"
+				  "broken()");
+	ASSERT(ec == ExitCode::RuntimeError and message.find("[line 2]") != std::string::npos,
+		   "Expected a compile error on the first call: " + message);
+
+	// Upvalues are captured when a function is scanned, and resolved by name when it's compiled.
+	ec = run_lazy("const k = 10\n"
+				  "let count = 0\n"
+				  "fn outer(x) {\n"
+				  "  let count = x\n"
+				  "  fn inner() { count = count + k; return count }\n"
+				  "  return inner\n"
+				  "}\n"
+				  "const f = outer(1)\n"
+				  "assert(f() == 11 and f() == 21 and count == 0)\n"
+				  "const t = { n: 2, twice(y) { return self.n * y + k } }\n"
+				  "assert(t:twice(3) == 16)\n"
+				  "fn sum(xs...) { let s = 0; for i = 0, #xs { s = s + xs[i] } return s }\n"
+				  "assert(sum(1, 2, 3) == 6)");
+	ASSERT(ec == ExitCode::Success, "Lazy closures failed: " + message);
+
+	ec = run_lazy("const k = 1\n"
+				  "fn set() { k = 2 }\n"
+				  "set()");
+	ASSERT(ec == ExitCode::RuntimeError and message.find("const") != std::string::npos,
+		   "Expected an error for assigning to a captured const: " + message);
+
+	// Runtime errors in a lazily compiled function point at the right line.
+	ec = run_lazy("fn f(xs) {\n"
+				  "\n"
+				  "  return xs[5]\n"
+				  "}\n"
+				  "f([])");
+	ASSERT(message.find(":3: List index out of bounds.") != std::string::npos,
+		   "Wrong line in error: " + message);
+}
+
+static void profile_test() {
+	// `get` guesses that it's argument is a `Q`, the last struct with a field `b`, but is called
+	// with a `P` unless `use_q` is set.
+	const std::string code = R"(
+		const floor = import("math").floor
+		struct P { a, b }
+		struct Q { b, a }
+		fn get(p) { return p.b }
+		fn unused() { return 1 }
+		fn sum(n, make) {
+			let s = 0
+			for i = 0, n { s = s + floor(get(make(i, i + 0.5))) }
+			return s
+		}
+		let make = P
+		if use_q { make = fn(a, b) { return Q(b, a) } }
+		return sum(100, make)
+	)";
+
+	const auto run = [&](const Profile* profile, bool record, bool use_q, bool lazy) {
+		auto vm = std::make_unique<VM>();
+		vm->lazy_compile = lazy;
+		vm->profile = profile;
+		vm->record_profile = record;
+		vm->load_stdlib();
+		vm->set_global("use_q", BOOL(use_q));
+		ASSERT(vm->runcode(code) == ExitCode::Success and vm->return_value == NUM(4950),
+			   "Wrong result with a profile.");
+		return vm;
+	};
+
+	const auto apply = [&](const Profile& profile, bool lazy, size_t& num_lazy) {
+		VM vm;
+		vm.lazy_compile = lazy;
+		vm.load_stdlib();
+		Closure* script = vm.compile({"", code});
+		ASSERT(script != nullptr, "Profiled code failed to compile.");
+		const GCLock lock = vm.gc_lock(script);
+
+		const Profile::Script* feedback = profile.find(code);
+		ASSERT(feedback != nullptr and profile.find(code + " ") == nullptr,
+			   "Profile not matched with it's script.");
+		const size_t num_specialized = Profile::apply(vm, *script->m_codeblock, *feedback, nullptr);
+		num_lazy = 0;
+		walk_code_blocks(*script->m_codeblock,
+						 [&](const CodeBlock& code, u32) { num_lazy += code.is_lazy(); });
+		return num_specialized;
+	};
+
+	// The functions that ran are compiled up front, and the call of `floor` is specialized. The
+	// field read in `get` isn't a struct field site when it's compiled lazily.
+	const std::string path =
+		(std::filesystem::temp_directory_path() / "vyse-profile-test.txt").string();
+	{
+		Profile profile;
+		run(nullptr, true, false, true)->save_profile(profile);
+		ASSERT(profile.save(path), "Failed to save a profile.");
+	}
+
+	Profile lazy_profile;
+	ASSERT(lazy_profile.load(path), "Failed to load a profile.");
+	std::filesystem::remove(path);
+
+	size_t num_lazy = 0;
+	ASSERT(apply(lazy_profile, true, num_lazy) == 1, "Call not specialized by a profile.");
+	ASSERT(num_lazy == 2, "Functions that ran are still lazy.");
+
+	Profile profile;
+	run(nullptr, true, false, false)->save_profile(profile);
+	ASSERT(apply(profile, false, num_lazy) == 2, "Field site not specialized by a profile.");
+
+	// A profile doesn't change what a script does, even when it's guesses are wrong.
+	run(&lazy_profile, false, true, true);
+	run(&profile, false, false, false);
+	run(&profile, false, true, false);
+
+	// Recording with a profile keeps the feedback that it was seeded with.
+	Profile merged;
+	run(&profile, true, true, false)->save_profile(merged);
+	const Profile::Script* mixed = merged.find(code);
+	ASSERT(mixed != nullptr and mixed->functions.size() == profile.find(code)->functions.size(),
+		   "Feedback lost when recording with a profile.");
+	const auto get = std::find_if(mixed->functions.begin(), mixed->functions.end(),
+								  [](const Profile::Function& func) { return func.calls == 200; });
+	ASSERT(get != mixed->functions.end() and get->sites.size() == 1 and
+			   get->sites.begin()->second.target.empty(),
+		   "A site that saw two struct types is still specialized.");
 }
 
 int main() {
@@ -197,5 +467,10 @@ int main() {
 	loop_test();
 	multiple_runs_test();
 	negative_tests();
+	metadata_test();
+	struct_test();
+	freeze_test();
+	lazy_compile_test();
+	profile_test();
 	return 0;
 }